@@ -1,8 +1,59 @@
 #!/bin/bash
 
-if [ "$#" -ne 6 ]; then
+# ./build_champsim.sh registry [num_core] builds every component below into one binary,
+# they are picked at startup with -branch_predictor, -l1d_prefetcher, -l2c_prefetcher, -llc_prefetcher and -llc_replacement
+# -sweep a,b,c runs the traces through several L2C prefetchers at once, decoding them only once (inc/sweep.h)
+REGISTRY_BRANCH="bimodal gshare hashed_perceptron perceptron"
+REGISTRY_L1D_PREFETCHER="no bo_percore"
+REGISTRY_L2C_PREFETCHER="no bo_percore bo_sms bo_triage domino isb_metadataprefetch sms stms triage"
+REGISTRY_LLC_PREFETCHER="no next_line bo_percore"
+REGISTRY_LLC_REPLACEMENT="lru drrip hawkeye_simple ship srrip"
+
+# wrap a component in its own namespace, so its globals and helper functions do not clash with the others
+# usage: make_component [file] [kind] [registry] [hooks] [class]
+make_component() {
+    FILE=$1
+    DIR=$(dirname ${FILE})
+    NAME=$(basename ${FILE%.*})
+    OUT=component/$2_${NAME}.cc
+
+    echo "// generated by ./build_champsim.sh registry" > ${OUT}
+    echo "#include \"component.h\"" >> ${OUT}
+
+    # headers of code that is compiled once (e.g. triage.h for prefetcher/triage.cc) stay outside of the namespace
+    HEADERS=$(grep -h '^#include "' ${FILE} | cut -d'"' -f2)
+    for HEADER in ${HEADERS}; do
+        if [ -f ${DIR}/${HEADER} ]; then
+            HEADERS="${HEADERS} $(grep -h '^#include "' ${DIR}/${HEADER} | cut -d'"' -f2)"
+        fi
+    done
+    for HEADER in ${HEADERS}; do
+        if [ -f ${DIR}/${HEADER%.h}.cc ]; then
+            echo "#include \"../${DIR}/${HEADER}\"" >> ${OUT}
+        fi
+    done
+
+    echo "" >> ${OUT}
+    echo "namespace $2_${NAME} {" >> ${OUT}
+    echo "#include \"component_scope.h\"" >> ${OUT}
+    echo "#include \"../${FILE}\"" >> ${OUT}
+    echo "REGISTRAR<$3> registrar($4(), \"${NAME}\", $5<$6>::component());" >> ${OUT}
+    echo "}" >> ${OUT}
+}
+
+if [ "$1" == "registry" ]; then
+    if [ "$#" -ne 2 ]; then
+        echo "Illegal number of parameters"
+        echo "Usage: ./build_champsim.sh registry [num_core]"
+        exit 1
+    fi
+
+    set -- bimodal no no no lru $2
+    REGISTRY=1
+elif [ "$#" -ne 6 ]; then
     echo "Illegal number of parameters"
     echo "Usage: ./build_champsim.sh [branch_pred] [l1d_pref] [l2c_pref] [llc_pref] [llc_repl] [num_core] [assoc_config]"
+    echo "       ./build_champsim.sh registry [num_core]"
     exit 1
 fi
 
@@ -78,12 +129,35 @@ else
 fi
 echo
 
-# Change prefetchers and replacement policy
-cp branch/${BRANCH}.bpred branch/branch_predictor.cc
-cp prefetcher/${L1D_PREFETCHER}.l1d_pref prefetcher/l1d_prefetcher.cc
-cp prefetcher/${L2C_PREFETCHER}.l2c_pref prefetcher/l2c_prefetcher.cc
-cp prefetcher/${LLC_PREFETCHER}.llc_pref prefetcher/llc_prefetcher.cc
-cp replacement/${LLC_REPLACEMENT}.llc_repl replacement/llc_replacement.cc
+if [ "$REGISTRY" == "1" ]; then
+    # generate the wrappers of all components instead of copying one of each
+    rm -f branch/branch_predictor.cc prefetcher/l1d_prefetcher.cc prefetcher/l2c_prefetcher.cc prefetcher/llc_prefetcher.cc replacement/llc_replacement.cc
+    rm -rf component
+    mkdir component
+    for NAME in ${REGISTRY_BRANCH}; do
+        make_component branch/${NAME}.bpred branch BRANCH_COMPONENT branch_predictors BRANCH_HOOKS O3_CPU
+    done
+    for NAME in ${REGISTRY_L1D_PREFETCHER}; do
+        make_component prefetcher/${NAME}.l1d_pref l1d PREFETCHER_COMPONENT l1d_prefetchers L1D_PREFETCHER_HOOKS CACHE
+    done
+    for NAME in ${REGISTRY_L2C_PREFETCHER}; do
+        make_component prefetcher/${NAME}.l2c_pref l2c PREFETCHER_COMPONENT l2c_prefetchers L2C_PREFETCHER_HOOKS CACHE
+    done
+    for NAME in ${REGISTRY_LLC_PREFETCHER}; do
+        make_component prefetcher/${NAME}.llc_pref llc PREFETCHER_COMPONENT llc_prefetchers LLC_PREFETCHER_HOOKS CACHE
+    done
+    for NAME in ${REGISTRY_LLC_REPLACEMENT}; do
+        make_component replacement/${NAME}.llc_repl llc_repl REPLACEMENT_COMPONENT llc_replacements LLC_REPLACEMENT_HOOKS CACHE
+    done
+    sed -i.bak 's/^\/\/#define COMPONENT_REGISTRY/#define COMPONENT_REGISTRY/g' inc/champsim.h
+else
+    # Change prefetchers and replacement policy
+    cp branch/${BRANCH}.bpred branch/branch_predictor.cc
+    cp prefetcher/${L1D_PREFETCHER}.l1d_pref prefetcher/l1d_prefetcher.cc
+    cp prefetcher/${L2C_PREFETCHER}.l2c_pref prefetcher/l2c_prefetcher.cc
+    cp prefetcher/${LLC_PREFETCHER}.llc_pref prefetcher/llc_prefetcher.cc
+    cp replacement/${LLC_REPLACEMENT}.llc_repl replacement/llc_replacement.cc
+fi
 
 # Build
 mkdir -p bin
@@ -100,13 +174,22 @@ if [ ! -f bin/champsim ]; then
 fi
 
 echo "${BOLD}ChampSim is successfully built"
-echo "Branch Predictor: ${BRANCH}"
-echo "L1D Prefetcher: ${L1D_PREFETCHER}"
-echo "L2C Prefetcher: ${L2C_PREFETCHER}"
-echo "LLC Prefetcher: ${LLC_PREFETCHER}"
-echo "LLC Replacement: ${LLC_REPLACEMENT}"
+if [ "$REGISTRY" == "1" ]; then
+    echo "Branch Predictors: ${REGISTRY_BRANCH}"
+    echo "L1D Prefetchers: ${REGISTRY_L1D_PREFETCHER}"
+    echo "L2C Prefetchers: ${REGISTRY_L2C_PREFETCHER}"
+    echo "LLC Prefetchers: ${REGISTRY_LLC_PREFETCHER}"
+    echo "LLC Replacements: ${REGISTRY_LLC_REPLACEMENT}"
+    BINARY_NAME="registry-${NUM_CORE}core"
+else
+    echo "Branch Predictor: ${BRANCH}"
+    echo "L1D Prefetcher: ${L1D_PREFETCHER}"
+    echo "L2C Prefetcher: ${L2C_PREFETCHER}"
+    echo "LLC Prefetcher: ${LLC_PREFETCHER}"
+    echo "LLC Replacement: ${LLC_REPLACEMENT}"
+    BINARY_NAME="${BRANCH}-${L1D_PREFETCHER}-${L2C_PREFETCHER}-${LLC_PREFETCHER}-${LLC_REPLACEMENT}-${NUM_CORE}core"
+fi
 echo "Cores: ${NUM_CORE}"
-BINARY_NAME="${BRANCH}-${L1D_PREFETCHER}-${L2C_PREFETCHER}-${LLC_PREFETCHER}-${LLC_REPLACEMENT}-${NUM_CORE}core"
 echo "Binary: bin/${BINARY_NAME}"
 echo ""
 mv bin/champsim bin/${BINARY_NAME}
@@ -116,6 +199,8 @@ mv bin/champsim bin/${BINARY_NAME}
 sed -i.bak 's/\<NUM_CPUS '${NUM_CORE}'\>/NUM_CPUS 1/g' inc/champsim.h
 sed -i.bak 's/\<DRAM_CHANNELS 2\>/DRAM_CHANNELS 1/g' inc/champsim.h
 sed -i.bak 's/\<DRAM_CHANNELS_LOG2 1\>/DRAM_CHANNELS_LOG2 0/g' inc/champsim.h
+sed -i.bak 's/^#define COMPONENT_REGISTRY/\/\/#define COMPONENT_REGISTRY/g' inc/champsim.h
+rm -rf component
 
 cp branch/bimodal.bpred branch/branch_predictor.cc
 cp prefetcher/no.l1d_pref prefetcher/l1d_prefetcher.cc
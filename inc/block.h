@@ -25,9 +25,6 @@ class BLOCK {
              cpu,
              instr_id;
 
-    // replacement state
-    uint32_t lru;
-
     BLOCK() {
         valid = 0;
         prefetch = 0;
@@ -45,8 +42,6 @@ class BLOCK {
         data = 0;
         cpu = 0;
         instr_id = 0;
-
-        lru = 0;
     };
 };
 
@@ -60,106 +55,141 @@ class DRAM_ARRAY {
     };
 };
 
+// ROB, LQ and SQ indexes of the requests merged into a packet
+class DEPENDENCY {
+  public:
+    fastset<ROB_SIZE> rob_index_depend_on_me;
+    fastset<LQ_SIZE> lq_index_depend_on_me;
+    fastset<SQ_SIZE> sq_index_depend_on_me;
+};
+
+// dependency sets of the queues of one cache, referred to by handle from PACKET::depend_on_me
+// a handle moves with the packet from queue to queue within the cache and is released when its entry is removed,
+// so it is never shared and is never seen by another cache
+class DEPENDENCY_POOL {
+  public:
+    const string NAME;
+    const uint32_t SIZE;
+    uint32_t num_free;
+
+    // entry[0] is always empty, it stands for the sets of a packet without a handle
+    DEPENDENCY *entry;
+    uint32_t *free_list;
+
+    // constructor
+    DEPENDENCY_POOL(string v1, uint32_t v2) : NAME(v1), SIZE(v2 + 1) {
+        entry = new DEPENDENCY[SIZE];
+        free_list = new uint32_t[SIZE];
+
+        num_free = 0;
+        for (uint32_t i=SIZE-1; i>0; i--)
+            free_list[num_free++] = i;
+    };
+
+    // destructor
+    ~DEPENDENCY_POOL() {
+        delete[] entry;
+        delete[] free_list;
+    };
+
+    // functions
+    uint32_t allocate();
+    void release(uint32_t handle);
+};
+
 // message packet
+// the fields used on every queue lookup and scan come first, a packet fits in two cache lines
 class PACKET {
   public:
-    uint8_t instruction, 
-            tlb_access,
-            scheduled,
-            translated,
-            fetched,
-            prefetched,
-            drc_tag_read;
+    uint64_t address, 
+             full_addr, 
+             ip, 
+             instr_id,
+             event_cycle;
+
+    uint32_t cpu, lq_index, sq_index;
 
     int fill_level, 
-        pf_origin_level,
-        rob_signal, 
-        rob_index, 
-        producer,
-        delta,
-        depth,
-        signature,
-        confidence;
+        rob_index;
 
-    uint64_t pf_metadata;
+    uint8_t  type,
+             returned,
+             instruction, 
+             tlb_access;
 
-    uint8_t  is_producer, 
-             //rob_index_depend_on_me[ROB_SIZE], 
-             //lq_index_depend_on_me[ROB_SIZE], 
-             //sq_index_depend_on_me[ROB_SIZE], 
+    uint64_t data,
+             instruction_pa,
+             data_pa,
+             pf_metadata;
+
+    int pf_origin_level;
+
+    uint32_t data_index,
+             depend_on_me; // handle into the DEPENDENCY_POOL of the cache, 0 if nothing is merged
+
+    // carried from the prefetcher to the cache block
+    int16_t delta,
+            depth,
+            signature,
+            confidence;
+
+    uint8_t  scheduled,
+             translated,
+             fetched,
              instr_merged,
              load_merged, 
              store_merged,
-             returned,
-             asid[2],
-             type;
+             asid[2];
 
-    fastset
-             rob_index_depend_on_me, 
-             lq_index_depend_on_me, 
-             sq_index_depend_on_me;
+    PACKET() {
+        address = 0;
+        full_addr = 0;
+        ip = 0;
+        instr_id = 0;
+        event_cycle = UINT64_MAX;
 
-    uint32_t cpu, data_index, lq_index, sq_index;
+        cpu = NUM_CPUS;
+        lq_index = 0;
+        sq_index = 0;
 
-    uint64_t address, 
-             full_addr, 
-             instruction_pa,
-             data_pa,
-             data,
-             instr_id,
-             ip, 
-             event_cycle;
+        fill_level = -1; 
+        rob_index = -1;
 
-    PACKET() {
+        type = 0;
+        returned = 0;
         instruction = 0;
         tlb_access = 0;
-        scheduled = 0;
-        translated = 0;
-        fetched = 0;
-        prefetched = 0;
-        drc_tag_read = 0;
 
-        returned = 0;
-        asid[0] = UINT8_MAX;
-        asid[1] = UINT8_MAX;
-        type = 0;
+        data = 0;
+        instruction_pa = 0;
+        data_pa = 0;
+        pf_metadata = 0;
+
+        pf_origin_level = 0;
+        data_index = 0;
+        depend_on_me = 0;
 
-        fill_level = -1; 
-        rob_signal = -1;
-        rob_index = -1;
-        producer = -1;
         delta = 0;
         depth = 0;
         signature = 0;
         confidence = 0;
 
-#if 0
-        for (uint32_t i=0; i<ROB_SIZE; i++) {
-            rob_index_depend_on_me[i] = 0;
-            lq_index_depend_on_me[i] = 0;
-            sq_index_depend_on_me[i] = 0;
-        }
-#endif
-        is_producer = 0;
+        scheduled = 0;
+        translated = 0;
+        fetched = 0;
         instr_merged = 0;
         load_merged = 0;
         store_merged = 0;
-
-        cpu = NUM_CPUS;
-        data_index = 0;
-        lq_index = 0;
-        sq_index = 0;
-
-        address = 0;
-        full_addr = 0;
-        instruction_pa = 0;
-        data = 0;
-        instr_id = 0;
-        ip = 0;
-        event_cycle = UINT64_MAX;
+        asid[0] = UINT8_MAX;
+        asid[1] = UINT8_MAX;
     };
 };
 
+// packet queue lookup modes
+#define MATCH_NONE 0      // no address index, check_queue() scans the queue
+#define MATCH_ADDRESS 1   // merge requests to the same block address
+#define MATCH_FULL_ADDR 2 // merge requests to the same byte address (L1D write queue)
+
 // packet queue
 class PACKET_QUEUE {
   public:
@@ -168,7 +198,15 @@ class PACKET_QUEUE {
 
     uint8_t  is_RQ, 
              is_WQ,
-             write_mode;
+             write_mode,
+             match_mode;
+
+    // open-addressed hash index from address to queue slot, used by check_queue()
+    uint32_t index_mask;
+    int32_t *addr_index;
+
+    // dependency sets of the entries, shared by the queues of a cache, NULL in the DRAM queues
+    DEPENDENCY_POOL *depend_pool;
 
     uint32_t cpu, 
              head, 
@@ -193,7 +231,7 @@ class PACKET_QUEUE {
     PACKET *entry, processed_packet[2*MAX_READ_PER_CYCLE];
 
     // constructor
-    PACKET_QUEUE(string v1, uint32_t v2) : NAME(v1), SIZE(v2) {
+    PACKET_QUEUE(string v1, uint32_t v2, uint8_t v3 = MATCH_NONE, DEPENDENCY_POOL *v4 = NULL) : NAME(v1), SIZE(v2), match_mode(v3), depend_pool(v4) {
         is_RQ = 0;
         is_WQ = 0;
         write_mode = 0;
@@ -220,11 +258,28 @@ class PACKET_QUEUE {
         FULL = 0;
 
         entry = new PACKET[SIZE]; 
+
+        // keep the index at most half full
+        index_mask = 0;
+        addr_index = NULL;
+        if (match_mode != MATCH_NONE) {
+            uint32_t index_size = 1;
+            while (index_size < 2*SIZE)
+                index_size <<= 1;
+            index_mask = index_size - 1;
+            addr_index = new int32_t[index_size];
+            for (uint32_t i=0; i<index_size; i++)
+                addr_index[i] = -1;
+        }
     };
 
     PACKET_QUEUE() {
         is_RQ = 0;
         is_WQ = 0;
+        match_mode = MATCH_NONE;
+        index_mask = 0;
+        addr_index = NULL;
+        depend_pool = NULL;
 
         cpu = 0; 
         head = 0;
@@ -253,12 +308,22 @@ class PACKET_QUEUE {
     // destructor
     ~PACKET_QUEUE() {
         delete[] entry;
+        delete[] addr_index;
     };
 
     // functions
     int check_queue(PACKET* packet);
     void add_queue(PACKET* packet),
-         remove_queue(PACKET* packet);
+         remove_queue(PACKET* packet),
+         assign(uint32_t index, PACKET *packet);
+
+    DEPENDENCY &add_dependency(uint32_t index),
+               &get_dependency(uint32_t index);
+
+    uint64_t get_key(PACKET *packet);
+    uint32_t get_bucket(uint64_t key);
+    void index_insert(uint32_t slot),
+         index_erase(uint32_t slot);
 };
 
 // reorder buffer
@@ -331,7 +396,7 @@ class LSQ_ENTRY {
             fetched,
             asid[2];
 // forwarding_depend_on_me[ROB_SIZE];
-    fastset
+    fastset<ROB_SIZE>
 		forwarding_depend_on_me;
 
     // constructor
@@ -78,6 +78,11 @@ extern uint32_t PAGE_TABLE_LATENCY, SWAP_LATENCY;
 #define LLC_PQ_SIZE NUM_CPUS*32
 #define LLC_MSHR_SIZE NUM_CPUS*32
 #define LLC_LATENCY 12  // 4 (L1I or L1D) + 8 + 20 = 32 cycles
+#define LLC_METADATA_READ_SIZE NUM_CPUS*32
+#define ONCHIP_METADATA_SPACE (1ull << 62) // keeps the on-chip metadata requests apart from the data in the LLC queues
+
+class PREFETCHER_COMPONENT;
+class REPLACEMENT_COMPONENT;
 
 class CACHE : public MEMORY {
   public:
@@ -86,11 +91,37 @@ class CACHE : public MEMORY {
     const uint32_t NUM_SET, NUM_WAY, NUM_LINE, WQ_SIZE, RQ_SIZE, PQ_SIZE, MSHR_SIZE;
     uint32_t LATENCY;
     BLOCK **block;
+
+    // hot tag store, NUM_WAY contiguous entries per set so a whole set is matched at once
+    // block keeps the cold metadata and a copy of tag/valid for the replacement policies
+    uint64_t *tag_array,
+             *valid_mask;
+    uint32_t *lru_array;
     int fill_level;
     uint32_t MAX_READ, MAX_FILL;
     uint8_t cache_type;
 
+    // the data lines only use the ways below current_assoc, the ways above hold the on-chip metadata of
+    // the L2C prefetcher (Triage), which the LLC answers as hits in LLC_LATENCY through its metadata read port and WQ
+    // set_current_assoc() moves the boundary, the data lines in the ways it takes are evicted and
+    // the dirty ones wait in partition_writeback for room in the lower level WQ
     uint32_t current_assoc;
+    deque<PACKET> partition_writeback;
+    // the metadata read port, the reads are answered in order after LATENCY, MAX_READ per cycle,
+    // ahead of the PQ and whether or not the RQ is busy
+    deque<PACKET> metadata_read;
+    uint64_t partition_resizes,
+             partition_evictions,
+             partition_writebacks;
+
+    // set while the trace is fast-forwarded (fast_forward.h), the prefetch and metadata requests
+    // of the prefetchers are filled right away instead of going through the queues
+    uint8_t functional;
+
+    // with -threads the L2C runs outside the shared section of its core (core_scheduler.h), it enters it
+    // around every access to the LLC and around the prefetcher hooks, unless the prefetcher sets
+    // prefetcher_per_core because it keeps all of its state per core and enters the section itself
+    uint8_t prefetcher_per_core;
 
     // prefetch stats
     uint64_t pf_requested,
@@ -99,12 +130,20 @@ class CACHE : public MEMORY {
              pf_useless,
              pf_fill;
 
+    // prefetcher and replacement policy picked at startup in a registry build (component.h)
+    PREFETCHER_COMPONENT *prefetcher_component;
+    REPLACEMENT_COMPONENT *replacement_component;
+
+    // merged requests of the queues, every queue entry holds at most one handle
+    DEPENDENCY_POOL depend_pool{NAME + "_DEPEND", WQ_SIZE + RQ_SIZE + PQ_SIZE + MSHR_SIZE + ROB_SIZE};
+
     // queues
-    PACKET_QUEUE WQ{NAME + "_WQ", WQ_SIZE}, // write queue
-                 RQ{NAME + "_RQ", RQ_SIZE}, // read queue
-                 PQ{NAME + "_PQ", PQ_SIZE}, // prefetch queue
-                 MSHR{NAME + "_MSHR", MSHR_SIZE}, // MSHR
-                 PROCESSED{NAME + "_PROCESSED", ROB_SIZE}; // processed queue
+    // the L1D write queue merges stores to the same byte address, all others merge by block address
+    PACKET_QUEUE WQ{NAME + "_WQ", WQ_SIZE, (uint8_t)((NAME == "L1D") ? MATCH_FULL_ADDR : MATCH_ADDRESS), &depend_pool}, // write queue
+                 RQ{NAME + "_RQ", RQ_SIZE, MATCH_ADDRESS, &depend_pool}, // read queue
+                 PQ{NAME + "_PQ", PQ_SIZE, MATCH_ADDRESS, &depend_pool}, // prefetch queue
+                 MSHR{NAME + "_MSHR", MSHR_SIZE, MATCH_NONE, &depend_pool}, // MSHR
+                 PROCESSED{NAME + "_PROCESSED", ROB_SIZE, MATCH_NONE, &depend_pool}; // processed queue
 
     uint64_t sim_access[NUM_CPUS][NUM_TYPES],
              sim_hit[NUM_CPUS][NUM_TYPES],
@@ -119,14 +158,29 @@ class CACHE : public MEMORY {
 
         LATENCY = 0;
         current_assoc = NUM_WAY;
+        partition_resizes = 0;
+        partition_evictions = 0;
+        partition_writebacks = 0;
+
+        // the valid bits of a set are kept in a single word
+        if (NUM_WAY > 64) {
+            cerr << "[" << NAME << "] NUM_WAY: " << NUM_WAY << " is larger than 64" << endl;
+            assert(0);
+        }
 
         // cache block
         block = new BLOCK* [NUM_SET];
-        for (uint32_t i=0; i<NUM_SET; i++) {
+        for (uint32_t i=0; i<NUM_SET; i++)
             block[i] = new BLOCK[NUM_WAY]; 
 
+        tag_array = new uint64_t[NUM_SET*NUM_WAY];
+        valid_mask = new uint64_t[NUM_SET];
+        lru_array = new uint32_t[NUM_SET*NUM_WAY];
+        for (uint32_t i=0; i<NUM_SET; i++) {
+            valid_mask[i] = 0;
             for (uint32_t j=0; j<NUM_WAY; j++) {
-                block[i][j].lru = j;
+                tag_array[i*NUM_WAY + j] = 0;
+                lru_array[i*NUM_WAY + j] = j;
             }
         }
 
@@ -155,6 +209,12 @@ class CACHE : public MEMORY {
         pf_useful = 0;
         pf_useless = 0;
         pf_fill = 0;
+
+        prefetcher_component = NULL;
+        replacement_component = NULL;
+
+        functional = 0;
+        prefetcher_per_core = 0;
     };
 
     // destructor
@@ -162,6 +222,10 @@ class CACHE : public MEMORY {
         for (uint32_t i=0; i<NUM_SET; i++)
             delete[] block[i];
         delete[] block;
+
+        delete[] tag_array;
+        delete[] valid_mask;
+        delete[] lru_array;
     };
 
     // functions
@@ -176,6 +240,11 @@ class CACHE : public MEMORY {
     uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
              get_size(uint8_t queue_type, uint64_t address);
 
+    uint64_t get_next_event_cycle();
+
+    uint8_t functional_access(uint32_t access_cpu, uint64_t full_addr, uint64_t ip, uint8_t type, uint8_t train, uint64_t pf_metadata = 0);
+    void functional_translate(uint32_t access_cpu, uint64_t vpage, uint64_t va, uint64_t ppage);
+
     int  check_hit(PACKET *packet),
          invalidate_entry(uint64_t inval_addr),
          check_mshr(PACKET *packet),
@@ -209,9 +278,18 @@ class CACHE : public MEMORY {
          l2c_prefetcher_final_stats(),
          llc_prefetcher_final_stats();
 
+    void checkpoint(CHECKPOINT &cp),
+         register_stats(),
+         llc_replacement_checkpoint(CHECKPOINT &cp),
+         l1d_prefetcher_checkpoint(CHECKPOINT &cp),
+         l2c_prefetcher_checkpoint(CHECKPOINT &cp),
+         llc_prefetcher_checkpoint(CHECKPOINT &cp);
+
     uint64_t l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in),
+         l2c_prefetcher_access(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in),
          llc_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in),
          l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in),
+         l2c_prefetcher_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in),
          llc_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in);
     
     uint32_t get_set(uint64_t address),
@@ -222,6 +300,17 @@ class CACHE : public MEMORY {
 
     int get_metadata(uint64_t phy_addr);
     int write_metadata(uint64_t phy_addr);
+    int read_onchip_metadata(uint64_t meta_data_addr),
+        write_onchip_metadata(uint64_t meta_data_addr),
+        add_metadata_read(PACKET *packet);
+    void handle_metadata_read(),
+         set_current_assoc(uint32_t assoc),
+         drain_partition_writeback(),
+         print_partition_stats(),
+         enter_shared(),
+         leave_shared(),
+         enter_prefetcher(),
+         leave_prefetcher();
     void complete_metadata_req(uint64_t phy_addr);
 
 };
@@ -18,6 +18,7 @@
 #include <random>
 #include <string>
 #include <iomanip>
+#include <sstream>
 
 // USEFUL MACROS
 //#define DEBUG_PRINT
@@ -25,6 +26,8 @@
 #define LLC_BYPASS
 #define DRC_BYPASS
 #define NO_CRC2_COMPILE
+//#define COMPONENT_REGISTRY // set by ./build_champsim.sh registry, all components in one binary
+//#define HOST_PROFILE // time the host cost of the simulator components (inc/profile.h), or CFLAGS=-DHOST_PROFILE ./build_champsim.sh ...
 
 #ifdef DEBUG_PRINT
 #define DP(x) x
@@ -73,13 +76,25 @@
 
 using namespace std;
 
+#include "checkpoint.h"
+#include "page_table.h"
+#include "core_scheduler.h"
+#include "sweep.h"
+#include "stats.h"
+#include "profile.h"
+#include "prefetcher_bench.h"
+#include "fast_forward.h"
+#include "sampler.h"
+
 extern uint8_t warmup_complete[NUM_CPUS], 
                simulation_complete[NUM_CPUS], 
                all_warmup_complete, 
                all_simulation_complete,
                MAX_INSTR_DESTINATIONS,
                knob_cloudsuite,
-               knob_low_bandwidth;
+               knob_low_bandwidth,
+               knob_event_driven,
+               knob_functional_warmup;
 
 extern uint64_t current_core_cycle[NUM_CPUS], 
                 stall_cycle[NUM_CPUS], 
@@ -87,11 +102,14 @@ extern uint64_t current_core_cycle[NUM_CPUS],
                 last_drc_write_mode,
                 drc_blocks;
 
-extern queue <uint64_t> page_queue;
-extern map <uint64_t, uint64_t> page_table, inverse_table, recent_page, unique_cl[NUM_CPUS];
+extern PAGE_HASH page_table, inverse_table, unique_cl[NUM_CPUS];
+extern PAGE_CLOCK page_clock;
 extern uint64_t previous_ppage, num_adjacent_page, num_cl[NUM_CPUS], allocated_pages, num_page[NUM_CPUS], minor_fault[NUM_CPUS], major_fault[NUM_CPUS];
 
-void print_stats();
+void print_stats(),
+     operate_core(uint32_t cpu),
+     check_core(uint32_t cpu),
+     complete_simulation(uint32_t cpu);
 uint64_t rotl64 (uint64_t n, unsigned int c),
          rotr64 (uint64_t n, unsigned int c),
          va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_vpage);
@@ -113,6 +131,21 @@ class RANDOM {
     uint64_t draw_rand() {
         return dist(engine);
     };
+
+    // the engine state is only available as text
+    void checkpoint(CHECKPOINT &cp) {
+        stringstream state;
+        if (cp.saving())
+            state << engine;
+
+        string text = state.str();
+        cp.io(text);
+
+        if (cp.restoring()) {
+            state.str(text);
+            state >> engine;
+        }
+    };
 };
 extern uint64_t champsim_seed;
 #endif
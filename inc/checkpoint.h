@@ -0,0 +1,143 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <type_traits>
+#include <zlib.h>
+
+using namespace std;
+
+// checkpoint
+#define CHECKPOINT_MAGIC 0x54504b43484d4143ULL // "CAMHCKPT"
+#define CHECKPOINT_VERSION 9
+
+#define CHECKPOINT_SAVE 0
+#define CHECKPOINT_RESTORE 1
+
+// gzip compressed binary snapshot of the warmed-up state
+// each component describes its state once through io(), which writes it when saving and reads it back when restoring
+// components that are not trivially copyable provide a checkpoint(CHECKPOINT &cp) member
+// the pipeline, queues and MSHRs are not saved, a restored core refetches from its oldest unretired instruction,
+// so the region of interest starts in another phase of the trace than in the run that saved the checkpoint:
+// its IPC differs by up to about 1% on memory-bound traces, in either direction depending on the save point
+class CHECKPOINT {
+  public:
+    const string NAME;
+    const uint8_t mode;
+    gzFile file;
+
+    // constructor
+    CHECKPOINT(string v1, uint8_t v2) : NAME(v1), mode(v2) {
+        file = NULL;
+        open();
+    };
+
+    // destructor
+    ~CHECKPOINT() {
+        if (file)
+            gzclose(file);
+    };
+
+    // functions
+    void open(),
+         raw(void *data, size_t size),
+         section(string tag),
+         check(uint64_t value, string what),
+         not_supported(string what);
+
+    uint8_t saving() { return mode == CHECKPOINT_SAVE; };
+    uint8_t restoring() { return mode == CHECKPOINT_RESTORE; };
+
+    template <typename T>
+    typename enable_if<is_trivially_copyable<T>::value>::type io(T &value) {
+        raw(&value, sizeof(T));
+    };
+
+    template <typename T>
+    typename enable_if<!is_trivially_copyable<T>::value>::type io(T &value) {
+        value.checkpoint(*this);
+    };
+
+    template <typename T>
+    void io_array(T *data, uint64_t count) {
+        if (is_trivially_copyable<T>::value)
+            raw(data, sizeof(T) * count);
+        else {
+            for (uint64_t i=0; i<count; i++)
+                io(data[i]);
+        }
+    };
+
+    // containers are written as their size followed by the elements
+    uint64_t io_size(uint64_t size) {
+        io(size);
+        return size;
+    };
+
+    void io(string &value) {
+        uint64_t size = io_size(value.size());
+        value.resize(size);
+        if (size)
+            raw(&value[0], size);
+    };
+
+    template <typename T>
+    void io(vector<T> &value) {
+        uint64_t size = io_size(value.size());
+        value.resize(size);
+        for (uint64_t i=0; i<size; i++)
+            io(value[i]);
+    };
+
+    template <typename T>
+    void io(deque<T> &value) {
+        uint64_t size = io_size(value.size());
+        value.resize(size);
+        for (uint64_t i=0; i<size; i++)
+            io(value[i]);
+    };
+
+    template <typename K, typename V>
+    void io(map<K, V> &value) {
+        uint64_t size = io_size(value.size());
+        if (saving()) {
+            for (auto it = value.begin(); it != value.end(); it++) {
+                K key = it->first;
+                io(key);
+                io(it->second);
+            }
+        } else {
+            value.clear();
+            for (uint64_t i=0; i<size; i++) {
+                K key;
+                io(key);
+                io(value[key]);
+            }
+        }
+    };
+
+    template <typename K>
+    void io(set<K> &value) {
+        uint64_t size = io_size(value.size());
+        if (saving()) {
+            for (auto it = value.begin(); it != value.end(); it++) {
+                K key = *it;
+                io(key);
+            }
+        } else {
+            value.clear();
+            for (uint64_t i=0; i<size; i++) {
+                K key;
+                io(key);
+                value.insert(value.end(), key);
+            }
+        }
+    };
+};
+
+#endif
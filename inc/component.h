@@ -0,0 +1,233 @@
+#ifndef COMPONENT_H
+#define COMPONENT_H
+
+// the component files are compiled inside a namespace, so every library header they may use is included up front
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <cassert>
+#include <algorithm>
+#include <bitset>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ooo_cpu.h"
+
+// component registry
+// a registry build compiles every branch predictor, prefetcher and replacement policy into the same binary
+// each one registers its hooks under its file name, and the knobs pick one of each at startup
+class BRANCH_COMPONENT {
+  public:
+    void (*initialize)(O3_CPU *cpu);
+    uint8_t (*predict)(O3_CPU *cpu, uint64_t ip);
+    void (*last_result)(O3_CPU *cpu, uint64_t ip, uint8_t taken);
+    void (*checkpoint)(O3_CPU *cpu, CHECKPOINT &cp);
+};
+
+// the L1D hooks take and return no metadata, they are adapted to the L2C and LLC signature
+class PREFETCHER_COMPONENT {
+  public:
+    void (*initialize)(CACHE *cache);
+    uint64_t (*operate)(CACHE *cache, uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in);
+    uint64_t (*cache_fill)(CACHE *cache, uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in);
+    void (*final_stats)(CACHE *cache);
+    void (*checkpoint)(CACHE *cache, CHECKPOINT &cp);
+
+    // only the L2C prefetchers request metadata from the LLC
+    void (*complete_metadata_req)(CACHE *cache, uint64_t meta_data_addr);
+};
+
+class REPLACEMENT_COMPONENT {
+  public:
+    void (*initialize)(CACHE *cache);
+    uint32_t (*find_victim)(CACHE *cache, uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type);
+    void (*update_state)(CACHE *cache, uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit);
+    void (*final_stats)(CACHE *cache);
+    void (*checkpoint)(CACHE *cache, CHECKPOINT &cp);
+};
+
+template <typename T>
+class REGISTRY {
+  public:
+    const string KIND;
+    map<string, T> components;
+
+    // constructor
+    REGISTRY(string v1) : KIND(v1) {};
+
+    void add(string name, T component) {
+        if (components.count(name)) {
+            cerr << "[COMPONENT] " << KIND << " " << name << " is registered twice" << endl;
+            assert(0);
+        }
+        components[name] = component;
+    };
+
+    T *find(string name) {
+        auto it = components.find(name);
+        if (it == components.end()) {
+            cerr << "[COMPONENT] unknown " << KIND << " " << name << ", this binary has:";
+            for (it = components.begin(); it != components.end(); it++)
+                cerr << " " << it->first;
+            cerr << endl;
+            assert(0);
+        }
+        return &it->second;
+    };
+};
+
+// the registries are filled by static constructors in other files, so they are created on first use
+REGISTRY<BRANCH_COMPONENT> &branch_predictors();
+REGISTRY<PREFETCHER_COMPONENT> &l1d_prefetchers(),
+                                         &l2c_prefetchers(),
+                                         &llc_prefetchers();
+REGISTRY<REPLACEMENT_COMPONENT> &llc_replacements();
+
+template <typename T>
+class REGISTRAR {
+  public:
+    REGISTRAR(REGISTRY<T> &registry, string name, T component) {
+        registry.add(name, component);
+    };
+};
+
+// hooks of a component, C is the CACHE or O3_CPU class declared in its namespace (component_scope.h)
+// that class only adds member functions, so the simulator objects can be used as one
+template <class C>
+class BRANCH_HOOKS {
+  public:
+    static void initialize(O3_CPU *cpu) { static_cast<C *>(cpu)->initialize_branch_predictor(); };
+    static uint8_t predict(O3_CPU *cpu, uint64_t ip) { return static_cast<C *>(cpu)->predict_branch(ip); };
+    static void last_result(O3_CPU *cpu, uint64_t ip, uint8_t taken) { static_cast<C *>(cpu)->last_branch_result(ip, taken); };
+    static void checkpoint(O3_CPU *cpu, CHECKPOINT &cp) { static_cast<C *>(cpu)->checkpoint_branch_predictor(cp); };
+
+    static BRANCH_COMPONENT component() {
+        BRANCH_COMPONENT hooks;
+        hooks.initialize = initialize;
+        hooks.predict = predict;
+        hooks.last_result = last_result;
+        hooks.checkpoint = checkpoint;
+        return hooks;
+    };
+};
+
+template <class C>
+class L1D_PREFETCHER_HOOKS {
+  public:
+    static void initialize(CACHE *cache) { static_cast<C *>(cache)->l1d_prefetcher_initialize(); };
+    static uint64_t operate(CACHE *cache, uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in) {
+        static_cast<C *>(cache)->l1d_prefetcher_operate(addr, ip, cache_hit, type);
+        return metadata_in;
+    };
+    static uint64_t cache_fill(CACHE *cache, uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in) {
+        static_cast<C *>(cache)->l1d_prefetcher_cache_fill(addr, set, way, prefetch, evicted_addr, metadata_in);
+        return metadata_in;
+    };
+    static void final_stats(CACHE *cache) { static_cast<C *>(cache)->l1d_prefetcher_final_stats(); };
+    static void checkpoint(CACHE *cache, CHECKPOINT &cp) { static_cast<C *>(cache)->l1d_prefetcher_checkpoint(cp); };
+
+    static PREFETCHER_COMPONENT component() {
+        PREFETCHER_COMPONENT hooks;
+        hooks.initialize = initialize;
+        hooks.operate = operate;
+        hooks.cache_fill = cache_fill;
+        hooks.final_stats = final_stats;
+        hooks.checkpoint = checkpoint;
+        hooks.complete_metadata_req = NULL;
+        return hooks;
+    };
+};
+
+template <class C>
+class L2C_PREFETCHER_HOOKS {
+  public:
+    static void initialize(CACHE *cache) { static_cast<C *>(cache)->l2c_prefetcher_initialize(); };
+    static uint64_t operate(CACHE *cache, uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in) {
+        return static_cast<C *>(cache)->l2c_prefetcher_operate(addr, ip, cache_hit, type, metadata_in);
+    };
+    static uint64_t cache_fill(CACHE *cache, uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in) {
+        return static_cast<C *>(cache)->l2c_prefetcher_cache_fill(addr, set, way, prefetch, evicted_addr, metadata_in);
+    };
+    static void final_stats(CACHE *cache) { static_cast<C *>(cache)->l2c_prefetcher_final_stats(); };
+    static void checkpoint(CACHE *cache, CHECKPOINT &cp) { static_cast<C *>(cache)->l2c_prefetcher_checkpoint(cp); };
+
+    // complete_metadata_req is virtual, the qualified call skips the dispatch back to the registry
+    static void complete_metadata_req(CACHE *cache, uint64_t meta_data_addr) { static_cast<C *>(cache)->C::complete_metadata_req(meta_data_addr); };
+
+    static PREFETCHER_COMPONENT component() {
+        PREFETCHER_COMPONENT hooks;
+        hooks.initialize = initialize;
+        hooks.operate = operate;
+        hooks.cache_fill = cache_fill;
+        hooks.final_stats = final_stats;
+        hooks.checkpoint = checkpoint;
+        hooks.complete_metadata_req = complete_metadata_req;
+        return hooks;
+    };
+};
+
+template <class C>
+class LLC_PREFETCHER_HOOKS {
+  public:
+    static void initialize(CACHE *cache) { static_cast<C *>(cache)->llc_prefetcher_initialize(); };
+    static uint64_t operate(CACHE *cache, uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in) {
+        return static_cast<C *>(cache)->llc_prefetcher_operate(addr, ip, cache_hit, type, metadata_in);
+    };
+    static uint64_t cache_fill(CACHE *cache, uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in) {
+        return static_cast<C *>(cache)->llc_prefetcher_cache_fill(addr, set, way, prefetch, evicted_addr, metadata_in);
+    };
+    static void final_stats(CACHE *cache) { static_cast<C *>(cache)->llc_prefetcher_final_stats(); };
+    static void checkpoint(CACHE *cache, CHECKPOINT &cp) { static_cast<C *>(cache)->llc_prefetcher_checkpoint(cp); };
+
+    static PREFETCHER_COMPONENT component() {
+        PREFETCHER_COMPONENT hooks;
+        hooks.initialize = initialize;
+        hooks.operate = operate;
+        hooks.cache_fill = cache_fill;
+        hooks.final_stats = final_stats;
+        hooks.checkpoint = checkpoint;
+        hooks.complete_metadata_req = NULL;
+        return hooks;
+    };
+};
+
+template <class C>
+class LLC_REPLACEMENT_HOOKS {
+  public:
+    static void initialize(CACHE *cache) { static_cast<C *>(cache)->llc_initialize_replacement(); };
+    static uint32_t find_victim(CACHE *cache, uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type) {
+        return static_cast<C *>(cache)->llc_find_victim(cpu, instr_id, set, current_set, ip, full_addr, type);
+    };
+    static void update_state(CACHE *cache, uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit) {
+        static_cast<C *>(cache)->llc_update_replacement_state(cpu, set, way, full_addr, ip, victim_addr, type, hit);
+    };
+    static void final_stats(CACHE *cache) { static_cast<C *>(cache)->llc_replacement_final_stats(); };
+    static void checkpoint(CACHE *cache, CHECKPOINT &cp) { static_cast<C *>(cache)->llc_replacement_checkpoint(cp); };
+
+    static REPLACEMENT_COMPONENT component() {
+        REPLACEMENT_COMPONENT hooks;
+        hooks.initialize = initialize;
+        hooks.find_victim = find_victim;
+        hooks.update_state = update_state;
+        hooks.final_stats = final_stats;
+        hooks.checkpoint = checkpoint;
+        return hooks;
+    };
+};
+
+#endif
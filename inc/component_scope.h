@@ -0,0 +1,37 @@
+// included at the top of the namespace of each component in a registry build, see component.h
+// the component file defines its hooks as members of these classes instead of the simulator classes
+
+class CACHE : public ::CACHE {
+  public:
+    void l1d_prefetcher_initialize(),
+         l1d_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type),
+         l1d_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in),
+         l1d_prefetcher_final_stats(),
+         l1d_prefetcher_checkpoint(CHECKPOINT &cp),
+         l2c_prefetcher_initialize(),
+         l2c_prefetcher_final_stats(),
+         l2c_prefetcher_checkpoint(CHECKPOINT &cp),
+         llc_prefetcher_initialize(),
+         llc_prefetcher_final_stats(),
+         llc_prefetcher_checkpoint(CHECKPOINT &cp),
+         llc_initialize_replacement(),
+         llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit),
+         llc_replacement_final_stats(),
+         llc_replacement_checkpoint(CHECKPOINT &cp),
+         complete_metadata_req(uint64_t meta_data_addr);
+
+    uint64_t l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in),
+             llc_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in),
+             l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in),
+             llc_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in);
+
+    uint32_t llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type);
+};
+
+class O3_CPU : public ::O3_CPU {
+  public:
+    uint8_t predict_branch(uint64_t ip);
+    void    initialize_branch_predictor(),
+            last_branch_result(uint64_t ip, uint8_t taken),
+            checkpoint_branch_predictor(CHECKPOINT &cp);
+};
@@ -0,0 +1,84 @@
+#ifndef CORE_SCHEDULER_H
+#define CORE_SCHEDULER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// threaded simulation
+#define DEFAULT_SYNC_QUANTUM 32 // cycles the cores run ahead of the uncore in the bounded-lag mode
+#define SPIN_LIMIT 64 // busy-wait iterations before a waiting thread yields its host core
+
+// runs the private pipeline and caches of each core on its own host thread
+// the LLC, DRAM and page table are shared, so the cores enter a shared section before touching them
+//
+// deterministic mode: the cores advance one cycle at a time and enter their shared sections in core order,
+// which reproduces the serial simulation exactly
+// bounded-lag mode: the cores run a quantum of cycles with the shared sections serialized by a lock,
+// then the uncore replays the quantum cycle by cycle
+class CORE_SCHEDULER {
+  public:
+    uint8_t enabled, deterministic, parallel;
+    uint64_t quantum, quantum_cycles, begin_cycle[NUM_CPUS];
+
+    // core 0 runs on the main thread
+    vector<thread> workers;
+    atomic<uint64_t> generation;
+    atomic<uint32_t> finished, token;
+    atomic<uint8_t> stop;
+
+    // the shared sections of a core nest, the lock is taken by the outermost one
+    mutex shared_lock;
+    uint8_t has_token[NUM_CPUS];
+    uint32_t shared_depth[NUM_CPUS];
+
+    // constructor
+    CORE_SCHEDULER() {
+        enabled = 0;
+        deterministic = 0;
+        parallel = 0;
+        quantum = DEFAULT_SYNC_QUANTUM;
+        quantum_cycles = 0;
+
+        generation = 0;
+        finished = 0;
+        token = 0;
+        stop = 0;
+
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            begin_cycle[i] = 0;
+            has_token[i] = 0;
+            shared_depth[i] = 0;
+        }
+    };
+
+    // destructor
+    ~CORE_SCHEDULER() {
+        // the simulation can exit from a signal handler while the workers wait for a quantum
+        for (uint32_t i=0; i<workers.size(); i++) {
+            if (workers[i].joinable())
+                workers[i].detach();
+        }
+    };
+
+    // functions
+    void start(),
+         finish(),
+         run_quantum(),
+         run_core(uint32_t cpu),
+         worker_loop(uint32_t cpu),
+         enter_shared(uint32_t cpu),
+         leave_shared(uint32_t cpu),
+         end_cycle(uint32_t cpu);
+
+    uint8_t defer_warmup(),
+            warmup_may_finish();
+};
+
+extern CORE_SCHEDULER core_scheduler;
+
+#endif
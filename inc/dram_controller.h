@@ -21,6 +21,22 @@ extern uint32_t DRAM_MTPS, DRAM_DBUS_RETURN_TIME;
 #define DRAM_WRITE_LOW_WM     (DRAM_WQ_SIZE*1/4)
 #define MIN_DRAM_WRITES_PER_SWITCH (DRAM_WQ_SIZE*1/4)
 
+// scheduling state of a DRAM queue entry, the address is decoded once when the request is queued
+class DRAM_SLOT {
+  public:
+    uint32_t rank, bank, row;
+
+    // next unscheduled request to the same bank, ordered by (event_cycle, index)
+    int next;
+
+    DRAM_SLOT() {
+        rank = 0;
+        bank = 0;
+        row = 0;
+        next = -1;
+    };
+};
+
 // DRAM
 class MEMORY_CONTROLLER : public MEMORY {
   public:
@@ -38,6 +54,10 @@ class MEMORY_CONTROLLER : public MEMORY {
     // queues
     PACKET_QUEUE WQ[DRAM_CHANNELS], RQ[DRAM_CHANNELS];
 
+    // per-bank lists of unscheduled requests, [0] for the RQ and [1] for the WQ
+    DRAM_SLOT *slot[2][DRAM_CHANNELS];
+    int bank_queue_head[2][DRAM_CHANNELS][DRAM_RANKS][DRAM_BANKS];
+
     // constructor
     MEMORY_CONTROLLER(string v1) : NAME (v1) {
         for (uint32_t i=0; i<NUM_TYPES+1; i++) {
@@ -55,8 +75,11 @@ class MEMORY_CONTROLLER : public MEMORY {
             scheduled_writes[i] = 0;
 
             for (uint32_t j=0; j<DRAM_RANKS; j++) {
-                for (uint32_t k=0; k<DRAM_BANKS; k++)
+                for (uint32_t k=0; k<DRAM_BANKS; k++) {
                     bank_cycle_available[i][j][k] = 0;
+                    bank_queue_head[0][i][j][k] = -1;
+                    bank_queue_head[1][i][j][k] = -1;
+                }
             }
 
             WQ[i].NAME = "DRAM_WQ" + to_string(i);
@@ -66,6 +89,9 @@ class MEMORY_CONTROLLER : public MEMORY {
             RQ[i].NAME = "DRAM_RQ" + to_string(i);
             RQ[i].SIZE = DRAM_RQ_SIZE;
             RQ[i].entry = new PACKET [DRAM_RQ_SIZE];
+
+            slot[0][i] = new DRAM_SLOT [DRAM_RQ_SIZE];
+            slot[1][i] = new DRAM_SLOT [DRAM_WQ_SIZE];
         }
 
         fill_level = FILL_DRAM;
@@ -73,7 +99,10 @@ class MEMORY_CONTROLLER : public MEMORY {
 
     // destructor
     ~MEMORY_CONTROLLER() {
-
+        for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+            delete[] slot[0][i];
+            delete[] slot[1][i];
+        }
     };
 
     // functions
@@ -88,10 +117,17 @@ class MEMORY_CONTROLLER : public MEMORY {
     uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
              get_size(uint8_t queue_type, uint64_t address);
 
+    void checkpoint(CHECKPOINT &cp),
+         register_stats();
+
     void schedule(PACKET_QUEUE *queue), process(PACKET_QUEUE *queue),
          update_schedule_cycle(PACKET_QUEUE *queue),
          update_process_cycle(PACKET_QUEUE *queue),
-         reset_remain_requests(PACKET_QUEUE *queue, uint32_t channel);
+         reset_remain_requests(PACKET_QUEUE *queue, uint32_t channel),
+         bank_queue_insert(PACKET_QUEUE *queue, uint32_t channel, uint32_t index),
+         bank_queue_remove(PACKET_QUEUE *queue, uint32_t channel, uint32_t index);
+
+    uint32_t get_queue_channel(PACKET_QUEUE *queue);
 
     uint32_t dram_get_channel(uint64_t address),
              dram_get_rank   (uint64_t address),
@@ -100,7 +136,8 @@ class MEMORY_CONTROLLER : public MEMORY {
              dram_get_column (uint64_t address),
              drc_check_hit (uint64_t address, uint32_t cpu, uint32_t channel, uint32_t rank, uint32_t bank, uint32_t row);
 
-    uint64_t get_bank_earliest_cycle();
+    uint64_t get_bank_earliest_cycle(),
+             get_next_event_cycle();
 
     int check_dram_queue(PACKET_QUEUE *queue, PACKET *packet);
 };
@@ -0,0 +1,55 @@
+#ifndef FAST_FORWARD_H
+#define FAST_FORWARD_H
+
+#include <stdint.h>
+
+using namespace std;
+
+// functional simulation of a core, the trace is read without the out-of-order model
+//
+// every instruction is translated through va_to_pa and the ITLB or DTLB and STLB (CACHE::functional_translate),
+// fetched from the L1I once per new cache block, its branch trains the branch predictor and its memory operands
+// walk the L1D, L2C and LLC (CACHE::functional_access): tags, replacement state and dirty bits are updated,
+// nothing is timed, DRAM is not modeled and the sim_* counters are not touched
+// when the prefetchers are trained they see the loads and fills, their prefetches are filled right away
+// and their metadata requests to the LLC are dropped
+// the instructions already in the ROB are not affected, they retire after the fast-forward
+//
+// used by the sampler (sampler.h) between its intervals, and by -functional_warmup for the warmup of all cores,
+// which always trains the prefetchers
+class FAST_FORWARD {
+  public:
+    uint8_t train_prefetchers;
+
+    // instructions read by the fast-forward, the trace position of a core is this plus its instr_unique_id
+    uint64_t instructions[NUM_CPUS], last_fetch_block[NUM_CPUS];
+    // the last read reached the end of the trace
+    uint8_t rewound[NUM_CPUS];
+
+    // host time spent in the fast-forward
+    double seconds;
+
+    // constructor
+    FAST_FORWARD() {
+        train_prefetchers = 0;
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            instructions[i] = 0;
+            last_fetch_block[i] = 0;
+            rewound[i] = 0;
+        }
+        seconds = 0;
+    };
+
+    // functions
+    void run(uint32_t cpu, uint64_t n, uint8_t train),
+         warmup(uint64_t n),
+         set_functional(uint32_t cpu, uint8_t functional),
+         instruction(uint32_t cpu, uint64_t ip, uint8_t is_branch, uint8_t branch_taken, uint64_t instr_asid, uint64_t data_asid,
+                     uint64_t *source_memory, uint32_t num_sources, uint64_t *destination_memory, uint32_t num_destinations, uint8_t train);
+    uint8_t step(uint32_t cpu, uint8_t train),
+            end_of_trace(uint32_t cpu);
+};
+
+extern FAST_FORWARD fast_forward;
+
+#endif
@@ -10,7 +10,8 @@
 #define PREFETCH  2
 #define WRITEBACK 3
 #define METADATA  4
-#define NUM_TYPES 5
+#define ONCHIP_METADATA 5 // metadata a prefetcher keeps in the LLC ways above CACHE::current_assoc
+#define NUM_TYPES 6
 
 extern uint32_t tRP,  // Row Precharge (RP) latency
                 tRCD, // Row address to Column address (RCD) latency
@@ -2,6 +2,7 @@
 #define OOO_CPU_H
 
 #include "cache.h"
+#include "trace_reader.h"
 
 #ifdef CRC2_COMPILE
 #define STAT_PRINTING_PERIOD 1000000
@@ -12,6 +13,8 @@
 
 using namespace std;
 
+class BRANCH_COMPONENT;
+
 // CORE PROCESSOR
 #define FETCH_WIDTH 4
 #define DECODE_WIDTH 4
@@ -33,9 +36,8 @@ class O3_CPU {
     uint32_t cpu;
 
     // trace
-    FILE *trace_file;
+    TRACE_READER *trace_reader;
     char trace_string[1024];
-    char gunzip_command[1024];
 
     // instruction
     input_instr current_instr;
@@ -53,6 +55,13 @@ class O3_CPU {
     CORE_BUFFER ROB{"ROB", ROB_SIZE};
     LOAD_STORE_QUEUE LQ{"LQ", LQ_SIZE}, SQ{"SQ", SQ_SIZE};
     
+    // instr_id -> rob_index, indexed by instr_id % ROB_SIZE
+    // instr_ids are assigned in program order, so the in-flight instructions never collide
+    uint32_t ROB_lookup[ROB_SIZE];
+
+    // wakeup list of ROB entries waiting for their execution to complete, one bit per rob_index
+    uint64_t ROB_completion[(ROB_SIZE+63)/64];
+
     // store array, this structure is required to properly handle store instructions
     uint64_t STA[STA_SIZE], STA_head, STA_tail; 
 
@@ -74,6 +83,9 @@ class O3_CPU {
     uint8_t  fetch_stall;
     uint64_t num_branch, branch_mispredictions;
 
+    // branch predictor picked at startup in a registry build (component.h)
+    BRANCH_COMPONENT *branch_component;
+
     // TLBs and caches
     CACHE ITLB{"ITLB", ITLB_SET, ITLB_WAY, ITLB_SET*ITLB_WAY, ITLB_WQ_SIZE, ITLB_RQ_SIZE, ITLB_PQ_SIZE, ITLB_MSHR_SIZE},
           DTLB{"DTLB", DTLB_SET, DTLB_WAY, DTLB_SET*DTLB_WAY, DTLB_WQ_SIZE, DTLB_RQ_SIZE, DTLB_PQ_SIZE, DTLB_MSHR_SIZE},
@@ -87,7 +99,7 @@ class O3_CPU {
         cpu = 0;
 
         // trace
-        trace_file = NULL;
+        trace_reader = NULL;
 
         // instruction
         instr_unique_id = 0;
@@ -118,12 +130,19 @@ class O3_CPU {
         fetch_stall = 0;
         num_branch = 0;
         branch_mispredictions = 0;
+        branch_component = NULL;
 
         for (uint32_t i=0; i<STA_SIZE; i++)
             STA[i] = UINT64_MAX;
         STA_head = 0;
         STA_tail = 0;
 
+        for (uint32_t i=0; i<ROB_SIZE; i++)
+            ROB_lookup[i] = ROB_SIZE;
+
+        for (uint32_t i=0; i<(ROB_SIZE+63)/64; i++)
+            ROB_completion[i] = 0;
+
         for (uint32_t i=0; i<ROB_SIZE; i++) {
             RTE0[i] = ROB_SIZE;
             RTE1[i] = ROB_SIZE;
@@ -165,12 +184,14 @@ class O3_CPU {
          do_memory_scheduling(uint32_t rob_index),
          operate_lsq(),
          complete_execution(uint32_t rob_index),
+         add_completion_candidate(uint32_t rob_index),
+         complete_executions(uint32_t begin, uint32_t end),
          reg_RAW_dependency(uint32_t prior, uint32_t current, uint32_t source_index),
          reg_RAW_release(uint32_t rob_index),
          mem_RAW_dependency(uint32_t prior, uint32_t current, uint32_t data_index, uint32_t lq_index),
          handle_o3_fetch(PACKET *current_packet, uint32_t cache_type),
-         handle_merged_translation(PACKET *provider),
-         handle_merged_load(PACKET *provider),
+         handle_merged_translation(PACKET *provider, DEPENDENCY &depend_on_provider),
+         handle_merged_load(PACKET *provider, DEPENDENCY &depend_on_provider),
          release_load_queue(uint32_t lq_index),
          complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb),
          complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb);
@@ -190,10 +211,19 @@ class O3_CPU {
 
     uint32_t check_and_add_lsq(uint32_t rob_index);
 
+    // event-driven simulation
+    uint8_t  can_add_lsq(uint32_t rob_index);
+    uint64_t get_memory_scheduling_cycle(uint32_t begin, uint32_t end, uint32_t &searched),
+             get_next_event_cycle();
+
     // branch predictor
     uint8_t predict_branch(uint64_t ip);
     void    initialize_branch_predictor(),
-            last_branch_result(uint64_t ip, uint8_t taken); 
+            last_branch_result(uint64_t ip, uint8_t taken),
+            checkpoint_branch_predictor(CHECKPOINT &cp);
+
+    void checkpoint(CHECKPOINT &cp),
+         register_stats();
 };
 
 extern O3_CPU ooo_cpu[NUM_CPUS];
@@ -23,6 +23,7 @@ using namespace std;
 #include <math.h>
 #include <set>
 #include <vector>
+#include "checkpoint.h"
 
 struct ADDR_INFO
 {
@@ -63,6 +64,21 @@ struct ADDR_INFO
     {
         prefetched = true;
     }
+
+    void checkpoint(CHECKPOINT &cp)
+    {
+        cp.io(addr);
+        cp.io(last_quanta);
+        cp.io(PC);
+        cp.io(prefetched);
+        cp.io(lru);
+        cp.io(last_prediction);
+        cp.io(is_high_cost_predicted);
+        cp.io(last_miss_cost);
+        cp.io(index);
+        cp.io(context);
+        cp.io(written);
+    }
 };
 
 struct OPTgen
@@ -88,6 +104,18 @@ struct OPTgen
         prefetch_cachehit = 0;
     }
 
+    void checkpoint(CHECKPOINT &cp)
+    {
+        cp.check(CACHE_SIZE, "OPTgen size");
+        cp.io(liveness_history);
+        cp.io(liveness_history_stable);
+        cp.io(num_cache);
+        cp.io(num_dont_cache);
+        cp.io(access);
+        cp.io(prefetch);
+        cp.io(prefetch_cachehit);
+    }
+
     void add_access(uint64_t curr_quanta)
     {
         access++;
@@ -0,0 +1,67 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include <stdint.h>
+#include <vector>
+#include "checkpoint.h"
+
+using namespace std;
+
+// open-addressed hash table from a 64-bit key to a 64-bit value
+// linear probing with backward-shift deletion, the table doubles when it is half full
+class PAGE_HASH {
+  public:
+    uint64_t SIZE, mask, occupancy;
+    uint64_t *key, *value;
+    uint8_t  *used;
+
+    // constructor
+    PAGE_HASH() {
+        SIZE = 1 << 12;
+        mask = SIZE - 1;
+        occupancy = 0;
+
+        key = new uint64_t[SIZE];
+        value = new uint64_t[SIZE];
+        used = new uint8_t[SIZE];
+        for (uint64_t i=0; i<SIZE; i++)
+            used[i] = 0;
+    };
+
+    // destructor
+    ~PAGE_HASH() {
+        delete[] key;
+        delete[] value;
+        delete[] used;
+    };
+
+    // functions
+    uint64_t get_bucket(uint64_t k),
+             *find(uint64_t k),
+             *insert(uint64_t k, uint64_t v);
+
+    void erase(uint64_t k),
+         resize(),
+         checkpoint(CHECKPOINT &cp);
+};
+
+// clock (second chance) replacement over the allocated physical pages
+class PAGE_CLOCK {
+  public:
+    vector<uint64_t> vpage, ppage;
+    vector<uint8_t>  referenced;
+    uint64_t hand;
+
+    // constructor
+    PAGE_CLOCK() {
+        hand = 0;
+    };
+
+    // functions
+    uint64_t add_frame(uint64_t v, uint64_t p),
+             find_victim();
+
+    void checkpoint(CHECKPOINT &cp);
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef PREFETCHER_BENCH_H
+#define PREFETCHER_BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+
+using namespace std;
+
+class CACHE;
+
+// one access seen by the L2C prefetcher, as it is written to a stream file
+class STREAM_ACCESS {
+  public:
+    uint64_t ip, address;
+    uint8_t hit, type, reserved[6];
+};
+
+// host speed benchmark of an L2C prefetcher without the out-of-order core
+//
+// -record_stream <file> writes the accesses the L2C prefetcher of CPU 0 sees during a normal simulation
+// -bench_stream <file> replays them through the prefetcher of CPU 0 and exits, no traces are needed
+//
+// the replay drives l2c_prefetcher_operate and l2c_prefetcher_cache_fill of the real L2C, but nothing is timed:
+// a miss and every prefetch into the L2C are filled right after the operate call, the prefetch and metadata
+// requests that reach the PQ of the L2C or the PQ and WQ of the LLC are counted and dropped, reads of the
+// on-chip metadata in the LLC (Triage) complete right away,
+// the metadata an access carried is not recorded, the replay passes 0
+// it reports the host time per access, the peak RSS and the final stats of the prefetcher (its table occupancy)
+class PREFETCHER_BENCH {
+  public:
+    string record_file, stream_file;
+    FILE *record;
+    uint64_t recorded;
+
+    // constructor
+    PREFETCHER_BENCH() {
+        record = NULL;
+        recorded = 0;
+    };
+
+    // functions
+    void open_record(),
+         close_record(),
+         run(CACHE *cache);
+
+    void record_access(uint64_t ip, uint64_t address, uint8_t hit, uint8_t type) {
+        STREAM_ACCESS access = {ip, address, hit, type, {0}};
+        fwrite(&access, sizeof(access), 1, record);
+        recorded++;
+    };
+
+    uint8_t enabled() { return stream_file.size() > 0; };
+};
+
+extern PREFETCHER_BENCH prefetcher_bench;
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+// host profile
+#define PROFILE_SAMPLE 16 // one of every PROFILE_SAMPLE calls of a region is timed, power of two
+
+// regions, the stages of the core
+#define PROFILE_HANDLE_BRANCH 0
+#define PROFILE_FETCH 1
+#define PROFILE_SCHEDULE 2
+#define PROFILE_EXECUTE 3
+#define PROFILE_SCHEDULE_MEMORY 4
+#define PROFILE_OPERATE_LSQ 5
+#define PROFILE_UPDATE_ROB 6
+#define PROFILE_RETIRE 7
+// CACHE::operate of each level, PROFILE_CACHE + cache_type
+#define PROFILE_CACHE 8
+#define PROFILE_DRAM 15
+// component callbacks, they are also part of the CACHE::operate of their level
+#define PROFILE_L1D_PREFETCHER_OPERATE 16
+#define PROFILE_L1D_PREFETCHER_FILL 17
+#define PROFILE_L2C_PREFETCHER_OPERATE 18
+#define PROFILE_L2C_PREFETCHER_FILL 19
+#define PROFILE_LLC_PREFETCHER_OPERATE 20
+#define PROFILE_LLC_PREFETCHER_FILL 21
+#define PROFILE_FIND_VICTIM 22
+#define PROFILE_UPDATE_REPLACEMENT 23
+#define PROFILE_LLC_FIND_VICTIM 24
+#define PROFILE_LLC_UPDATE_REPLACEMENT 25
+#define PROFILE_REGIONS 26
+
+// the row of the shared LLC and DRAM, the cores use the row of their cpu
+#define PROFILE_UNCORE NUM_CPUS
+
+class PROFILE_COUNTER {
+  public:
+    uint64_t calls, samples, ticks;
+
+    // constructor
+    PROFILE_COUNTER() : calls(0), samples(0), ticks(0) {};
+};
+
+// host time spent in the pipeline stages, the caches, DRAM and the prefetcher and replacement callbacks
+// built with HOST_PROFILE (champsim.h, or CFLAGS=-DHOST_PROFILE ./build_champsim.sh ...), otherwise
+// PROFILE() and PROFILE_CALL() compile to nothing
+//
+// a region reads the time stamp counter before and after one of every PROFILE_SAMPLE calls,
+// the time of the others is estimated from the timed ones when the profile is printed
+// each core counts in its own row and the shared LLC and DRAM in PROFILE_UNCORE, which is only
+// touched in the shared sections of threaded cores, so no counter is updated by two threads
+class HOST_PROFILE_TABLE {
+  public:
+    PROFILE_COUNTER counter[NUM_CPUS+1][PROFILE_REGIONS];
+
+    // time stamp counter and wall clock at begin(), to convert ticks into seconds
+    // overhead is the cost of reading the counter twice, taken off every timed call
+    uint64_t begin_ticks, overhead;
+    chrono::steady_clock::time_point begin_time;
+
+    // functions
+    void begin(),
+         print();
+
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    };
+};
+
+extern HOST_PROFILE_TABLE host_profile;
+
+// times the rest of the enclosing scope for one of every PROFILE_SAMPLE entries
+class PROFILE_SCOPE {
+    PROFILE_COUNTER *timed;
+    uint64_t start;
+
+  public:
+    PROFILE_SCOPE(uint32_t row, uint32_t region) {
+        PROFILE_COUNTER &c = host_profile.counter[row][region];
+        timed = NULL;
+        start = 0;
+        if ((c.calls++ & (PROFILE_SAMPLE-1)) == 0) {
+            timed = &c;
+            start = HOST_PROFILE_TABLE::ticks();
+        }
+    };
+
+    ~PROFILE_SCOPE() {
+        if (timed) {
+            timed->ticks += HOST_PROFILE_TABLE::ticks() - start;
+            timed->samples++;
+        }
+    };
+};
+
+#ifdef HOST_PROFILE
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE(row, region) PROFILE_SCOPE PROFILE_CONCAT(profile_scope_, __LINE__)(row, region)
+#define PROFILE_CALL(row, region, call) ([&]() -> decltype(call) { PROFILE_SCOPE profile_scope(row, region); return call; }())
+#else
+#define PROFILE(row, region)
+#define PROFILE_CALL(row, region, call) call
+#endif
+
+#endif
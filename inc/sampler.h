@@ -0,0 +1,78 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// phases of the sampled simulation
+#define SAMPLER_WARMUP 0
+#define SAMPLER_MEASURE 1
+#define SAMPLER_DONE 2
+
+// one detailed interval, start and length in instructions of the trace
+class SAMPLE_INTERVAL {
+  public:
+    uint64_t start, length;
+    double weight;
+
+    // measured in the interval
+    uint64_t instructions, cycles, branch_mispredictions, l1d_miss, l2c_miss, llc_miss;
+
+    // constructor
+    SAMPLE_INTERVAL(uint64_t v1, uint64_t v2, double v3) : start(v1), length(v2), weight(v3) {
+        instructions = 0;
+        cycles = 0;
+        branch_mispredictions = 0;
+        l1d_miss = 0;
+        l2c_miss = 0;
+        llc_miss = 0;
+    };
+};
+
+// sampled simulation of a single core (SimPoint-like)
+//
+// -simpoints <file> lists the intervals, one "start length weight" per line (# starts a comment),
+// the trace is fast-forwarded functionally (fast_forward.h) up to warmup_instructions before each interval,
+// those are simulated in detail to warm up the core and the queues, then the interval is measured
+// -train_prefetchers also trains the prefetchers during the fast-forward
+//
+// the result is the IPC and demand MPKI of every interval and their aggregate, CPI and MPKI are
+// averaged with the normalized weights and the weighted IPC is the inverse of the weighted CPI
+// the usual statistics after it cover all the detailed instructions, warmups included
+class SAMPLER {
+  public:
+    string file;
+    vector<SAMPLE_INTERVAL> intervals;
+    uint32_t current;
+    uint8_t phase;
+
+    // detailed instructions before each interval, and the counters when the current interval began
+    uint64_t detail_warmup, begin_instructions, begin_cycles, begin_branch_mispredictions,
+             begin_l1d_miss, begin_l2c_miss, begin_llc_miss;
+
+    // constructor
+    SAMPLER() {
+        current = 0;
+        phase = SAMPLER_WARMUP;
+        detail_warmup = 0;
+    };
+
+    // functions
+    void start(uint64_t warmup),
+         check(),
+         print(),
+         load(),
+         forward_to(uint64_t position),
+         begin_interval(),
+         end_interval();
+    uint64_t position();
+
+    uint8_t enabled() { return file.size() > 0; };
+};
+
+extern SAMPLER sampler;
+
+#endif
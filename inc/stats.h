@@ -0,0 +1,76 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+
+using namespace std;
+
+// statistics output
+#define STATS_JSON 0
+#define STATS_CSV 1
+
+#define STAT_U64 0
+#define STAT_U32 1
+#define STAT_INT 2
+
+// a counter owned by a component, read when a snapshot is taken
+class STAT_COUNTER {
+  public:
+    string name;
+    uint8_t kind;
+    const void *value;
+
+    // constructor
+    STAT_COUNTER(string v1, uint8_t v2, const void *v3) : name(v1), kind(v2), value(v3) {};
+
+    uint64_t read() const;
+    int64_t read_signed() const { return *(const int *)value; };
+};
+
+// named counters of the caches, cores, DRAM controller and prefetchers, written as a time series
+// the components register their counters once at initialization with add(),
+// a snapshot of every counter is taken at the end of the warmup (before the counters are reset),
+// every -stats_interval retired instructions (all cores together), and when the simulation ends
+//
+// -stats_file <name>.json writes {"snapshots": [...]} with one object per snapshot,
+// -stats_file <name>.csv writes one line per counter and snapshot (snapshot,phase,instructions,cycle,name,value)
+// maps (add_map) are written with the keys they have at the time of the snapshot
+class STATS_REGISTRY {
+  public:
+    string file;
+    uint8_t format;
+    uint64_t interval, next_snapshot, num_snapshots;
+
+    vector<STAT_COUNTER> counters;
+    vector<pair<string, const map<string, uint64_t> *> > maps;
+
+    ofstream out;
+
+    // constructor
+    STATS_REGISTRY() {
+        format = STATS_JSON;
+        interval = 0;
+        next_snapshot = UINT64_MAX;
+        num_snapshots = 0;
+    };
+
+    // functions
+    void add(string name, const uint64_t *value),
+         add(string name, const uint32_t *value),
+         add(string name, const int *value),
+         add_map(string prefix, const map<string, uint64_t> *values),
+         open(),
+         check_interval(),
+         snapshot(string phase),
+         close();
+
+    uint8_t enabled() { return file.size() > 0; };
+};
+
+extern STATS_REGISTRY stats_registry;
+
+#endif
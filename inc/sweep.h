@@ -0,0 +1,59 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "trace_reader.h"
+
+using namespace std;
+
+// sweep
+#define SWEEP_RING_SIZE 64 // decoded batches the fastest simulation may run ahead of the slowest, power of two
+
+// runs the same traces through several L2C prefetchers in one job (registry build, -sweep a,b,c)
+// the simulator state is global, so every configuration is simulated by a forked child process
+// the parent decodes each trace once into a ring shared by all children and waits for them
+//
+// children write their output to <output>.<prefetcher>.out
+class SWEEP {
+  public:
+    vector<string> configs;
+    string output;
+
+    // index into configs in a child, -1 in the decoder process
+    int32_t config;
+
+    vector<pid_t> children;
+    TRACE_RING *ring[NUM_CPUS];
+    // the reader of each ring in this process
+    TRACE_READER *reader[NUM_CPUS];
+
+    // constructor
+    SWEEP() {
+        output = "sweep";
+        config = -1;
+
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            ring[i] = NULL;
+            reader[i] = NULL;
+        }
+    };
+
+    // functions
+    void parse(string list),
+         start(size_t instr_size),
+         run(),
+         finish();
+
+    uint8_t enabled() { return configs.size() > 0; };
+    uint8_t decoder() { return enabled() && (config < 0); };
+
+    TRACE_READER *open_trace(string name, size_t instr_size, uint8_t format, uint32_t cpu);
+};
+
+extern SWEEP sweep;
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <zlib.h>
+#include <lzma.h>
+
+using namespace std;
+
+// trace reader
+#define TRACE_BATCH_INSTRS 1024 // instructions per decoded batch
+#define TRACE_RING_SIZE 8 // batches in flight between the decoder and the core, power of two
+#define TRACE_INPUT_SIZE (1 << 16) // compressed bytes read from an xz trace at once
+#define TRACE_MAX_READERS 64 // cores of different simulations reading one decoded trace (sweep.h)
+
+#define TRACE_GZ 0
+#define TRACE_XZ 1
+
+// role of a TRACE_READER on a shared ring
+#define TRACE_DECODER_ONLY -1 // decodes into the ring, the simulations of a sweep read it
+#define TRACE_DETACHED UINT64_MAX // head of a reader that stopped reading
+
+// decoded instructions handed from the decoder thread to the core
+class TRACE_BATCH {
+  public:
+    char *data;
+    uint32_t count;
+
+    // the trace wrapped around after the last instruction of this batch
+    uint8_t end_of_trace;
+
+    TRACE_BATCH() {
+        data = NULL;
+        count = 0;
+        end_of_trace = 0;
+    };
+};
+
+// ring of batches with one head per reader, the decoder only reuses a batch released by every reader
+// the ring, its batches and their data are one mapping, shared with the forked simulations of a sweep
+class TRACE_RING {
+  public:
+    const uint32_t SIZE, READERS;
+    size_t mapped_bytes;
+    TRACE_BATCH *batch;
+
+    atomic<uint64_t> tail, head[TRACE_MAX_READERS];
+
+    // constructor
+    TRACE_RING(uint32_t v1, uint32_t v2) : SIZE(v1), READERS(v2) {
+        mapped_bytes = 0;
+        batch = NULL;
+
+        tail = 0;
+        for (uint32_t i=0; i<TRACE_MAX_READERS; i++)
+            head[i] = (i < READERS) ? 0 : TRACE_DETACHED;
+    };
+
+    // functions
+    static TRACE_RING *allocate(uint32_t size, uint32_t readers, size_t batch_bytes, uint8_t shared);
+    static void release(TRACE_RING *ring);
+
+    uint64_t slowest_head();
+};
+
+// decompresses a trace in-process on a dedicated thread
+// the decoder fills a single-producer ring of batches and rewinds itself at the end of the trace
+class TRACE_READER {
+  public:
+    const string NAME;
+    const size_t INSTR_SIZE;
+    uint8_t format;
+
+    // reader reads ring->head[reader], or TRACE_DECODER_ONLY
+    TRACE_RING *ring;
+    int32_t reader;
+    uint8_t owns_ring;
+    atomic<uint8_t> stop;
+
+    // consumer side
+    TRACE_BATCH *current;
+    uint32_t read_pos;
+    uint8_t end_reported;
+
+    // gzip
+    gzFile gz_file;
+
+    // xz
+    FILE *xz_file;
+    lzma_stream xz_stream;
+    uint8_t *xz_input;
+    uint8_t xz_done;
+
+    thread decoder;
+
+    // constructor
+    // a private ring read by this core, or reader/decoder of the shared ring of a sweep
+    TRACE_READER(string v1, size_t v2, uint8_t v3, TRACE_RING *v4 = NULL, int32_t v5 = 0) : NAME(v1), INSTR_SIZE(v2), format(v3), ring(v4), reader(v5) {
+        owns_ring = (ring == NULL);
+        if (owns_ring)
+            ring = TRACE_RING::allocate(TRACE_RING_SIZE, 1, INSTR_SIZE * TRACE_BATCH_INSTRS, 0);
+
+        stop = 0;
+
+        current = NULL;
+        read_pos = 0;
+        end_reported = 0;
+
+        gz_file = NULL;
+        xz_file = NULL;
+        xz_input = NULL;
+        xz_done = 0;
+
+        // the simulations of a sweep read the batches decoded by another process
+        if (owns_ring || (reader == TRACE_DECODER_ONLY)) {
+            open_trace();
+            decoder = thread(&TRACE_READER::decode_loop, this);
+        }
+    };
+
+    // destructor
+    ~TRACE_READER() {
+        stop = 1;
+        if (decoder.joinable())
+            decoder.join();
+        close_trace();
+
+        if (owns_ring)
+            TRACE_RING::release(ring);
+    };
+
+    // functions
+    int  read_instr(void *instr);
+
+    void open_trace(),
+         close_trace(),
+         rewind_trace(),
+         skip(uint64_t instrs),
+         detach(),
+         decode_loop();
+
+    size_t decode(char *buf, size_t bytes);
+};
+
+#endif
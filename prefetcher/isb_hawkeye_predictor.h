@@ -24,45 +24,55 @@ inline uint64_t MyCRC( uint64_t _blockAddress)
 }
 
 
+// saturating counters indexed by a hash of the PC, they all start out at the threshold
 class IsbHawkeyePCPredictor
 {
-    map<uint64_t, short unsigned int > SHCT;
+    vector<uint16_t> SHCT;
 
     public:
-    void increment(uint64_t pc)
+    IsbHawkeyePCPredictor() : SHCT(SHCT_SIZE, (1+MAX_SHCT)/2) {}
+
+    void checkpoint(CHECKPOINT &cp)
     {
-        uint64_t signature = MyCRC(pc) % SHCT_SIZE;
-        if(SHCT.find(signature) == SHCT.end())
-            SHCT[signature] = (1+MAX_SHCT)/2;
+        cp.io(SHCT);
+    }
 
-        SHCT[signature] = (SHCT[signature] < MAX_SHCT) ? (SHCT[signature]+1) : MAX_SHCT;
+    // the index of a PC, what a hardware sampler keeps instead of the PC
+    static uint32_t signature(uint64_t pc)
+    {
+        return MyCRC(pc) % SHCT_SIZE;
+    }
 
+    void increment(uint64_t pc)
+    {
+        increment_signature(signature(pc));
     }
 
-    void saturate(uint64_t pc)
+    void increment_signature(uint32_t signature)
     {
-        uint64_t signature = MyCRC(pc) % SHCT_SIZE;
-        assert(SHCT.find(signature) != SHCT.end());
+        if (SHCT[signature] < MAX_SHCT)
+            SHCT[signature]++;
+    }
 
-        SHCT[signature] = MAX_SHCT;
+    void saturate(uint64_t pc)
+    {
+        SHCT[signature(pc)] = MAX_SHCT;
+    }
 
+    void decrement(uint64_t pc)
+    {
+        decrement_signature(signature(pc));
     }
 
-    void decrement (uint64_t pc)
+    void decrement_signature(uint32_t signature)
     {
-        uint64_t signature = MyCRC(pc) % SHCT_SIZE;
-        if(SHCT.find(signature) == SHCT.end())
-            SHCT[signature] = (1+MAX_SHCT)/2;
-        if(SHCT[signature] != 0)
-            SHCT[signature] = SHCT[signature]-1;
+        if (SHCT[signature] != 0)
+            SHCT[signature]--;
     }
 
-    bool get_prediction (uint64_t pc)
+    bool get_prediction(uint64_t pc)
     {
-        uint64_t signature = MyCRC(pc) % SHCT_SIZE;
-        if(SHCT.find(signature) != SHCT.end() && SHCT[signature] < ((MAX_SHCT+1)/2))
-            return false;
-        return true;
+        return SHCT[signature(pc)] >= ((MAX_SHCT+1)/2);
     }
 };
 
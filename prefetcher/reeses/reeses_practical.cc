@@ -20,6 +20,9 @@ void ReesesPrefetcher::initialize(CACHE *target_cache, bool footprint) {
     offset_cache = OffsetCache();
     on_chip_info = new OnChipInfo(this);
 
+    // the counters are created on first use, each snapshot writes the ones that exist by then
+    stats_registry.add_map("cpu" + to_string(cache->cpu) + "." + cache->NAME + ".reeses", &stats);
+
 #ifdef REESES_TESTS
     test_delta_patterns();
     test_footprint();
@@ -94,6 +94,7 @@ void Triage::train(uint64_t pc, uint64_t addr, bool cache_hit) {
                 on_chip_data.increase_confidence(trigger_addr);
                 conf_inc++;
             }
+            updated_addr_list.push_back(trigger_addr);
 
             if (new_entry.spatial) {
                 // create a link to the next address, if necessary
@@ -119,6 +120,7 @@ void Triage::train(uint64_t pc, uint64_t addr, bool cache_hit) {
                     on_chip_data.increase_confidence(trigger_addr);
                     conf_inc++;
                 }
+                updated_addr_list.push_back(trigger_addr);
             }
         }
     } else {
@@ -160,6 +162,7 @@ void Triage::calculatePrefetch(uint64_t pc, uint64_t addr, bool cache_hit, uint6
     debug_cout << hex << "Trigger: pc: " << pc << ", addr: " << addr << dec << " " << cache_hit << endl;
 
     next_addr_list.clear();
+    updated_addr_list.clear();
     trigger_count++;
     total_assoc += get_assoc();
 
@@ -177,6 +180,44 @@ uint32_t Triage::get_assoc() {
     return on_chip_data.get_assoc();
 }
 
+void Triage::checkpoint(CHECKPOINT &cp) {
+    // lookahead and degree come from the configuration of this run
+    training_unit.checkpoint(cp);
+    on_chip_data.checkpoint(cp);
+    cp.io(next_addr_list);
+
+    cp.io(same_addr);
+    cp.io(new_addr);
+    cp.io(new_stream);
+    cp.io(no_next_addr);
+    cp.io(conf_dec_retain);
+    cp.io(conf_dec_update);
+    cp.io(conf_inc);
+    cp.io(predict_count);
+    cp.io(trigger_count);
+    cp.io(spatial);
+    cp.io(temporal);
+    cp.io(total_assoc);
+}
+
+void Triage::register_stats(std::string prefix) {
+    stats_registry.add(prefix + ".trigger_count", &trigger_count);
+    stats_registry.add(prefix + ".predict_count", &predict_count);
+    stats_registry.add(prefix + ".same_addr", &same_addr);
+    stats_registry.add(prefix + ".new_addr", &new_addr);
+    stats_registry.add(prefix + ".new_stream", &new_stream);
+    stats_registry.add(prefix + ".no_next_addr", &no_next_addr);
+    stats_registry.add(prefix + ".conf_dec_retain", &conf_dec_retain);
+    stats_registry.add(prefix + ".conf_dec_update", &conf_dec_update);
+    stats_registry.add(prefix + ".conf_inc", &conf_inc);
+    stats_registry.add(prefix + ".total_assoc", &total_assoc);
+    stats_registry.add(prefix + ".spatial", &spatial);
+    stats_registry.add(prefix + ".temporal", &temporal);
+
+    training_unit.register_stats(prefix);
+    on_chip_data.register_stats(prefix);
+}
+
 void Triage::print_stats() {
     cout << dec << "trigger_count=" << trigger_count <<endl;
     cout << "predict_count=" << predict_count <<endl;
@@ -191,6 +232,7 @@ void Triage::print_stats() {
     cout << "spatial=" << spatial << endl;
     cout << "temporal=" << temporal << endl;
 
+    training_unit.print_stats();
     on_chip_data.print_stats();
 }
 
@@ -15,8 +15,10 @@ struct TriageConfig {
     int lookahead;
     int degree;
 
-    int on_chip_set, on_chip_assoc;
-    int training_unit_size;
+    // bytes of metadata in one way of the table, the format sets the number of entries
+    int on_chip_way_bytes, on_chip_assoc;
+    TriageMetadataFormat format;
+    int training_unit_size, training_unit_assoc;
     bool use_dynamic_assoc;
 
     TriageReplType repl;
@@ -38,6 +40,8 @@ class Triage {
     uint64_t total_assoc;
 
     std::vector<uint64_t> next_addr_list;
+    // the table entries the last training changed
+    std::vector<uint64_t> updated_addr_list;
 
     public:
     TriageOnchip on_chip_data;
@@ -48,7 +52,10 @@ class Triage {
                 bool cache_hit, uint64_t *prefetch_list,
                 int max_degree, uint64_t cpu);
         void print_stats();
+        void register_stats(std::string prefix);
         uint32_t get_assoc();
+        const std::vector<uint64_t>& get_updated_addr_list() { return updated_addr_list; }
+        void checkpoint(CHECKPOINT &cp);
 };
 
 #endif // __TRIAGE_H__
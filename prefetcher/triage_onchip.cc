@@ -1,5 +1,8 @@
 
 #include <assert.h>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
 #include "triage_onchip.h"
 #include "triage.h"
@@ -14,17 +17,75 @@ using namespace std;
 #define debug_cout if (0) cerr
 #endif
 
+TriageFormatInfo triage_format_info[TRIAGE_FORMAT_COUNT] = {
+    {"full", 16, 0, 0, 0},
+    {"compact", 8, 23, 12, 26},
+    {"compressed", 4, 10, 8, 11}
+};
+
+void TriageRegionTable::init(uint32_t region_bits) {
+    assoc = ((1u << region_bits) < TRIAGE_REGION_WAYS) ? (1u << region_bits) : TRIAGE_REGION_WAYS;
+    num_sets = (1u << region_bits) / assoc;
+    regions.assign(num_sets * assoc, 0);
+    last_used.assign(num_sets * assoc, 0);
+    valid.assign(num_sets * assoc, 0);
+}
+
+// the index of the region, it is allocated if needed, replaced is set when it took the place of another region
+uint32_t TriageRegionTable::insert(uint64_t region, bool &replaced) {
+    uint32_t base = (region & (num_sets - 1)) * assoc, victim = base;
+    timer++;
+    replaced = false;
+    for (uint32_t i = base; i < base + assoc; i++) {
+        if (valid[i] && regions[i] == region) {
+            last_used[i] = timer;
+            return i;
+        }
+        if (valid[victim] && (!valid[i] || last_used[i] < last_used[victim]))
+            victim = i;
+    }
+
+    misses++;
+    if (valid[victim]) {
+        replacements++;
+        replaced = true;
+    }
+    valid[victim] = 1;
+    regions[victim] = region;
+    last_used[victim] = timer;
+    return victim;
+}
+
+bool TriageRegionTable::get_region(uint32_t index, uint64_t &region) {
+    if (index >= regions.size() || !valid[index])
+        return false;
+    last_used[index] = ++timer;
+    region = regions[index];
+    return true;
+}
+
+void TriageRegionTable::checkpoint(CHECKPOINT &cp) {
+    cp.check(num_sets, "triage region table sets");
+    cp.io(regions);
+    cp.io(last_used);
+    cp.io(valid);
+    cp.io(timer);
+    cp.io(misses);
+    cp.io(replacements);
+    cp.io(invalidated_targets);
+}
+
 TriageOnchipEntry::TriageOnchipEntry() {
     init();
 }
 
 void TriageOnchipEntry::init() {
     for (uint32_t i = 0; i < ONCHIP_LINE_SIZE; i++) {
-        metadata[i].spatial = false;
-        metadata[i].addr = INVALID_ADDR;
+        target[i] = INVALID_ADDR;
         confidence[i] = 3;
         valid[i] = false;
     }
+    rrpv = 0;
 }
 
 void TriageOnchipEntry::increase_confidence(uint32_t offset) {
@@ -37,19 +98,62 @@ void TriageOnchipEntry::decrease_confidence(uint32_t offset) {
         confidence[offset]--;
 }
 
-TriageOnchip::TriageOnchip() {}
+void TriageOnchipEntry::checkpoint(CHECKPOINT &cp) {
+    cp.io_array(target, ONCHIP_LINE_SIZE);
+    cp.io_array(confidence, ONCHIP_LINE_SIZE);
+    cp.io_array(valid, ONCHIP_LINE_SIZE);
+    cp.io(rrpv);
+}
+
+TriageOnchip::TriageOnchip() {
+    repl = NULL;
+}
 
 void TriageOnchip::set_conf(TriageConfig *config) {
     assoc = config->on_chip_assoc;
-    num_sets = config->on_chip_set;
+    format = config->format;
+    if (format >= TRIAGE_FORMAT_COUNT) {
+        cerr << "[TRIAGE_ONCHIP] unknown metadata format: " << format << endl;
+        assert(0);
+    }
+    const TriageFormatInfo &info = triage_format_info[format];
+    num_sets = config->on_chip_way_bytes / info.entry_bytes;
     num_sets = num_sets >> ONCHIP_LINE_SHIFT;
+    if (num_sets == 0 || (num_sets & (num_sets - 1))) {
+        cerr << "[TRIAGE_ONCHIP] " << config->on_chip_way_bytes << " bytes per way are not a power of two number of "
+             << info.name << " entries" << endl;
+        assert(0);
+    }
+    set_bits = __builtin_ctz(num_sets);
+    tag_mask = info.tag_bits ? ((1ull << info.tag_bits) - 1) : UINT64_MAX;
+    offset_bits = info.offset_bits;
+    offset_mask = (1ull << offset_bits) - 1;
+    if (offset_bits)
+        region_table.init(info.region_bits);
     repl_type = config->repl;
     index_mask = num_sets - 1;
     use_dynamic_assoc = config->use_dynamic_assoc;
 
-    entry_list.resize(num_sets);
-    repl = TriageRepl::create_repl(&entry_list, repl_type, assoc, use_dynamic_assoc);
-    cout << "Num Sets: " << num_sets << endl;
+    // the dynamic associativity goes up to the largest sampled one
+    ways = assoc;
+    if (use_dynamic_assoc && ways < hawkeye_sample_assoc[HAWKEYE_SAMPLE_ASSOC_COUNT-1])
+        ways = hawkeye_sample_assoc[HAWKEYE_SAMPLE_ASSOC_COUNT-1];
+    if (ways == 0)
+        ways = 1;
+    if (ways > 64) {
+        cerr << "[TRIAGE_ONCHIP] at most 64 ways, configured: " << ways << endl;
+        assert(0);
+    }
+
+    tags.assign((uint64_t)num_sets * ways, 0);
+    valid_mask.assign(num_sets, 0);
+    entries.assign((uint64_t)num_sets * ways, TriageOnchipEntry());
+    overflow.clear();
+    if (repl_type == TRIAGE_REPL_PERFECT)
+        overflow.resize(num_sets);
+
+    repl = TriageRepl::create_repl(this, repl_type, assoc, use_dynamic_assoc);
+    cout << "Num Sets: " << num_sets << " format: " << info.name << endl;
 }
 
 uint64_t TriageOnchip::get_line_offset(uint64_t addr) {
@@ -58,6 +162,72 @@ uint64_t TriageOnchip::get_line_offset(uint64_t addr) {
 }
 
 
+// the full format keeps the whole address, as the set index bits are part of it the tags stay unique
+uint64_t TriageOnchip::get_tag(uint64_t addr) {
+    if (tag_mask == UINT64_MAX)
+        return addr >> ONCHIP_LINE_SHIFT;
+    return (addr >> (ONCHIP_LINE_SHIFT + set_bits)) & tag_mask;
+}
+
+uint64_t TriageOnchip::get_metadata_line(uint64_t addr) {
+    return get_set_id(addr) / (TRIAGE_METADATA_LINE_BYTES / triage_format_info[format].entry_bytes);
+}
+
+uint64_t TriageOnchip::encode(const Metadata &entry) {
+    // a delta of at most MAX_DELTA and a length of at most MAX_DELTA_LENGTH fit in any target field
+    if (entry.spatial)
+        return TRIAGE_TARGET_SPATIAL | ((uint64_t)entry.next_spatial.length << 8) | (uint8_t)entry.next_spatial.delta;
+
+    if (offset_bits == 0)
+        return entry.addr;
+    bool replaced;
+    uint64_t region = region_table.insert(entry.addr >> offset_bits, replaced);
+    if (replaced)
+        invalidate_region(region);
+    return (region << offset_bits) | (entry.addr & offset_mask);
+}
+
+// the walk over the table is not timed, a replacement is rare next to the lookups
+void TriageOnchip::invalidate_region(uint64_t region) {
+    for (uint64_t set_id = 0; set_id < num_sets; set_id++) {
+        for (uint64_t mask = valid_mask[set_id]; mask; mask &= mask - 1)
+            invalidate_region(get_entry(set_id, __builtin_ctzll(mask)), region);
+    }
+    for (uint64_t set_id = 0; set_id < overflow.size(); set_id++) {
+        for (map<uint64_t, TriageOnchipEntry>::iterator it = overflow[set_id].begin(); it != overflow[set_id].end(); it++)
+            invalidate_region(it->second, region);
+    }
+}
+
+void TriageOnchip::invalidate_region(TriageOnchipEntry &entry, uint64_t region) {
+    for (uint32_t i = 0; i < ONCHIP_LINE_SIZE; i++) {
+        if (entry.valid[i] && !(entry.target[i] & TRIAGE_TARGET_SPATIAL) && (entry.target[i] >> offset_bits) == region) {
+            entry.valid[i] = false;
+            region_table.invalidated_targets++;
+        }
+    }
+}
+
+// an entry whose region is not in the region table is invalid
+Metadata TriageOnchip::decode(uint64_t trigger, uint64_t target) {
+    Metadata entry;
+    if (target & TRIAGE_TARGET_SPATIAL) {
+        int32_t delta = (int8_t)(target & 0xff);
+        uint32_t length = (target >> 8) & 0xff;
+        DeltaPattern pattern(delta, trigger + (int64_t)delta * length);
+        pattern.length = length;
+        entry.set_spatial(trigger, pattern);
+    } else if (offset_bits == 0) {
+        entry.set_addr(target);
+    } else {
+        // a target that decodes to the trigger itself predicts nothing
+        uint64_t region;
+        if (region_table.get_region(target >> offset_bits, region) && (((region << offset_bits) | (target & offset_mask)) != trigger))
+            entry.set_addr((region << offset_bits) | (target & offset_mask));
+    }
+    return entry;
+}
+
 uint64_t TriageOnchip::get_set_id(uint64_t addr) {
     uint64_t set_id = (addr >> ONCHIP_LINE_SHIFT) & index_mask;
     debug_cout << "num_sets: " << num_sets << ", index_mask: " << index_mask << ", set_id: " << set_id <<endl;
@@ -65,86 +235,171 @@ uint64_t TriageOnchip::get_set_id(uint64_t addr) {
     return set_id;
 }
 
-int TriageOnchip::increase_confidence(uint64_t addr) {
+uint32_t TriageOnchip::find_way(uint64_t set_id, uint64_t tag) {
+    // compare every tag of the set, then keep the lowest valid match
+    const uint64_t *set_tags = &tags[set_id*ways];
+    uint64_t match = 0;
+    uint32_t way = 0;
+
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi64x(tag);
+    for (; way+4<=ways; way+=4) {
+        __m256i cmp = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) &set_tags[way]), key);
+        match |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(cmp)) << way;
+    }
+#elif defined(__SSE4_1__)
+    __m128i key = _mm_set1_epi64x(tag);
+    for (; way+2<=ways; way+=2) {
+        __m128i cmp = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i *) &set_tags[way]), key);
+        match |= (uint64_t) _mm_movemask_pd(_mm_castsi128_pd(cmp)) << way;
+    }
+#endif
+    for (; way<ways; way++)
+        match |= (uint64_t) (set_tags[way] == tag) << way;
+
+    match &= valid_mask[set_id];
+    if (match == 0)
+        return ways;
+
+    return __builtin_ctzll(match);
+}
+
+void TriageOnchip::shrink(uint64_t set_id, uint32_t max_entries) {
+    while ((uint32_t)__builtin_popcountll(valid_mask[set_id]) > max_entries) {
+        uint32_t victim = repl->pickVictim(set_id);
+        assert(victim < ways && (valid_mask[set_id] & (1ull << victim)));
+        valid_mask[set_id] &= ~(1ull << victim);
+    }
+}
+
+void TriageOnchip::grow() {
+    // the perfect table never evicts, all its sets get twice the ways, up to 64
+    uint32_t new_ways = (2 * ways < 64) ? (2 * ways) : 64;
+
+    vector<uint64_t> new_tags((uint64_t)num_sets * new_ways, 0);
+    vector<TriageOnchipEntry> new_entries((uint64_t)num_sets * new_ways, TriageOnchipEntry());
+    for (uint64_t i = 0; i < num_sets; i++) {
+        for (uint32_t j = 0; j < ways; j++) {
+            new_tags[i*new_ways + j] = tags[i*ways + j];
+            new_entries[i*new_ways + j] = entries[i*ways + j];
+        }
+    }
+
+    tags.swap(new_tags);
+    entries.swap(new_entries);
+    ways = new_ways;
+}
+
+TriageOnchipEntry* TriageOnchip::find_overflow(uint64_t set_id, uint64_t tag) {
+    if (overflow.empty())
+        return NULL;
+    map<uint64_t, TriageOnchipEntry>::iterator it = overflow[set_id].find(tag);
+    return (it == overflow[set_id].end()) ? NULL : &it->second;
+}
+
+// the entry of addr in the ways of its set or in the overflow of the perfect table
+TriageOnchipEntry* TriageOnchip::find_entry(uint64_t addr) {
     uint64_t set_id = get_set_id(addr);
-    assert(set_id < num_sets);
+    uint64_t tag = get_tag(addr);
+    uint32_t way = find_way(set_id, tag);
+    return (way < ways) ? &get_entry(set_id, way) : find_overflow(set_id, tag);
+}
+
+int TriageOnchip::increase_confidence(uint64_t addr) {
     uint64_t line_offset = get_line_offset(addr);
-    uint64_t tag = addr >> ONCHIP_LINE_SHIFT;
-    map<uint64_t, TriageOnchipEntry>& entry_map = entry_list[set_id];
-    map<uint64_t, TriageOnchipEntry>::iterator it = entry_map.find(tag);
+    TriageOnchipEntry *entry = find_entry(addr);
+    if (entry == NULL)
+        return 0;
 
-    it->second.increase_confidence(line_offset);
-    return it->second.confidence[line_offset];
+    entry->increase_confidence(line_offset);
+    return entry->confidence[line_offset];
 }
 
 int TriageOnchip::decrease_confidence(uint64_t addr) {
-    uint64_t set_id = get_set_id(addr);
-    assert(set_id < num_sets);
     uint64_t line_offset = get_line_offset(addr);
-    uint64_t tag = addr >> ONCHIP_LINE_SHIFT;
-    map<uint64_t, TriageOnchipEntry>& entry_map = entry_list[set_id];
-    map<uint64_t, TriageOnchipEntry>::iterator it = entry_map.find(tag);
+    TriageOnchipEntry *entry = find_entry(addr);
+    if (entry == NULL)
+        return 0;
 
-    it->second.decrease_confidence(line_offset);
-    return it->second.confidence[line_offset];
+    entry->decrease_confidence(line_offset);
+    return entry->confidence[line_offset];
 }
 
 void TriageOnchip::update(uint64_t prev_addr, Metadata next_entry, uint64_t pc, bool update_repl) {
+    uint64_t target = encode(next_entry);
+
     if (use_dynamic_assoc) {
         assoc = repl->get_assoc();
     }
     uint64_t set_id = get_set_id(prev_addr);
     assert(set_id < num_sets);
     uint64_t line_offset = get_line_offset(prev_addr);
-    uint64_t tag = prev_addr >> ONCHIP_LINE_SHIFT;
-    map<uint64_t, TriageOnchipEntry>& entry_map = entry_list[set_id];
-    map<uint64_t, TriageOnchipEntry>::iterator it = entry_map.find(tag);
+    uint64_t tag = get_tag(prev_addr);
+    uint32_t way = find_way(set_id, tag);
     debug_cout << hex << "update prev_addr: " << prev_addr
         << ", set_id: " << set_id
         << ", tag: " << tag
         << ", assoc: " << assoc
-        << ", entry map size: " << entry_map.size()
+        << ", set entries: " << __builtin_popcountll(valid_mask[set_id])
         << ", pc: " << pc
         << endl;
-    if (it != entry_map.end()) {
-        while (repl_type != TRIAGE_REPL_PERFECT && entry_map.size() > assoc && entry_map.size() > 0) {
-            uint64_t victim_addr = repl->pickVictim(set_id);
-            assert(entry_map.count(victim_addr));
-            entry_map.erase(victim_addr);
-        }
-        if (assoc > 0) {
-            it->second.metadata[line_offset] = next_entry;
-            it->second.valid[line_offset] = true;
-        }
+
+    // a smaller associativity takes effect, the entry itself may be evicted
+    if (way < ways && repl_type != TRIAGE_REPL_PERFECT) {
+        shrink(set_id, assoc);
+        way = find_way(set_id, tag);
+    }
+
+    TriageOnchipEntry *overflow_entry = (way < ways) ? NULL : find_overflow(set_id, tag);
+    bool full = valid_mask[set_id] == ((ways == 64) ? UINT64_MAX : ((1ull << ways) - 1));
+
+    if (way < ways) {
+        TriageOnchipEntry &entry = get_entry(set_id, way);
+        entry.target[line_offset] = target;
+        entry.valid[line_offset] = true;
         if(update_repl)
-            repl->addEntry(set_id, tag, pc);
+            repl->addEntry(set_id, way, prev_addr, pc, false);
+    } else if (overflow_entry) {
+        overflow_entry->target[line_offset] = target;
+        overflow_entry->valid[line_offset] = true;
+    } else if (repl_type == TRIAGE_REPL_PERFECT && full && ways == 64) {
+        // the ways of the perfect table are all taken, the set goes on in its overflow
+        TriageOnchipEntry &entry = overflow[set_id][tag];
+        entry.init();
+        entry.target[line_offset] = target;
+        entry.confidence[line_offset] = 3;
+        entry.valid[line_offset] = true;
     } else {
-        while (repl_type != TRIAGE_REPL_PERFECT && entry_map.size() >= assoc && entry_map.size() > 0) {
-            uint64_t victim_addr = repl->pickVictim(set_id);
-            assert(entry_map.count(victim_addr));
-            entry_map.erase(victim_addr);
-        }
-        debug_cout << "entry_map_size A: " << entry_map.size() << endl;
-        assert(!entry_map.count(tag));
-        if (assoc > 0) {
-            entry_map[tag].init();
-            entry_map[tag].metadata[line_offset] = next_entry;
-            entry_map[tag].confidence[line_offset] = 3;
-            entry_map[tag].valid[line_offset] = true;
+        if (repl_type == TRIAGE_REPL_PERFECT) {
+            if (full)
+                grow();
+        } else
+            shrink(set_id, (assoc > 0) ? (assoc - 1) : 0);
+
+        if (assoc > 0 || repl_type == TRIAGE_REPL_PERFECT) {
+            way = __builtin_ctzll(~valid_mask[set_id]);
+            assert(way < ways);
+            valid_mask[set_id] |= 1ull << way;
+            tags[set_id*ways + way] = tag;
+
+            TriageOnchipEntry &entry = get_entry(set_id, way);
+            entry.init();
+            entry.target[line_offset] = target;
+            entry.confidence[line_offset] = 3;
+            entry.valid[line_offset] = true;
         }
-        debug_cout << "entry_map_size B: " << entry_map.size() << endl;
-        repl->addEntry(set_id, tag, pc);
+        repl->addEntry(set_id, way, prev_addr, pc, true);
     }
 
     debug_cout << hex << "after update prev_addr: " << prev_addr
         << ", set_id: " << set_id
         << ", tag: " << tag
         << ", assoc: " << assoc
-        << ", entry map size: " << entry_map.size()
+        << ", set entries: " << __builtin_popcountll(valid_mask[set_id])
         << ", pc: " << pc
         << endl;
 
-    assert(entry_map.size() <= assoc);
+    assert(repl_type == TRIAGE_REPL_PERFECT || (uint32_t)__builtin_popcountll(valid_mask[set_id]) <= assoc);
 }
 
 Metadata TriageOnchip::get_next_entry(uint64_t prev_addr, uint64_t pc, bool update_stats) {
@@ -154,21 +409,21 @@ Metadata TriageOnchip::get_next_entry(uint64_t prev_addr, uint64_t pc, bool upda
     uint64_t set_id = get_set_id(prev_addr);
     assert(set_id < num_sets);
     uint64_t line_offset = get_line_offset(prev_addr);
-    uint64_t tag = prev_addr >> ONCHIP_LINE_SHIFT;
-    map<uint64_t, TriageOnchipEntry>& entry_map = entry_list[set_id];
+    uint64_t tag = get_tag(prev_addr);
     debug_cout << hex << "get_next_addr prev_addr: " << prev_addr
         << ", set_id: " << set_id
         << ", tag: " << tag
         << ", pc: " << pc
         << endl;
 
-    map<uint64_t, TriageOnchipEntry>::iterator it = entry_map.find(tag);
+    uint32_t way = find_way(set_id, tag);
+    TriageOnchipEntry *entry = (way < ways) ? &get_entry(set_id, way) : find_overflow(set_id, tag);
 
     Metadata next_entry;
-    if (it != entry_map.end() && (it->second.valid[line_offset])) {
-        next_entry = it->second.metadata[line_offset];
-        if (update_stats) {
-            repl->addEntry(set_id, tag, pc);
+    if (entry && entry->valid[line_offset]) {
+        next_entry = decode(prev_addr, entry->target[line_offset]);
+        if (update_stats && way < ways) {
+            repl->addEntry(set_id, way, prev_addr, pc, false);
         }
     }
     return next_entry;
@@ -179,9 +434,52 @@ uint32_t TriageOnchip::get_assoc()
     return assoc;
 }
 
+void TriageOnchip::checkpoint(CHECKPOINT &cp)
+{
+    assert(repl != NULL);
+    cp.check(num_sets, "triage on-chip sets");
+    cp.check(format, "triage metadata format");
+    cp.io(ways);
+    // the dynamic associativity in use, until the next update asks Hawkeye again
+    cp.io(assoc);
+    cp.io(tags);
+    cp.io(valid_mask);
+    cp.io(entries);
+    cp.io(overflow);
+    region_table.checkpoint(cp);
+    repl->checkpoint(cp);
+}
+
+uint64_t TriageOnchip::occupancy()
+{
+    uint64_t entries = 0;
+    for (uint32_t i = 0; i < num_sets; i++)
+        entries += __builtin_popcountll(valid_mask[i]);
+    for (uint32_t i = 0; i < overflow.size(); i++)
+        entries += overflow[i].size();
+    return entries;
+}
+
+void TriageOnchip::register_stats(std::string prefix)
+{
+    // the on-chip associativity changes over time with the dynamic associativity
+    stats_registry.add(prefix + ".on_chip_assoc", &assoc);
+    stats_registry.add(prefix + ".on_chip_region_misses", &region_table.misses);
+    stats_registry.add(prefix + ".on_chip_region_replacements", &region_table.replacements);
+    stats_registry.add(prefix + ".on_chip_region_invalidated_targets", &region_table.invalidated_targets);
+}
+
 void TriageOnchip::print_stats()
 {
     assert(repl != NULL);
+    const TriageFormatInfo &info = triage_format_info[format];
+    cout << "on_chip_entries=" << occupancy() << endl;
+    cout << "on_chip_format=" << info.name << endl;
+    cout << "on_chip_entry_bytes=" << info.entry_bytes << endl;
+    cout << "on_chip_entries_per_line=" << (TRIAGE_METADATA_LINE_BYTES / info.entry_bytes) << endl;
+    cout << "on_chip_capacity_KB=" << ((uint64_t)num_sets * assoc * info.entry_bytes / 1024) << endl;
+    cout << "on_chip_region_misses=" << region_table.misses << endl;
+    cout << "on_chip_region_replacements=" << region_table.replacements << endl;
+    cout << "on_chip_region_invalidated_targets=" << region_table.invalidated_targets << endl;
     repl->print_stats();
 }
-
@@ -5,8 +5,8 @@
 #include <map>
 #include <set>
 #include <stdint.h>
+#include "checkpoint.h"
 #include "triage_training_unit.h"
-#include "optgen_simple.h"
 #include "isb_hawkeye_predictor.h"
 
 #define ONCHIP_LINE_SIZE 1
@@ -21,42 +21,92 @@ enum TriageReplType {
     TRIAGE_REPL_PERFECT
 };
 
+// encodings of an on-chip entry: a trigger tag, a target, a spatial bit and 2 confidence bits
+// the table is sized in bytes, a way holds on_chip_way_bytes / entry_bytes entries, so the smaller formats
+// hold more correlations in the same ways of the LLC, TRIAGE_METADATA_LINE_BYTES / entry_bytes per metadata line
+// a partial tag keeps tag_bits of the trigger above the set index, triggers that agree in these bits alias
+// a compressed target is the index of its region in the TriageRegionTable and the offset_bits of the target in it,
+// a spatial entry keeps the delta and length of its pattern in the target field instead
+enum TriageMetadataFormat {
+    TRIAGE_FORMAT_FULL, // 16B, full tag and target
+    TRIAGE_FORMAT_COMPACT, // 8B, 23-bit tag, 12-bit region and 26-bit offset
+    TRIAGE_FORMAT_COMPRESSED // 4B, 10-bit tag, 8-bit region and 11-bit offset, the entries of the Triage paper
+};
+
+struct TriageFormatInfo {
+    const char *name;
+    uint32_t entry_bytes, tag_bits, region_bits, offset_bits; // 0 tag and offset bits are the full address
+};
+
+#define TRIAGE_FORMAT_COUNT 3
+#define TRIAGE_METADATA_LINE_BYTES 64
+extern TriageFormatInfo triage_format_info[TRIAGE_FORMAT_COUNT];
+
+// the encoded target of an entry, the pattern in the low 16 bits if spatial
+#define TRIAGE_TARGET_SPATIAL (1ull << 63)
+
+// the upper bits of the compressed targets, 2^region_bits regions of TRIAGE_REGION_WAYS ways with LRU
+// the targets of a replaced region are invalidated, they would decode to addresses in the region that took its place
+#define TRIAGE_REGION_WAYS 16
+
+class TriageRegionTable {
+    std::vector<uint64_t> regions, last_used;
+    std::vector<uint8_t> valid;
+    uint32_t num_sets, assoc;
+    uint64_t timer;
+
+    public:
+        uint64_t misses, replacements, invalidated_targets;
+
+        TriageRegionTable() : num_sets(0), assoc(0), timer(0), misses(0), replacements(0), invalidated_targets(0) {}
+        void init(uint32_t region_bits);
+        uint32_t insert(uint64_t region, bool &replaced);
+        bool get_region(uint32_t index, uint64_t &region);
+        void checkpoint(CHECKPOINT &cp);
+};
+
+// one way of the on-chip table, its tag is kept apart in TriageOnchip::tags
 struct TriageOnchipEntry {
-    Metadata metadata[ONCHIP_LINE_SIZE];
+    uint64_t target[ONCHIP_LINE_SIZE];
 
-    int confidence[ONCHIP_LINE_SIZE];
+    uint8_t confidence[ONCHIP_LINE_SIZE];
     bool valid[ONCHIP_LINE_SIZE];
     // Used for replacement policy, it is rrpv for rrpv-based replacement
-    // policies, but can be used for other usages (like frequency in LFU）
-    uint64_t rrpv;
+    // policies, and the position in the recency stack for LRU
+    uint8_t rrpv;
 
     TriageOnchipEntry();
     void increase_confidence(unsigned);
     void decrease_confidence(unsigned);
     void init();
+    void checkpoint(CHECKPOINT &cp);
 };
 
+class TriageOnchip;
+
+// the policies pick ways of a set of the on-chip table, addEntry() gets the way of the accessed entry,
+// or the number of ways when it is not in the table, and inserted when the entry was just allocated
 class TriageRepl {
     protected:
-        std::vector<std::map<uint64_t, TriageOnchipEntry> > *entry_list;
+        TriageOnchip *table;
         TriageReplType type;
 
     public:
-        TriageRepl(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list);
-        virtual void addEntry(uint64_t set_id, uint64_t addr, uint64_t pc) = 0;
-        virtual uint64_t pickVictim(uint64_t set_id) = 0;
+        TriageRepl(TriageOnchip *table);
+        virtual void addEntry(uint64_t set_id, uint32_t way, uint64_t addr, uint64_t pc, bool inserted) = 0;
+        virtual uint32_t pickVictim(uint64_t set_id) = 0;
         virtual void print_stats() {}
         virtual uint32_t get_assoc() { return 8; }
+        virtual void checkpoint(CHECKPOINT &cp) {}
 
-        static TriageRepl* create_repl(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list,
-                TriageReplType type, uint64_t assoc, bool use_dynamic_assoc);
+        static TriageRepl* create_repl(TriageOnchip *table, TriageReplType type, uint64_t assoc, bool use_dynamic_assoc);
 };
 
 class TriageReplLRU : public TriageRepl {
     public:
-        TriageReplLRU(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list);
-        void addEntry(uint64_t set_id, uint64_t addr, uint64_t pc);
-        uint64_t pickVictim(uint64_t set_id);
+        TriageReplLRU(TriageOnchip *table);
+        void addEntry(uint64_t set_id, uint32_t way, uint64_t addr, uint64_t pc, bool inserted);
+        uint32_t pickVictim(uint64_t set_id);
 };
 
 // Two sampled optgen: assoc of 4 and 8.
@@ -64,48 +114,108 @@ class TriageReplLRU : public TriageRepl {
 #define HAWKEYE_SAMPLE_ASSOC_COUNT 2
 #define HAWKEYE_EPOCH_LENGTH 1000
 extern unsigned hawkeye_sample_assoc[];
+
+// Hawkeye only watches a few sets of the table, their accesses train the predictor for all of them
+// Budget = sampled sets * (sampler + 2 occupancy vectors + timer + signatures) + predictor + 2 bits per entry,
+// print_stats() reports it for the configured table
+#define HAWKEYE_SAMPLED_SETS 128 // power of two
+#define HAWKEYE_SAMPLER_WAYS 32 // history entries per sampled set
+#define HAWKEYE_SAMPLER_TAG_BITS 16 // partial tag of the history entries
+#define HAWKEYE_OPTGEN_SIZE 64 // quanta of an occupancy vector, 8x the largest sampled assoc, power of two
+
+// one address in the history of a sampled set, the timestamp is a counter here and
+// log2(HAWKEYE_OPTGEN_SIZE)+1 bits in hardware, older entries are out of the window anyway
+struct TriageSamplerEntry {
+    bool valid;
+    uint16_t tag;
+    uint16_t signature;
+    uint32_t last_quanta;
+
+    TriageSamplerEntry() : valid(false), tag(0), signature(0), last_quanta(0) {}
+};
+
+// OPTgen with an occupancy vector of HAWKEYE_OPTGEN_SIZE quanta in a circular buffer
+// a usage interval longer than the vector is a miss of OPT
+struct TriageOptgen {
+    std::vector<uint8_t> liveness;
+    uint64_t capacity, access, num_cache, num_dont_cache;
+
+    void init(uint64_t size);
+    void add_access(uint64_t curr_quanta);
+    bool should_cache(uint64_t curr_quanta, uint64_t last_quanta);
+    void checkpoint(CHECKPOINT &cp);
+};
+
 class TriageReplHawkeye : public TriageRepl {
     unsigned max_rrpv;
-    std::vector<uint64_t> optgen_mytimer;
-    //std::vector<OPTgen> optgen;
+    uint32_t sampled_sets, sample_shift;
+    std::vector<uint32_t> optgen_mytimer;
     unsigned dynamic_optgen_choice;
-    std::vector<std::vector<OPTgen> > sample_optgen;
-    std::map<uint64_t, ADDR_INFO> optgen_addr_history;
-    std::map<uint64_t, uint64_t> signatures;
-    std::map<uint64_t, uint32_t> hawkeye_pc_ps_hit_predictions;
-    std::map<uint64_t, uint32_t> hawkeye_pc_ps_total_predictions;
+    // per sampled set
+    std::vector<std::vector<TriageOptgen> > sample_optgen;
+    std::vector<TriageSamplerEntry> sampler;
+    // signature of the last PC to touch each way of the sampled sets, for detraining on evictions
+    std::vector<uint16_t> signatures;
     IsbHawkeyePCPredictor predictor;
     uint64_t last_access_count, curr_access_count;
+    uint64_t optgen_choices[HAWKEYE_SAMPLE_ASSOC_COUNT+1];
     bool use_dynamic;
 
+    uint32_t get_sample_id(uint64_t set_id);
     void choose_optgen();
 
     public:
-        TriageReplHawkeye(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list, uint64_t assoc, bool use_dynamic_assoc);
-        void addEntry(uint64_t set_id, uint64_t addr, uint64_t pc);
-        uint64_t pickVictim(uint64_t set_id);
+        TriageReplHawkeye(TriageOnchip *table, uint64_t assoc, bool use_dynamic_assoc);
+        void addEntry(uint64_t set_id, uint32_t way, uint64_t addr, uint64_t pc, bool inserted);
+        uint32_t pickVictim(uint64_t set_id);
         uint32_t get_assoc();
+        void checkpoint(CHECKPOINT &cp);
+        uint64_t storage_bits();
 
         void print_stats();
 };
 
 class TriageReplPerfect : public TriageRepl {
     public:
-        TriageReplPerfect(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list);
-        void addEntry(uint64_t set_id, uint64_t addr, uint64_t pc);
-        uint64_t pickVictim(uint64_t set_id);
+        TriageReplPerfect(TriageOnchip *table);
+        void addEntry(uint64_t set_id, uint32_t way, uint64_t addr, uint64_t pc, bool inserted);
+        uint32_t pickVictim(uint64_t set_id);
 };
 
+// set-associative table of the correlations, ways entries per set in one array, the entries are kept encoded
+// in the configured format
+// the tags of a set are contiguous and matched with one vector compare as in CACHE::get_way(),
+// valid_mask has a bit per way (at most 64)
+// assoc is the associativity in use, up to ways: the dynamic associativity of Hawkeye shrinks a set
+// when it is next updated, and the perfect table doubles the ways when a set is full, up to 64 ways
+// and then keeps the further entries of a set in its overflow
 class TriageOnchip {
-    uint32_t num_sets, assoc;
+    uint32_t num_sets, assoc, ways, set_bits;
     uint64_t index_mask;
-    std::vector<std::map<uint64_t, TriageOnchipEntry> > entry_list;
+    TriageMetadataFormat format;
+    uint64_t tag_mask, offset_mask;
+    uint32_t offset_bits;
+    TriageRegionTable region_table;
+    std::vector<uint64_t> tags, valid_mask;
+    std::vector<TriageOnchipEntry> entries;
+    // the entries of the perfect table beyond 64 ways, by tag, one map per set
+    std::vector<std::map<uint64_t, TriageOnchipEntry> > overflow;
     TriageReplType repl_type;
     TriageRepl *repl;
     bool use_dynamic_assoc;
 
     uint64_t get_set_id(uint64_t addr);
     uint64_t get_line_offset(uint64_t addr);
+    uint64_t get_tag(uint64_t addr);
+    uint32_t find_way(uint64_t set_id, uint64_t tag);
+    TriageOnchipEntry* find_overflow(uint64_t set_id, uint64_t tag);
+    TriageOnchipEntry* find_entry(uint64_t addr);
+    uint64_t encode(const Metadata &entry);
+    Metadata decode(uint64_t trigger, uint64_t target);
+    void invalidate_region(uint64_t region);
+    void invalidate_region(TriageOnchipEntry &entry, uint64_t region);
+    void shrink(uint64_t set_id, uint32_t max_entries);
+    void grow();
 
     public:
         TriageOnchip();
@@ -115,10 +225,21 @@ class TriageOnchip {
         Metadata get_next_entry(uint64_t prev_addr, uint64_t pc, bool update_stats);
         int increase_confidence(uint64_t addr);
         int decrease_confidence(uint64_t addr);
+        // the 64B metadata line of the entry of addr, the entries of consecutive sets share a line
+        uint64_t get_metadata_line(uint64_t addr);
+
+        // used by the replacement policies
+        uint32_t get_ways() { return ways; }
+        uint32_t get_num_sets() { return num_sets; }
+        uint64_t get_valid_mask(uint64_t set_id) { return valid_mask[set_id]; }
+        uint64_t get_tag(uint64_t set_id, uint32_t way) { return tags[set_id*ways + way]; }
+        TriageOnchipEntry& get_entry(uint64_t set_id, uint32_t way) { return entries[set_id*ways + way]; }
 
         void print_stats();
+        void register_stats(std::string prefix);
         uint32_t get_assoc();
+        uint64_t occupancy();
+        void checkpoint(CHECKPOINT &cp);
 };
 
 #endif // __TRIAGE_ONCHIP_H__
-
@@ -17,19 +17,19 @@ using namespace std;
 
 unsigned hawkeye_sample_assoc[] = {4,8};
 
-TriageRepl::TriageRepl(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list) : entry_list(entry_list) {}
+TriageRepl::TriageRepl(TriageOnchip *table) : table(table) {}
 
-TriageRepl* TriageRepl::create_repl(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list, TriageReplType repl_type, uint64_t assoc, bool use_dynamic_assoc) {
+TriageRepl* TriageRepl::create_repl(TriageOnchip *table, TriageReplType repl_type, uint64_t assoc, bool use_dynamic_assoc) {
     TriageRepl *repl;
     switch (repl_type) {
         case TRIAGE_REPL_LRU:
-            repl = new TriageReplLRU(entry_list);
+            repl = new TriageReplLRU(table);
             break;
         case TRIAGE_REPL_HAWKEYE:
-            repl = new TriageReplHawkeye(entry_list, assoc, use_dynamic_assoc);
+            repl = new TriageReplHawkeye(table, assoc, use_dynamic_assoc);
             break;
         case TRIAGE_REPL_PERFECT:
-            repl = new TriageReplPerfect(entry_list);
+            repl = new TriageReplPerfect(table);
             break;
         default:
             cerr << "Unknown repl type: " << repl_type <<endl;
@@ -38,45 +38,89 @@ TriageRepl* TriageRepl::create_repl(std::vector<std::map<uint64_t, TriageOnchipE
     return repl;
 }
 
-TriageReplLRU::TriageReplLRU(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list) : TriageRepl(entry_list) {}
+TriageReplLRU::TriageReplLRU(TriageOnchip *table) : TriageRepl(table) {}
 
-void TriageReplLRU::addEntry(uint64_t set_id, uint64_t addr, uint64_t pc) {
-    map<uint64_t, TriageOnchipEntry>& entry_map = (*entry_list)[set_id];
-    map<uint64_t, TriageOnchipEntry>::iterator it = entry_map.find(addr);
-    assert(it != entry_map.end());
-    // Lower RRPV is more recently used
-    for (map<uint64_t, TriageOnchipEntry>::iterator jt = entry_map.begin(); jt != entry_map.end(); ++jt)
-        jt->second.rrpv++;
-    it->second.rrpv = 0;
+void TriageReplLRU::addEntry(uint64_t set_id, uint32_t way, uint64_t addr, uint64_t pc, bool inserted) {
+    uint32_t ways = table->get_ways();
+    if (way == ways)
+        return;
+
+    // Lower RRPV is more recently used, the entries that were more recent than this one age by one
+    uint64_t valid = table->get_valid_mask(set_id);
+    uint8_t position = inserted ? UINT8_MAX : table->get_entry(set_id, way).rrpv;
+    for (uint32_t i = 0; i < ways; i++) {
+        TriageOnchipEntry &entry = table->get_entry(set_id, i);
+        if ((valid & (1ull << i)) && i != way && entry.rrpv < position)
+            entry.rrpv++;
+    }
+    table->get_entry(set_id, way).rrpv = 0;
 
     debug_cout << "ReplLRU addEntry: set_id: " << hex << set_id << ", addr: " << addr << endl;
 }
 
-uint64_t TriageReplLRU::pickVictim(uint64_t set_id) {
-    uint32_t max_ts = 0;
-    map<uint64_t, TriageOnchipEntry>& entry_map = (*entry_list)[set_id];
-    map<uint64_t, TriageOnchipEntry>::iterator max_it = entry_map.begin();
-    for (auto it = entry_map.begin(); it != entry_map.end(); ++it) {
-        if (it->second.rrpv > max_ts) {
-            max_ts = it->second.rrpv;
-            max_it = it;
+uint32_t TriageReplLRU::pickVictim(uint64_t set_id) {
+    uint32_t max_ts = 0, ways = table->get_ways(), victim = ways;
+    uint64_t valid = table->get_valid_mask(set_id);
+    for (uint32_t i = 0; i < ways; i++) {
+        if ((valid & (1ull << i)) && (victim == ways || table->get_entry(set_id, i).rrpv > max_ts)) {
+            max_ts = table->get_entry(set_id, i).rrpv;
+            victim = i;
         }
     }
 
-    assert(max_it != entry_map.end());
-    uint64_t addr = max_it->first;
+    assert(victim < ways);
+
+    debug_cout << "ReplLRU pickVictim: set_id: " << hex << set_id << ", victim: " << table->get_tag(set_id, victim) << ", rrpv: " << max_ts << endl;
+    return victim;
+}
+
+void TriageOptgen::init(uint64_t size) {
+    liveness.assign(HAWKEYE_OPTGEN_SIZE, 0);
+    capacity = size;
+    access = num_cache = num_dont_cache = 0;
+}
+
+void TriageOptgen::add_access(uint64_t curr_quanta) {
+    access++;
+    liveness[curr_quanta & (HAWKEYE_OPTGEN_SIZE-1)] = 0;
+}
+
+bool TriageOptgen::should_cache(uint64_t curr_quanta, uint64_t last_quanta) {
+    bool is_cache = (curr_quanta - last_quanta < HAWKEYE_OPTGEN_SIZE);
+    for (uint64_t i = last_quanta; is_cache && i != curr_quanta; i++) {
+        if (liveness[i & (HAWKEYE_OPTGEN_SIZE-1)] >= capacity)
+            is_cache = false;
+    }
+
+    if (is_cache) {
+        for (uint64_t i = last_quanta; i != curr_quanta; i++)
+            liveness[i & (HAWKEYE_OPTGEN_SIZE-1)]++;
+        num_cache++;
+    } else {
+        num_dont_cache++;
+    }
+    return is_cache;
+}
 
-    debug_cout << "ReplLRU pickVictim: set_id: " << hex << set_id << ", victim: " << addr << ", rrpv: " << max_ts << endl;
-    return addr;
+void TriageOptgen::checkpoint(CHECKPOINT &cp) {
+    cp.check(capacity, "OPTgen size");
+    cp.io(liveness);
+    cp.io(access);
+    cp.io(num_cache);
+    cp.io(num_dont_cache);
 }
 
-TriageReplHawkeye::TriageReplHawkeye(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list, uint64_t assoc, bool use_dynamic_assoc) 
-        : TriageRepl(entry_list) {
+TriageReplHawkeye::TriageReplHawkeye(TriageOnchip *table, uint64_t assoc, bool use_dynamic_assoc) 
+        : TriageRepl(table) {
     max_rrpv = 3;
-    uint64_t num_sets = entry_list->size();
-    optgen_mytimer.resize(num_sets);
-    optgen_addr_history.clear();
-    cout << "Init TriageReplHawkeye, assoc: " << assoc << ", use_dynamic_assoc: " << use_dynamic_assoc << endl;
+    uint32_t num_sets = table->get_num_sets();
+    sampled_sets = (num_sets < HAWKEYE_SAMPLED_SETS) ? num_sets : HAWKEYE_SAMPLED_SETS;
+    sample_shift = __builtin_ctz(num_sets) - __builtin_ctz(sampled_sets);
+    optgen_mytimer.resize(sampled_sets);
+    sampler.resize(sampled_sets * HAWKEYE_SAMPLER_WAYS);
+    signatures.resize(sampled_sets * table->get_ways());
+    cout << "Init TriageReplHawkeye, assoc: " << assoc << ", use_dynamic_assoc: " << use_dynamic_assoc
+        << ", sampled sets: " << sampled_sets << endl;
 
     last_access_count = curr_access_count = 0;
     if (assoc==4) {
@@ -86,11 +130,13 @@ TriageReplHawkeye::TriageReplHawkeye(std::vector<std::map<uint64_t, TriageOnchip
     } else {
         dynamic_optgen_choice = 1;
     }
+    for (unsigned l = 0; l <= HAWKEYE_SAMPLE_ASSOC_COUNT; l++)
+        optgen_choices[l] = 0;
     use_dynamic = use_dynamic_assoc;
     sample_optgen.resize(HAWKEYE_SAMPLE_ASSOC_COUNT);
     for (unsigned l = 0; l < HAWKEYE_SAMPLE_ASSOC_COUNT; ++l) {
-        sample_optgen[l].resize(num_sets);
-        for (size_t i = 0; i < num_sets; ++i) {
+        sample_optgen[l].resize(sampled_sets);
+        for (size_t i = 0; i < sampled_sets; ++i) {
             sample_optgen[l][i].init(hawkeye_sample_assoc[l]-2);
         }
     }
@@ -99,11 +145,20 @@ TriageReplHawkeye::TriageReplHawkeye(std::vector<std::map<uint64_t, TriageOnchip
 #include <math.h>
 #define bitmask(l) (((l) == 64) ? (unsigned long long)(-1LL) : ((1LL << (l))-1LL))
 #define bits(x, i, l) (((x) >> (i)) & bitmask(l))
-#define SAMPLED_SET(set) true
 
-void TriageReplHawkeye::addEntry(uint64_t set_id, uint64_t addr, uint64_t pc) {
+// the sampled sets are spread over the table, the upper index bits pick one and
+// its lower index bits have to repeat them, returns sampled_sets for the others
+uint32_t TriageReplHawkeye::get_sample_id(uint64_t set_id) {
+    uint64_t sample_id = set_id >> sample_shift;
+    if (bits(set_id, 0, sample_shift) != bits(sample_id, 0, sample_shift))
+        return sampled_sets;
+    return sample_id;
+}
+
+void TriageReplHawkeye::addEntry(uint64_t set_id, uint32_t way, uint64_t addr, uint64_t pc, bool inserted) {
     debug_cout << hex << "Hawkeye addEntry: set_id: " << set_id << ", addr: " << addr << ", pc: " << pc << endl;
-    map<uint64_t, TriageOnchipEntry>& entry_map = (*entry_list)[set_id];
+    uint32_t ways = table->get_ways();
+    uint64_t valid = table->get_valid_mask(set_id);
     if (use_dynamic) {
         if (curr_access_count - last_access_count > HAWKEYE_EPOCH_LENGTH) {
             choose_optgen();
@@ -113,109 +168,116 @@ void TriageReplHawkeye::addEntry(uint64_t set_id, uint64_t addr, uint64_t pc) {
         }
     }
     debug_cout << "hawkeye optgen choice: " << dynamic_optgen_choice << endl;
-    if (SAMPLED_SET(set_id)) {
-        uint64_t curr_quanta = optgen_mytimer[set_id];
+    uint32_t sample_id = get_sample_id(set_id);
+    if (sample_id < sampled_sets) {
+        uint32_t curr_quanta = optgen_mytimer[sample_id];
+        uint16_t tag = bits(addr >> __builtin_ctz(table->get_num_sets()), 0, HAWKEYE_SAMPLER_TAG_BITS);
+        uint16_t signature = IsbHawkeyePCPredictor::signature(pc);
         bool opt_hit[] = {false, false};
 
-        signatures[addr] = pc;
-        if (optgen_addr_history.find(addr) != optgen_addr_history.end()) {
-            uint64_t last_quanta = optgen_addr_history[addr].last_quanta;
-            assert(curr_quanta >= last_quanta);
+        if (way < ways)
+            signatures[sample_id*ways + way] = signature;
+
+        // the history entry of the address, or the oldest one of the set
+        TriageSamplerEntry *history = &sampler[sample_id * HAWKEYE_SAMPLER_WAYS];
+        uint32_t match = HAWKEYE_SAMPLER_WAYS, victim = 0;
+        for (uint32_t i = 0; i < HAWKEYE_SAMPLER_WAYS; i++) {
+            if (history[i].valid && history[i].tag == tag) {
+                match = i;
+                break;
+            }
+            if (history[victim].valid && (!history[i].valid || history[i].last_quanta < history[victim].last_quanta))
+                victim = i;
+        }
+
+        if (match < HAWKEYE_SAMPLER_WAYS) {
+            uint32_t last_quanta = history[match].last_quanta;
+            uint16_t last_signature = history[match].signature;
+            assert(curr_quanta > last_quanta);
 
-            uint64_t last_pc = optgen_addr_history[addr].PC;
-//            opt_hit = optgen[set_id].should_cache(curr_quanta, last_quanta, false, 0); //TODO: CPU
             for (unsigned l = 0; l < HAWKEYE_SAMPLE_ASSOC_COUNT; l++) {
-                assert(curr_quanta > last_quanta);
-                opt_hit[l] = sample_optgen[l][set_id].should_cache(curr_quanta, last_quanta, false);
-                sample_optgen[l][set_id].add_access(curr_quanta);
+                opt_hit[l] = sample_optgen[l][sample_id].should_cache(curr_quanta, last_quanta);
+                sample_optgen[l][sample_id].add_access(curr_quanta);
                 debug_cout << l << " SHOULD CACHE ADDR: " << hex << addr << ", opt_hit: " << dec << opt_hit[l]
                     << ", curr_quanta: " << curr_quanta << ", last_quanta: " << last_quanta
                     << endl;
             }
             if (dynamic_optgen_choice != 2) {
                 if (opt_hit[dynamic_optgen_choice]) {
-                    predictor.increment(last_pc);
+                    predictor.increment_signature(last_signature);
                 } else {
-                    //predictor.decrement(last_pc|(bits(set_id,6,13)<<24));
-                    predictor.decrement(last_pc);
+                    predictor.decrement_signature(last_signature);
                 }
-                debug_cout <<  "Train: " << hex << last_pc << " " << dec << opt_hit[dynamic_optgen_choice] << endl;
+                debug_cout <<  "Train: " << hex << last_signature << " " << dec << opt_hit[dynamic_optgen_choice] << endl;
             }
-            //Some maintenance operations for OPTgen
-            //optgen[set_id].add_access(curr_quanta, 0); //TODO: CPU
         } else {
             //Initialize a new entry in the sampler
-            optgen_addr_history[addr].init(curr_quanta);
-            //optgen[set_id].add_access(curr_quanta, 0); //TODO: CPU
+            match = victim;
+            history[match].valid = true;
+            history[match].tag = tag;
             for (uint32_t l = 0; l < HAWKEYE_SAMPLE_ASSOC_COUNT; l++)
-                sample_optgen[l][set_id].add_access(curr_quanta);
+                sample_optgen[l][sample_id].add_access(curr_quanta);
         }
 
-        optgen_addr_history[addr].update(optgen_mytimer[set_id], pc, false);
-        optgen_mytimer[set_id]++;
+        history[match].last_quanta = curr_quanta;
+        history[match].signature = signature;
+        optgen_mytimer[sample_id]++;
     }
 
     bool prediction = predictor.get_prediction(pc);
 
     debug_cout <<  "Predict: " << hex << pc << " " << dec << prediction << endl;
-    if (hawkeye_pc_ps_total_predictions.find(pc) == hawkeye_pc_ps_total_predictions.end()) {
-        hawkeye_pc_ps_total_predictions[pc] = 0;
-        hawkeye_pc_ps_hit_predictions[pc] = 0;
-    }
-    hawkeye_pc_ps_total_predictions[pc]++;
     if (prediction) {
-        hawkeye_pc_ps_hit_predictions[pc]++;
         bool saturated = false;
-        for(map<uint64_t, TriageOnchipEntry>::iterator it = entry_map.begin();
-                it != entry_map.end(); ++it) {
-            if (it->second.rrpv >= max_rrpv-1)
+        for (uint32_t i = 0; i < ways; i++) {
+            if ((valid & (1ull << i)) && table->get_entry(set_id, i).rrpv >= max_rrpv-1)
                 saturated = true;
         }
         //Age all the cache-friendly  lines
-        for (auto it = entry_map.begin(); it != entry_map.end(); ++it) {
-            if (!saturated && it->second.rrpv < max_rrpv-1)
-                it->second.rrpv++;
+        for (uint32_t i = 0; i < ways; i++) {
+            TriageOnchipEntry &entry = table->get_entry(set_id, i);
+            if ((valid & (1ull << i)) && !saturated && entry.rrpv < max_rrpv-1)
+                entry.rrpv++;
         }
-        if (entry_map.count(addr))
-            entry_map[addr].rrpv = 0;
+        if (way < ways)
+            table->get_entry(set_id, way).rrpv = 0;
     } else {
-        if (entry_map.count(addr))
-            entry_map[addr].rrpv = max_rrpv;
+        if (way < ways)
+            table->get_entry(set_id, way).rrpv = max_rrpv;
     }
-    debug_cout << "AddEntry after Entry Map size: " << entry_map.size() << endl;
+    debug_cout << "AddEntry after set entries: " << __builtin_popcountll(valid) << endl;
 }
 
-uint64_t TriageReplHawkeye::pickVictim(uint64_t set_id) {
-    map<uint64_t, TriageOnchipEntry>& entry_map = (*entry_list)[set_id];
-    debug_cout << "PickVictim before Entry Map size: " << entry_map.size() << endl;
-    for(auto it = entry_map.begin(); it != entry_map.end(); it++)
-        debug_cout << "entry_map[" << it->first << "] = " << it->second.rrpv << endl;
-
-    for(auto it = entry_map.begin(); it != entry_map.end(); it++) {
-        if (it->second.rrpv == max_rrpv) {
-            uint64_t addr = it->first;
-            return addr;
-        }
+uint32_t TriageReplHawkeye::pickVictim(uint64_t set_id) {
+    uint32_t ways = table->get_ways();
+    uint64_t valid = table->get_valid_mask(set_id);
+    debug_cout << "PickVictim before set entries: " << __builtin_popcountll(valid) << endl;
+    for (uint32_t i = 0; i < ways; i++)
+        if (valid & (1ull << i))
+            debug_cout << "way[" << i << "] = " << table->get_tag(set_id, i) << ", rrpv: " << +table->get_entry(set_id, i).rrpv << endl;
+
+    for (uint32_t i = 0; i < ways; i++) {
+        if ((valid & (1ull << i)) && table->get_entry(set_id, i).rrpv == max_rrpv)
+            return i;
     }
 
     //If we cannot find a cache-averse line, we evict the oldest cache-friendly line
-    uint32_t max_rrip = 0;
-    uint64_t lru_victim = 0;
-    for (auto it = entry_map.begin(); it != entry_map.end(); ++it) {
-        if (it->second.rrpv >= max_rrip)
+    uint32_t max_rrip = 0, lru_victim = ways;
+    for (uint32_t i = 0; i < ways; i++) {
+        if ((valid & (1ull << i)) && table->get_entry(set_id, i).rrpv >= max_rrip)
         {
-            max_rrip = it->second.rrpv;
-            lru_victim = it->first;
+            max_rrip = table->get_entry(set_id, i).rrpv;
+            lru_victim = i;
         }
     }
-    assert(entry_map.count(lru_victim));
+    assert(lru_victim < ways);
 
     //The predictor is trained negatively on LRU evictions
-    if ( SAMPLED_SET(set) ) {
-        debug_cout << "Detrain: " << hex << signatures[lru_victim] << dec<< endl;
-        predictor.decrement(signatures[lru_victim]);
+    uint32_t sample_id = get_sample_id(set_id);
+    if (sample_id < sampled_sets) {
+        debug_cout << "Detrain: " << hex << signatures[sample_id*ways + lru_victim] << dec<< endl;
+        predictor.decrement_signature(signatures[sample_id*ways + lru_victim]);
     }
-    debug_cout << "PickVictim after Entry List size: " << entry_map.size() << endl;
     return lru_victim;
 }
 
@@ -225,13 +287,16 @@ void TriageReplHawkeye::choose_optgen() {
     double hit_rate[HAWKEYE_SAMPLE_ASSOC_COUNT];
     for (unsigned l = 0; l < HAWKEYE_SAMPLE_ASSOC_COUNT; l++) {
         uint64_t access = 0, hits = 0;
-        for (size_t i = 0; i < sample_optgen[0].size(); i++) {
+        for (size_t i = 0; i < sampled_sets; i++) {
             debug_cout << "sampleoptgen[" << l << "][" << i << "].access = " << sample_optgen[l][i].access
-                << ", hits = " << sample_optgen[l][i].get_num_opt_hits() << endl;
+                << ", hits = " << sample_optgen[l][i].num_cache << endl;
 
             access += sample_optgen[l][i].access;
-            hits +=  sample_optgen[l][i].get_num_opt_hits();
+            hits +=  sample_optgen[l][i].num_cache;
         }
+        // the sampled sets have not seen anything yet, keep the choice
+        if (access == 0)
+            return;
         hit_rate[l] = double(hits) / double(access);
     }
     // XXX Ad-hoc way of choosing the optgen
@@ -242,7 +307,8 @@ void TriageReplHawkeye::choose_optgen() {
     } else {
         dynamic_optgen_choice = 2;
     }
-    cout << "hit_rate[0]: " << hit_rate[0] << ", hit_rate[1]: " << hit_rate[1] << ", dynamic_optgen_choice: " << dynamic_optgen_choice << endl;
+    optgen_choices[dynamic_optgen_choice]++;
+    debug_cout << "hit_rate[0]: " << hit_rate[0] << ", hit_rate[1]: " << hit_rate[1] << ", dynamic_optgen_choice: " << dynamic_optgen_choice << endl;
 }
 
 uint32_t TriageReplHawkeye::get_assoc() {
@@ -259,30 +325,49 @@ uint32_t TriageReplHawkeye::get_assoc() {
     }
 }
 
+void TriageReplHawkeye::checkpoint(CHECKPOINT &cp) {
+    cp.check(sampled_sets, "hawkeye sampled sets");
+    cp.io(optgen_mytimer);
+    cp.io(dynamic_optgen_choice);
+    cp.io(sample_optgen);
+    cp.io(sampler);
+    cp.io(signatures);
+    cp.io(predictor);
+    cp.io(last_access_count);
+    cp.io(curr_access_count);
+    cp.io_array(optgen_choices, HAWKEYE_SAMPLE_ASSOC_COUNT+1);
+}
+
+// bits to hold the values 0..n
+static uint64_t width(uint64_t n) {
+    uint64_t w = 1;
+    while ((n >> w) != 0)
+        w++;
+    return w;
+}
+
+// what the policy would cost in hardware for the configured table
+uint64_t TriageReplHawkeye::storage_bits() {
+    uint64_t timestamp = width(HAWKEYE_OPTGEN_SIZE);
+    uint64_t sampler_entry = 1 + HAWKEYE_SAMPLER_TAG_BITS + SHCT_SIZE_BITS + timestamp;
+    uint64_t sample_set = HAWKEYE_SAMPLER_WAYS * sampler_entry + timestamp + table->get_ways() * SHCT_SIZE_BITS;
+    for (unsigned l = 0; l < HAWKEYE_SAMPLE_ASSOC_COUNT; l++)
+        sample_set += HAWKEYE_OPTGEN_SIZE * width(hawkeye_sample_assoc[l]);
+
+    return sampled_sets * sample_set
+        + (uint64_t)SHCT_SIZE * width(MAX_SHCT)
+        + (uint64_t)table->get_num_sets() * table->get_ways() * width(max_rrpv);
+}
+
 void TriageReplHawkeye::print_stats()
 {
-    unsigned int hits = 0, access = 0, traffic = 0;
-    /*
-    for(unsigned int i=0; i<optgen.size(); i++)
-    {
-        access += optgen[i].access;
-        hits += optgen[i].get_num_opt_hits();
-        traffic += optgen[i].get_traffic();
-    }
-
-    std::cout << "OPTgen accesses: " << access
-        << ", hits: " << hits
-        << ", traffic: " << traffic
-        << ", hit rate: " << double(hits) / double(access)
-        << ", traffic rate: " << double(traffic) / double(access)
-        << std::endl;
-    */
+    uint64_t hits = 0, access = 0, traffic = 0;
     for (unsigned l = 0; l < HAWKEYE_SAMPLE_ASSOC_COUNT; ++l) {
         access = 0, hits = 0, traffic = 0;
-        for (size_t i = 0; i < sample_optgen[l].size(); ++i) {
+        for (size_t i = 0; i < sampled_sets; ++i) {
             access += sample_optgen[l][i].access;
-            hits +=  sample_optgen[l][i].get_num_opt_hits();
-            traffic +=  sample_optgen[l][i].get_traffic();
+            hits +=  sample_optgen[l][i].num_cache;
+            traffic +=  sample_optgen[l][i].access - sample_optgen[l][i].num_cache;
         }
         std::cout << "SAMPLEOPTGEN " << l << " accesses: " << access
             << ", hits: " << hits
@@ -291,16 +376,19 @@ void TriageReplHawkeye::print_stats()
             << ", traffic rate: " << double(traffic) / double(access)
             << std::endl;
     }
+    std::cout << "hawkeye_optgen_choices=" << optgen_choices[0] << "," << optgen_choices[1] << "," << optgen_choices[2] << endl;
+    std::cout << "hawkeye_sampled_sets=" << sampled_sets << endl;
+    std::cout << "hawkeye_storage_KB=" << storage_bits() / 8192.0 << endl;
 }
 
-TriageReplPerfect::TriageReplPerfect(std::vector<std::map<uint64_t, TriageOnchipEntry> >* entry_list)
-    : TriageRepl(entry_list) {}
+TriageReplPerfect::TriageReplPerfect(TriageOnchip *table)
+    : TriageRepl(table) {}
 
-void TriageReplPerfect::addEntry(uint64_t set_id, uint64_t addr, uint64_t pc) {
+void TriageReplPerfect::addEntry(uint64_t set_id, uint32_t way, uint64_t addr, uint64_t pc, bool inserted) {
     // Don't do anything
 }
 
-uint64_t TriageReplPerfect::pickVictim(uint64_t set_id) {
+uint32_t TriageReplPerfect::pickVictim(uint64_t set_id) {
     // Don't do anything
     return 0;
 }
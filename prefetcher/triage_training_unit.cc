@@ -6,20 +6,66 @@
 using namespace std;
 
 TriageTrainingUnit::TriageTrainingUnit() {
-    current_timer = 0;
+    num_sets = assoc = set_bits = 0;
+    pc_found = pc_not_found = conflict_evictions = 0;
 }
 
 void TriageTrainingUnit::set_conf(TriageConfig* conf) {
-    max_size = conf->training_unit_size;
+    assoc = conf->training_unit_assoc;
+    if (assoc == 0 || assoc > UINT8_MAX || conf->training_unit_size % assoc != 0) {
+        cerr << "[TRIAGE_TRAINING_UNIT] " << conf->training_unit_size << " entries do not divide into " << assoc << " ways" << endl;
+        assert(0);
+    }
+    num_sets = conf->training_unit_size / assoc;
+    if (num_sets & (num_sets - 1)) {
+        cerr << "[TRIAGE_TRAINING_UNIT] the number of sets " << num_sets << " is not a power of two" << endl;
+        assert(0);
+    }
+    set_bits = __builtin_ctz(num_sets);
+    entries.assign((uint64_t)num_sets * assoc, TriageTrainingUnitEntry());
+}
+
+// the PC bits above the index are folded in, aligned PCs would otherwise fill a fraction of the sets
+uint64_t TriageTrainingUnit::get_set_id(uint64_t pc) {
+    return (pc ^ (pc >> set_bits) ^ (pc >> (2 * set_bits))) & (num_sets - 1);
+}
+
+uint16_t TriageTrainingUnit::get_tag(uint64_t pc) {
+    return (pc >> set_bits) & ((1ull << TRIAGE_TU_TAG_BITS) - 1);
+}
+
+// the entries that were more recent than way age by one, way becomes the most recent
+void TriageTrainingUnit::touch(uint64_t set_id, uint32_t way) {
+    TriageTrainingUnitEntry *set = &entries[set_id * assoc];
+    for (uint32_t i = 0; i < assoc; i++) {
+        if (set[i].valid && i != way && set[i].lru < set[way].lru)
+            set[i].lru++;
+    }
+    set[way].lru = 0;
 }
 
 Metadata TriageTrainingUnit::set_addr(uint64_t pc, uint64_t addr) {
-    auto it = entry_list.find(pc);
+    uint64_t set_id = get_set_id(pc);
+    uint16_t tag = get_tag(pc);
+    TriageTrainingUnitEntry *set = &entries[set_id * assoc];
+
+    // the entry of the pc, else a free way, else the least recently used one
+    uint32_t way = assoc, victim = 0;
+    for (uint32_t i = 0; i < assoc; i++) {
+        if (set[i].valid && set[i].tag == tag) {
+            way = i;
+            break;
+        }
+        if (set[victim].valid && (!set[i].valid || set[i].lru > set[victim].lru))
+            victim = i;
+    }
+
     Metadata result;
-    if (it != entry_list.end()) {
+    if (way < assoc) {
         // pc exists already
-        TriageTrainingUnitEntry &entry = it->second;
-        entry.timer = current_timer++;
+        pc_found++;
+        TriageTrainingUnitEntry &entry = set[way];
+        touch(set_id, way);
         int32_t delta = addr - entry.trigger_addr;
         uint64_t last_addr = entry.in_spatial ? entry.cur_spatial.last_addr : entry.trigger_addr;
         if (last_addr == addr) {
@@ -48,28 +94,37 @@ Metadata TriageTrainingUnit::set_addr(uint64_t pc, uint64_t addr) {
         }
     } else {
         // this pc does not exist yet
-        if (entry_list.size() == max_size) 
-            evict();
-        entry_list[pc].in_spatial = false;
-        entry_list[pc].trigger_addr = addr;
-        entry_list[pc].timer = current_timer++;
+        pc_not_found++;
+        if (set[victim].valid)
+            conflict_evictions++;
+        else
+            set[victim].lru = assoc;
+        set[victim].valid = true;
+        set[victim].tag = tag;
+        set[victim].in_spatial = false;
+        set[victim].trigger_addr = addr;
+        touch(set_id, victim);
     }
-    assert(entry_list.size() <= max_size);
     return result;
 }
 
-void TriageTrainingUnit::evict() {
-    assert(entry_list.size() == max_size);
-    map<uint64_t, TriageTrainingUnitEntry>::iterator it, min_it;
-    uint64_t min_timer = current_timer;
-    for (it = entry_list.begin(); it != entry_list.end(); it++) {
-        assert(it->second.timer < current_timer);
-        if (it->second.timer < min_timer) {
-            min_it = it;
-            min_timer = it->second.timer;
-        }
-    }
+void TriageTrainingUnit::print_stats() {
+    cout << "training_unit_pc_found=" << pc_found << endl;
+    cout << "training_unit_pc_not_found=" << pc_not_found << endl;
+    cout << "training_unit_conflict_evictions=" << conflict_evictions << endl;
+}
 
-    entry_list.erase(min_it);
+void TriageTrainingUnit::register_stats(std::string prefix) {
+    stats_registry.add(prefix + ".training_unit_pc_found", &pc_found);
+    stats_registry.add(prefix + ".training_unit_pc_not_found", &pc_not_found);
+    stats_registry.add(prefix + ".training_unit_conflict_evictions", &conflict_evictions);
 }
 
+void TriageTrainingUnit::checkpoint(CHECKPOINT &cp) {
+    cp.check(num_sets, "triage training unit sets");
+    cp.check(assoc, "triage training unit assoc");
+    cp.io(entries);
+    cp.io(pc_found);
+    cp.io(pc_not_found);
+    cp.io(conflict_evictions);
+}
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include <map>
+#include <string>
+#include <vector>
 #include "reeses_spatial.h"
 
 class TriageConfig;
@@ -34,9 +36,23 @@ struct Metadata {
     }
 
     bool operator!=(const Metadata& other) const { return !(*this == other); }
+
+    void checkpoint(CHECKPOINT &cp) {
+        cp.io(valid);
+        cp.io(spatial);
+        cp.io(addr);
+        cp.io(next_spatial.delta);
+        cp.io(next_spatial.length);
+        cp.io(next_spatial.last_addr);
+    }
 };
 
+// partial tag of a training unit entry, the PC bits above the set index
+#define TRIAGE_TU_TAG_BITS 16
+
 struct TriageTrainingUnitEntry {
+    bool valid;
+    uint16_t tag;
     // are we in the middle of training a spatial pattern?
     bool in_spatial;
     // stores the trigger address for a spatial pattern, 
@@ -44,23 +60,43 @@ struct TriageTrainingUnitEntry {
     uint64_t trigger_addr;
     // stores the current spatial pattern
     DeltaPattern cur_spatial;
-    // used for LRU purposes
-    uint64_t timer;
+    // position in the recency stack of the set, 0 is the most recently used
+    uint8_t lru;
+
+    TriageTrainingUnitEntry() : valid(false), tag(0), in_spatial(false), trigger_addr(0), lru(0) {}
+
+    void checkpoint(CHECKPOINT &cp) {
+        cp.io(valid);
+        cp.io(tag);
+        cp.io(in_spatial);
+        cp.io(trigger_addr);
+        cp.io(cur_spatial.delta);
+        cp.io(cur_spatial.length);
+        cp.io(cur_spatial.last_addr);
+        cp.io(lru);
+    }
 };
 
+// set-associative table indexed by the PC, training_unit_size entries of training_unit_assoc ways with true LRU
+// PCs with the same index and partial tag share an entry, as they would in hardware
 class TriageTrainingUnit {
-    // XXX Only support fully associative LRU for now
-    // PC->TrainingUnitEntry
-    std::map<uint64_t, TriageTrainingUnitEntry> entry_list;
-    uint64_t current_timer;
-    uint64_t max_size;
+    std::vector<TriageTrainingUnitEntry> entries;
+    uint32_t num_sets, assoc, set_bits;
+
+    // Stats
+    uint64_t pc_found, pc_not_found, conflict_evictions;
 
-    void evict();
+    uint64_t get_set_id(uint64_t pc);
+    uint16_t get_tag(uint64_t pc);
+    void touch(uint64_t set_id, uint32_t way);
 
     public:
         TriageTrainingUnit();
         void set_conf(TriageConfig* conf);
         Metadata set_addr(uint64_t pc, uint64_t addr);
+        void print_stats();
+        void register_stats(std::string prefix);
+        void checkpoint(CHECKPOINT &cp);
 };
 
 #endif // TRIAGE_TRAINING_UNIT_H__
@@ -14,48 +14,53 @@ std::set<uint64_t>unique_addr;
 std::map<uint64_t, uint64_t> total_usage_count;
 std::map<uint64_t, uint64_t> actual_usage_count;
 
+// the table is kept in the LLC ways above current_assoc, unless it is the perfect one
+// a trigger reads the metadata line of its entry from the LLC and the prefetches are issued when the read
+// completes, every line the training touched is written back to the LLC
+// the lines of each core are apart, the core is in the bits above TRIAGE_METADATA_CPU_SHIFT of the line address
+#define TRIAGE_METADATA_CPU_SHIFT 48
+
+struct TriagePendingLookup {
+    uint64_t pc, addr;
+    std::vector<uint64_t> targets;
+};
+// the lookups waiting for each metadata line, a read completes all of them
+std::map<uint64_t, std::vector<TriagePendingLookup> > pending_lookup[NUM_CPUS];
+uint64_t metadata_reads[NUM_CPUS], metadata_reads_dropped[NUM_CPUS];
+// the table of each core changes outside the shared section, the other cores read its assoc as of its last hook
+uint32_t published_assoc[NUM_CPUS];
+uint64_t metadata_writes[NUM_CPUS], metadata_writes_dropped[NUM_CPUS];
+
 //16K entries = 64KB
 void triage_prefetcher_initialize(CACHE *cache) {
     uint32_t cpu = cache->cpu;
     conf[cpu].lookahead = 1;
     conf[cpu].degree = 1;
     conf[cpu].on_chip_assoc = 8;
-    conf[cpu].training_unit_size = 10000000;
+    conf[cpu].training_unit_size = 256;
+    conf[cpu].training_unit_assoc = 8;
     //conf[cpu].repl = TRIAGE_REPL_LRU;
     conf[cpu].repl = TRIAGE_REPL_HAWKEYE;
     //conf[cpu].repl = TRIAGE_REPL_PERFECT;
     conf[cpu].use_dynamic_assoc = true;
     conf[cpu].on_chip_assoc = L2C_WAY;
-    conf[cpu].on_chip_set = 32768;
+    // a way of the table is a way of a 2MB 16-way LLC, 32768 entries of 4B
+    conf[cpu].on_chip_way_bytes = 128 * 1024;
+    conf[cpu].format = TRIAGE_FORMAT_COMPRESSED;
+    //conf[cpu].format = TRIAGE_FORMAT_COMPACT;
+    //conf[cpu].format = TRIAGE_FORMAT_FULL;
     std::cout << "CPU " << cpu << " assoc: " << conf[cpu].on_chip_assoc << std::endl;
 
     data[cpu].set_conf(&conf[cpu]);
     data[cpu].test();
-}
-
-uint64_t triage_prefetcher_operate(uint64_t addr, uint64_t pc, uint8_t cache_hit, uint8_t type, uint64_t metadata_in, CACHE *cache) {
-    if (type != LOAD)
-        return metadata_in;
-
-    //if (cache_hit)
-        //return metadata_in;
-
-    uint32_t cpu = cache->cpu;
-    addr >>= LOG2_BLOCK_SIZE;
-    //addr <<= LOG2_BLOCK_SIZE;
-    if (addr == last_address[cpu])
-        return metadata_in;
-    last_address[cpu] = addr;
-    unique_addr.insert(addr);
-
-    // clear the prefetch list
-    uint64_t prefetch_addr_list[MAX_ALLOWED_DEGREE];
-    for (int i = 0; i < MAX_ALLOWED_DEGREE; i++)
-        prefetch_addr_list[i] = 0;
+    data[cpu].register_stats("cpu" + std::to_string(cpu) + "." + cache->NAME + ".triage");
 
-    // set the prefetch list by operating the prefetcher
-    data[cpu].calculatePrefetch(pc, addr, cache_hit, prefetch_addr_list, MAX_ALLOWED_DEGREE, cpu);
+    // the table of a core is its own, the LLC and the address statistics are touched in the shared section
+    cache->prefetcher_per_core = 1;
+    published_assoc[cpu] = data[cpu].get_assoc();
+}
 
+void triage_issue_prefetches(CACHE *cache, uint64_t pc, uint64_t addr, uint64_t *prefetch_addr_list) {
     // prefetch desired lines
     int prefetched = 0;
     for (int i = 0; i < MAX_ALLOWED_DEGREE; i++) {
@@ -69,6 +74,7 @@ uint64_t triage_prefetcher_operate(uint64_t addr, uint64_t pc, uint8_t cache_hit
         PACKET test_packet;
         test_packet.address = prefetch_addr_list[i];
         test_packet.full_addr = target;
+        cache->enter_shared();
         bool llc_hit = static_cast<CACHE*>(cache->lower_level)->check_hit(&test_packet) != -1;
         bool l2_hit = cache->check_hit(&test_packet) != -1;
         uint64_t md_in = addr;
@@ -77,41 +83,170 @@ uint64_t triage_prefetcher_operate(uint64_t addr, uint64_t pc, uint8_t cache_hit
         total_usage_count[addr]++;
         if (!l2_hit && !llc_hit)
            actual_usage_count[addr]++; 
+        cache->leave_shared();
             
         // check if prefetch actually issued
         if (cache->prefetch_line(pc, addr, target, TRIAGE_FILL_LEVEL, md_in)) {
             prefetched++;
         }
     }
+}
+
+uint64_t triage_metadata_line(uint32_t cpu, uint64_t addr) {
+    return ((uint64_t)cpu << TRIAGE_METADATA_CPU_SHIFT) | data[cpu].on_chip_data.get_metadata_line(addr);
+}
+
+uint64_t triage_prefetcher_operate(uint64_t addr, uint64_t pc, uint8_t cache_hit, uint8_t type, uint64_t metadata_in, CACHE *cache) {
+    if (type != LOAD)
+        return metadata_in;
+
+    //if (cache_hit)
+        //return metadata_in;
+
+    uint32_t cpu = cache->cpu;
+    addr >>= LOG2_BLOCK_SIZE;
+    //addr <<= LOG2_BLOCK_SIZE;
+    if (addr == last_address[cpu])
+        return metadata_in;
+    last_address[cpu] = addr;
+    cache->enter_shared();
+    unique_addr.insert(addr);
+    cache->leave_shared();
 
-    // Set cache assoc if dynamic
+    // clear the prefetch list
+    uint64_t prefetch_addr_list[MAX_ALLOWED_DEGREE];
+    for (int i = 0; i < MAX_ALLOWED_DEGREE; i++)
+        prefetch_addr_list[i] = 0;
+
+    // set the prefetch list by operating the prefetcher
+    data[cpu].calculatePrefetch(pc, addr, cache_hit, prefetch_addr_list, MAX_ALLOWED_DEGREE, cpu);
+
+    // Set cache assoc if dynamic, from the assoc the other cores published
+    cache->enter_shared();
+    published_assoc[cpu] = data[cpu].get_assoc();
     uint32_t total_assoc = 0;
     for (uint32_t mycpu = 0; mycpu < NUM_CPUS; mycpu++)
-        total_assoc += data[mycpu].get_assoc();
+        total_assoc += published_assoc[mycpu];
     total_assoc /= NUM_CPUS;
 
-    // set associativity
+    // set associativity, the metadata takes its ways from the data
     assert(total_assoc < LLC_WAY);
-    if (conf[cpu].repl != TRIAGE_REPL_PERFECT)
-        static_cast<CACHE*>(cache->lower_level)->current_assoc = LLC_WAY - total_assoc;
+    CACHE *llc = static_cast<CACHE*>(cache->lower_level);
+    if (conf[cpu].repl == TRIAGE_REPL_PERFECT) {
+        cache->leave_shared();
+        triage_issue_prefetches(cache, pc, addr, prefetch_addr_list);
+        return metadata_in;
+    }
+    llc->set_current_assoc(LLC_WAY - total_assoc);
+    cache->leave_shared();
+
+    // nothing is kept in the LLC without metadata ways
+    if (data[cpu].get_assoc() == 0 || pc == 0)
+        return metadata_in;
+
+    // the entries of one metadata line are written together, a training updates at most two entries
+    uint64_t last_line = UINT64_MAX;
+    for (uint64_t updated_addr : data[cpu].get_updated_addr_list()) {
+        uint64_t line = triage_metadata_line(cpu, updated_addr);
+        if (line == last_line)
+            continue;
+        last_line = line;
+        if (cache->write_onchip_metadata(line))
+            metadata_writes[cpu]++;
+        else
+            metadata_writes_dropped[cpu]++;
+    }
+
+    // a functional read, or one that finds its line in the WQ of the LLC, completes right away,
+    // so the lookup is pending before the read
+    uint64_t line = triage_metadata_line(cpu, addr);
+    TriagePendingLookup lookup;
+    lookup.pc = pc;
+    lookup.addr = addr;
+    for (int i = 0; i < MAX_ALLOWED_DEGREE && prefetch_addr_list[i]; i++)
+        lookup.targets.push_back(prefetch_addr_list[i]);
+    if (lookup.targets.size())
+        pending_lookup[cpu][line].push_back(lookup);
+
+    if (cache->read_onchip_metadata(line)) {
+        metadata_reads[cpu]++;
+    } else {
+        // a dropped read did not complete anything, the lookup is the last one of its line
+        metadata_reads_dropped[cpu]++;
+        if (lookup.targets.size()) {
+            pending_lookup[cpu][line].pop_back();
+            if (pending_lookup[cpu][line].empty())
+                pending_lookup[cpu].erase(line);
+        }
+    }
 
     return metadata_in;
 }
 
+void triage_prefetcher_complete_metadata_req(uint64_t meta_data_addr, CACHE *cache) {
+    uint32_t cpu = cache->cpu;
+    auto it = pending_lookup[cpu].find(meta_data_addr);
+    if (it == pending_lookup[cpu].end())
+        return;
+
+    std::vector<TriagePendingLookup> lookups;
+    lookups.swap(it->second);
+    pending_lookup[cpu].erase(it);
+
+    for (TriagePendingLookup &lookup : lookups) {
+        uint64_t prefetch_addr_list[MAX_ALLOWED_DEGREE];
+        for (int i = 0; i < MAX_ALLOWED_DEGREE; i++)
+            prefetch_addr_list[i] = (i < (int)lookup.targets.size()) ? lookup.targets[i] : 0;
+        triage_issue_prefetches(cache, lookup.pc, lookup.addr, prefetch_addr_list);
+    }
+}
+
 uint64_t triage_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in, CACHE *cache) {
     uint32_t cpu = cache->cpu;
     if (prefetch) {
         Metadata next_entry = data[cpu].on_chip_data.get_next_entry(metadata_in, 0, true);
         //cout << "Filled " << hex << addr << "  by " << metadata_in << " " << next_addr_exists << endl;
+
+        cache->enter_shared();
+        published_assoc[cpu] = data[cpu].get_assoc();
+        cache->leave_shared();
     }
     return metadata_in;
 }
 
+void triage_prefetcher_checkpoint(CHECKPOINT &cp, CACHE *cache) {
+    uint32_t cpu = cache->cpu;
+    cp.section("triage");
+    data[cpu].checkpoint(cp);
+    cp.io(last_address[cpu]);
+    cp.io(metadata_reads[cpu]);
+    cp.io(metadata_reads_dropped[cpu]);
+    cp.io(metadata_writes[cpu]);
+    cp.io(metadata_writes_dropped[cpu]);
+
+    // the reads in flight are not saved with the LLC queues
+    if (cp.restoring()) {
+        pending_lookup[cpu].clear();
+        published_assoc[cpu] = data[cpu].get_assoc();
+    }
+
+    // the address statistics are shared by all cores, the first core carries them
+    if (cpu == 0) {
+        cp.io(unique_addr);
+        cp.io(total_usage_count);
+        cp.io(actual_usage_count);
+    }
+}
+
 void triage_prefetcher_final_stats(CACHE *cache) {
     uint32_t cpu = cache->cpu;
     cout << "CPU " << cpu << " TRIAGE Stats:" << endl;
 
     data[cpu].print_stats();
+    cout << "llc_metadata_reads=" << metadata_reads[cpu] << endl;
+    cout << "llc_metadata_reads_dropped=" << metadata_reads_dropped[cpu] << endl;
+    cout << "llc_metadata_writes=" << metadata_writes[cpu] << endl;
+    cout << "llc_metadata_writes_dropped=" << metadata_writes_dropped[cpu] << endl;
 
     std::map<uint64_t, uint64_t> total_pref_count;
     std::map<uint64_t, uint64_t> actual_pref_count;
@@ -18,42 +18,40 @@ void CACHE::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, u
 
 uint32_t CACHE::lru_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
 {
-    uint32_t way = 0;
+    uint32_t way = current_assoc;
+    uint32_t *lru = &lru_array[set*NUM_WAY];
 
 //    if (NAME == "LLC")
 //        cout << "current_assoc: " << current_assoc << endl;
     // fill invalid line first
-    for (way=0; way<current_assoc; way++) {
-        if (block[set][way].valid == false) {
-
-            DP ( if (warmup_complete[cpu]) {
-            cout << "[" << NAME << "] " << __func__ << " instr_id: " << instr_id << " invalid set: " << set << " way: " << way;
-            cout << hex << " address: " << (full_addr>>LOG2_BLOCK_SIZE) << " victim address: " << block[set][way].address << " data: " << block[set][way].data;
-            cout << dec << " lru: " << block[set][way].lru << endl; });
-
-            break;
-        }
+    uint64_t invalid = ~valid_mask[set];
+    if (current_assoc < 64)
+        invalid &= (1ull << current_assoc) - 1;
+    if (invalid) {
+        way = __builtin_ctzll(invalid);
+
+        DP ( if (warmup_complete[cpu]) {
+        cout << "[" << NAME << "] " << __func__ << " instr_id: " << instr_id << " invalid set: " << set << " way: " << way;
+        cout << hex << " address: " << (full_addr>>LOG2_BLOCK_SIZE) << " victim address: " << block[set][way].address << " data: " << block[set][way].data;
+        cout << dec << " lru: " << lru[way] << endl; });
     }
 
     // LRU victim
     while (way == current_assoc) {
         for (way=0; way<current_assoc; way++) {
-            if (block[set][way].lru == current_assoc-1) {
+            if (lru[way] == current_assoc-1) {
 
                 DP ( if (warmup_complete[cpu]) {
                 cout << "[" << NAME << "] " << __func__ << " instr_id: " << instr_id << " replace set: " << set << " way: " << way;
                 cout << hex << " address: " << (full_addr>>LOG2_BLOCK_SIZE) << " victim address: " << block[set][way].address << " data: " << block[set][way].data;
-                cout << dec << " lru: " << block[set][way].lru << endl; });
+                cout << dec << " lru: " << lru[way] << endl; });
 
                 break;
             }
         }
         if (way == current_assoc) {
-            for (uint32_t i=0; i<current_assoc; i++) {
-                //cout << "current_assoc: " << current_assoc <<"block["<<set<<"][" << i << "].lru="
-                //    <<block[set][i].lru<<endl;
-                block[set][i].lru++;
-            }
+            for (uint32_t i=0; i<current_assoc; i++)
+                lru[i]++;
         }
     }
 
@@ -69,12 +67,13 @@ uint32_t CACHE::lru_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const
 void CACHE::lru_update(uint32_t set, uint32_t way)
 {
     // update lru replacement state
+    uint32_t *lru = &lru_array[set*NUM_WAY],
+             position = lru[way];
     for (uint32_t i=0; i<current_assoc; i++) {
-        if (block[set][i].lru < block[set][way].lru) {
-            block[set][i].lru++;
-        }
+        if (lru[i] < position)
+            lru[i]++;
     }
-    block[set][way].lru = 0; // promote to the MRU position
+    lru[way] = 0; // promote to the MRU position
 }
 
 void CACHE::replacement_final_stats()
@@ -42,6 +42,11 @@ class HAWKEYE_PC_PREDICTOR
 
        public:
 
+    void checkpoint(CHECKPOINT &cp)
+    {
+        cp.io(SHCT);
+    }
+
     void increment (uint64_t pc)
     {
         uint64_t signature = CRC(pc) % SHCT_SIZE;
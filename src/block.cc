@@ -1,76 +1,121 @@
 #include "block.h"
 
+// a free queue entry looks like a new packet
+static const PACKET empty_packet;
+
+uint32_t DEPENDENCY_POOL::allocate()
+{
+    if (num_free == 0) {
+        cerr << "[" << NAME << "] " << __func__ << " no free dependency sets, the pool is smaller than its queues" << endl;
+        assert(0);
+    }
+
+    uint32_t handle = free_list[--num_free];
+    entry[handle] = DEPENDENCY();
+
+    return handle;
+}
+
+void DEPENDENCY_POOL::release(uint32_t handle)
+{
+#ifdef SANITY_CHECK
+    if ((handle == 0) || (handle >= SIZE) || (num_free == SIZE - 1))
+        assert(0);
+#endif
+
+    free_list[num_free++] = handle;
+}
+
+uint64_t PACKET_QUEUE::get_key(PACKET *packet)
+{
+    if (match_mode == MATCH_FULL_ADDR)
+        return packet->full_addr;
+
+    return packet->address;
+}
+
+uint32_t PACKET_QUEUE::get_bucket(uint64_t key)
+{
+    // fibonacci hashing
+    return (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & index_mask;
+}
+
+void PACKET_QUEUE::index_insert(uint32_t slot)
+{
+    uint32_t bucket = get_bucket(get_key(&entry[slot]));
+    while (addr_index[bucket] != -1)
+        bucket = (bucket + 1) & index_mask;
+
+    addr_index[bucket] = slot;
+}
+
+void PACKET_QUEUE::index_erase(uint32_t slot)
+{
+    uint32_t bucket = get_bucket(get_key(&entry[slot]));
+    while (addr_index[bucket] != (int32_t)slot) {
+#ifdef SANITY_CHECK
+        if (addr_index[bucket] == -1) {
+            cerr << "[" << NAME << "] " << __func__ << " slot: " << slot << " is not indexed" << endl;
+            assert(0);
+        }
+#endif
+        bucket = (bucket + 1) & index_mask;
+    }
+
+    // backward-shift the rest of the probe chain so that lookups never need tombstones
+    uint32_t next = (bucket + 1) & index_mask;
+    while (addr_index[next] != -1) {
+        uint32_t home = get_bucket(get_key(&entry[addr_index[next]]));
+        uint8_t movable = (next > bucket) ? ((home <= bucket) || (home > next)) : ((home <= bucket) && (home > next));
+        if (movable) {
+            addr_index[bucket] = addr_index[next];
+            bucket = next;
+        }
+        next = (next + 1) & index_mask;
+    }
+
+    addr_index[bucket] = -1;
+}
+
 int PACKET_QUEUE::check_queue(PACKET *packet)
 {
     if ((head == tail) && occupancy == 0)
         return -1;
 
-    if (head < tail) {
-        for (uint32_t i=head; i<tail; i++) {
-            if (NAME == "L1D_WQ") {
-                if (entry[i].full_addr == packet->full_addr) {
-                    DP (if (warmup_complete[packet->cpu]) {
-                    cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
-                    cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[i].instr_id << " index: " << i;
-                    cout << " cycle " << packet->event_cycle << endl; });
-                    return i;
-                }
-            }
-            else {
-                if (entry[i].address == packet->address) {
-                    DP (if (warmup_complete[packet->cpu]) {
-                    cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
-                    cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[i].instr_id << " index: " << i;
-                    cout << " cycle " << packet->event_cycle << endl; });
-                    return i;
-                }
+    int match = -1;
+
+    if (match_mode == MATCH_NONE) {
+        // no index, scan from the oldest entry
+        for (uint32_t n=0; n<occupancy; n++) {
+            uint32_t i = (head + n) % SIZE;
+            if (entry[i].address == packet->address) {
+                match = i;
+                break;
             }
         }
     }
     else {
-        for (uint32_t i=head; i<SIZE; i++) {
-            if (NAME == "L1D_WQ") {
-                if (entry[i].full_addr == packet->full_addr) {
-                    DP (if (warmup_complete[packet->cpu]) {
-                    cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
-                    cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[i].instr_id << " index: " << i;
-                    cout << " cycle " << packet->event_cycle << endl; });
-                    return i;
-                }
-            }
-            else {
-                if (entry[i].address == packet->address) {
-                    DP (if (warmup_complete[packet->cpu]) {
-                    cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
-                    cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[i].instr_id << " index: " << i;
-                    cout << " cycle " << packet->event_cycle << endl; });
-                    return i;
-                }
-            }
-        }
-        for (uint32_t i=0; i<tail; i++) {
-            if (NAME == "L1D_WQ") {
-                if (entry[i].full_addr == packet->full_addr) {
-                    DP (if (warmup_complete[packet->cpu]) {
-                    cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
-                    cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[i].instr_id << " index: " << i;
-                    cout << " cycle " << packet->event_cycle << endl; });
-                    return i;
-                }
-            }
-            else {
-                if (entry[i].address == packet->address) {
-                    DP (if (warmup_complete[packet->cpu]) {
-                    cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
-                    cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[i].instr_id << " index: " << i;
-                    cout << " cycle " << packet->event_cycle << endl; });
-                    return i;
+        // the oldest entry wins if the same address is queued more than once
+        uint64_t key = get_key(packet);
+        uint32_t min_age = SIZE;
+        for (uint32_t bucket = get_bucket(key); addr_index[bucket] != -1; bucket = (bucket + 1) & index_mask) {
+            uint32_t i = addr_index[bucket];
+            if (get_key(&entry[i]) == key) {
+                uint32_t age = (i >= head) ? (i - head) : (SIZE - head + i);
+                if (age < min_age) {
+                    min_age = age;
+                    match = i;
                 }
             }
         }
     }
 
-    return -1;
+    DP (if ((match != -1) && warmup_complete[packet->cpu]) {
+    cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
+    cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[match].instr_id << " index: " << match;
+    cout << " cycle " << packet->event_cycle << endl; });
+
+    return match;
 }
 
 void PACKET_QUEUE::add_queue(PACKET *packet)
@@ -81,7 +126,9 @@ void PACKET_QUEUE::add_queue(PACKET *packet)
 #endif
 
     // add entry
-    entry[tail] = *packet;
+    assign(tail, packet);
+    if (match_mode != MATCH_NONE)
+        index_insert(tail);
 
     DP ( if (warmup_complete[packet->cpu]) {
     cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id;
@@ -106,8 +153,12 @@ void PACKET_QUEUE::remove_queue(PACKET *packet)
     cout << " address: " << hex << packet->address << " full_addr: " << packet->full_addr << dec << " fill_level: " << packet->fill_level;
     cout << " head: " << head << " tail: " << tail << " occupancy: " << occupancy << " event_cycle: " << packet->event_cycle << endl; });
 
+    if (match_mode != MATCH_NONE)
+        index_erase(packet - entry);
+
     // reset entry
-    PACKET empty_packet;
+    if (packet->depend_on_me)
+        depend_pool->release(packet->depend_on_me);
     *packet = empty_packet;
 
     occupancy--;
@@ -115,3 +166,31 @@ void PACKET_QUEUE::remove_queue(PACKET *packet)
     if (head >= SIZE)
         head = 0;
 }
+
+void PACKET_QUEUE::assign(uint32_t index, PACKET *packet)
+{
+    // the dependency sets move with the packet, every caller removes the source entry right after
+    uint32_t prior = entry[index].depend_on_me;
+
+    entry[index] = *packet;
+    if (depend_pool) {
+        packet->depend_on_me = 0;
+        if (prior)
+            depend_pool->release(prior);
+    }
+    else
+        entry[index].depend_on_me = 0;
+}
+
+DEPENDENCY &PACKET_QUEUE::add_dependency(uint32_t index)
+{
+    if (entry[index].depend_on_me == 0)
+        entry[index].depend_on_me = depend_pool->allocate();
+
+    return depend_pool->entry[entry[index].depend_on_me];
+}
+
+DEPENDENCY &PACKET_QUEUE::get_dependency(uint32_t index)
+{
+    return depend_pool->entry[entry[index].depend_on_me];
+}
@@ -1,8 +1,16 @@
 #include "cache.h"
+
+#include <algorithm>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 #include "set.h"
 
 uint64_t l2pf_access = 0;
 
+// the shared LLC counts in the uncore row of the host profile
+#define CACHE_PROFILE(region, call) PROFILE_CALL((cache_type == IS_LLC) ? PROFILE_UNCORE : cpu, region, call)
+
 //#undef DP
 //#define DP(x) x
 
@@ -25,10 +33,14 @@ void CACHE::handle_fill()
         // find victim
         uint32_t set = get_set(MSHR.entry[mshr_index].address), way;
         if (cache_type == IS_LLC) {
-            way = llc_find_victim(fill_cpu, MSHR.entry[mshr_index].instr_id, set, block[set], MSHR.entry[mshr_index].ip, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].type);
+            way = CACHE_PROFILE(PROFILE_LLC_FIND_VICTIM, llc_find_victim(fill_cpu, MSHR.entry[mshr_index].instr_id, set, block[set], MSHR.entry[mshr_index].ip, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].type));
+
+            // the ways above current_assoc hold metadata, a policy that does not know it falls back to LRU
+            if ((way < NUM_WAY) && (way >= current_assoc))
+                way = lru_victim(fill_cpu, MSHR.entry[mshr_index].instr_id, set, block[set], MSHR.entry[mshr_index].ip, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].type);
         }
         else
-            way = find_victim(fill_cpu, MSHR.entry[mshr_index].instr_id, set, block[set], MSHR.entry[mshr_index].ip, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].type);
+            way = CACHE_PROFILE(PROFILE_FIND_VICTIM, find_victim(fill_cpu, MSHR.entry[mshr_index].instr_id, set, block[set], MSHR.entry[mshr_index].ip, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].type));
 
 #ifdef LLC_BYPASS
         if ((cache_type == IS_LLC) && (way == LLC_WAY)) { // this is a bypass that does not fill the LLC
@@ -37,11 +49,11 @@ void CACHE::handle_fill()
 
             // update replacement policy
             if (cache_type == IS_LLC) {
-                llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0);
+                CACHE_PROFILE(PROFILE_LLC_UPDATE_REPLACEMENT, llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0));
 
             }
             else
-                update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0);
+                CACHE_PROFILE(PROFILE_UPDATE_REPLACEMENT, update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0));
 
             // COLLECT STATS
             sim_miss[fill_cpu][MSHR.entry[mshr_index].type]++;
@@ -93,6 +105,7 @@ void CACHE::handle_fill()
 
             // check if the lower level WQ has enough room to keep this writeback request
             if (lower_level) {
+                enter_shared();
                 if (lower_level->get_occupancy(2, block[set][way].address) == lower_level->get_size(2, block[set][way].address)) {
 
                     // lower level WQ is full, cannot replace this victim
@@ -120,6 +133,7 @@ void CACHE::handle_fill()
 
                     lower_level->add_wq(&writeback_packet);
                 }
+                leave_shared();
             }
 #ifdef SANITY_CHECK
             else {
@@ -133,25 +147,25 @@ void CACHE::handle_fill()
         if (do_fill) {
             // update prefetcher
             if (cache_type == IS_L1D)
-	      l1d_prefetcher_cache_fill(MSHR.entry[mshr_index].full_addr, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE,
-					MSHR.entry[mshr_index].pf_metadata);
+	      CACHE_PROFILE(PROFILE_L1D_PREFETCHER_FILL, l1d_prefetcher_cache_fill(MSHR.entry[mshr_index].full_addr, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE,
+					MSHR.entry[mshr_index].pf_metadata));
             if  (cache_type == IS_L2C)
-	      MSHR.entry[mshr_index].pf_metadata = l2c_prefetcher_cache_fill(MSHR.entry[mshr_index].address<<LOG2_BLOCK_SIZE, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0,
+	      MSHR.entry[mshr_index].pf_metadata = l2c_prefetcher_fill(MSHR.entry[mshr_index].address<<LOG2_BLOCK_SIZE, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0,
 									     block[set][way].address<<LOG2_BLOCK_SIZE, MSHR.entry[mshr_index].pf_metadata);
             if (cache_type == IS_LLC)
 	      {
 		cpu = fill_cpu;
-		MSHR.entry[mshr_index].pf_metadata = llc_prefetcher_cache_fill(MSHR.entry[mshr_index].address<<LOG2_BLOCK_SIZE, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0,
-									       block[set][way].address<<LOG2_BLOCK_SIZE, MSHR.entry[mshr_index].pf_metadata);
+		MSHR.entry[mshr_index].pf_metadata = CACHE_PROFILE(PROFILE_LLC_PREFETCHER_FILL, llc_prefetcher_cache_fill(MSHR.entry[mshr_index].address<<LOG2_BLOCK_SIZE, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0,
+									       block[set][way].address<<LOG2_BLOCK_SIZE, MSHR.entry[mshr_index].pf_metadata));
 		cpu = 0;
 	      }
               
             // update replacement policy
             if (cache_type == IS_LLC) {
-                llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0);
+                CACHE_PROFILE(PROFILE_LLC_UPDATE_REPLACEMENT, llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0));
             }
             else
-                update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0);
+                CACHE_PROFILE(PROFILE_UPDATE_REPLACEMENT, update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0));
 
             // COLLECT STATS
             sim_miss[fill_cpu][MSHR.entry[mshr_index].type]++;
@@ -214,6 +228,17 @@ void CACHE::handle_writeback()
     if ((WQ.entry[WQ.head].event_cycle <= current_core_cycle[writeback_cpu]) && (WQ.occupancy > 0)) {
         int index = WQ.head;
 
+        // so is a write, it updates the metadata in place
+        if (WQ.entry[index].type == ONCHIP_METADATA) {
+            sim_hit[writeback_cpu][ONCHIP_METADATA]++;
+            sim_access[writeback_cpu][ONCHIP_METADATA]++;
+            HIT[ONCHIP_METADATA]++;
+            ACCESS[ONCHIP_METADATA]++;
+
+            WQ.remove_queue(&WQ.entry[index]);
+            return;
+        }
+
         // access cache
         uint32_t set = get_set(WQ.entry[index].address);
         int way = check_hit(&WQ.entry[index]);
@@ -224,11 +249,11 @@ void CACHE::handle_writeback()
         if (way >= 0) { // writeback hit (or RFO hit for L1D)
 
             if (cache_type == IS_LLC) {
-                llc_update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1);
+                CACHE_PROFILE(PROFILE_LLC_UPDATE_REPLACEMENT, llc_update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1));
 
             }
             else
-                update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1);
+                CACHE_PROFILE(PROFILE_UPDATE_REPLACEMENT, update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1));
 
             // COLLECT STATS
             sim_hit[writeback_cpu][WQ.entry[index].type]++;
@@ -341,7 +366,7 @@ void CACHE::handle_writeback()
                         if (MSHR.entry[mshr_index].type == PREFETCH) {
                             uint8_t  prior_returned = MSHR.entry[mshr_index].returned;
                             uint64_t prior_event_cycle = MSHR.entry[mshr_index].event_cycle;
-			    MSHR.entry[mshr_index] = WQ.entry[index];
+			    MSHR.assign(mshr_index, &WQ.entry[index]);
 
                             // in case request is already returned, we should keep event_cycle and retunred variables
                             MSHR.entry[mshr_index].returned = prior_returned;
@@ -377,10 +402,12 @@ void CACHE::handle_writeback()
                 // find victim
                 uint32_t set = get_set(WQ.entry[index].address), way;
                 if (cache_type == IS_LLC) {
-                    way = llc_find_victim(writeback_cpu, WQ.entry[index].instr_id, set, block[set], WQ.entry[index].ip, WQ.entry[index].full_addr, WQ.entry[index].type);
+                    way = CACHE_PROFILE(PROFILE_LLC_FIND_VICTIM, llc_find_victim(writeback_cpu, WQ.entry[index].instr_id, set, block[set], WQ.entry[index].ip, WQ.entry[index].full_addr, WQ.entry[index].type));
+                    if ((way < NUM_WAY) && (way >= current_assoc))
+                        way = lru_victim(writeback_cpu, WQ.entry[index].instr_id, set, block[set], WQ.entry[index].ip, WQ.entry[index].full_addr, WQ.entry[index].type);
                 }
                 else
-                    way = find_victim(writeback_cpu, WQ.entry[index].instr_id, set, block[set], WQ.entry[index].ip, WQ.entry[index].full_addr, WQ.entry[index].type);
+                    way = CACHE_PROFILE(PROFILE_FIND_VICTIM, find_victim(writeback_cpu, WQ.entry[index].instr_id, set, block[set], WQ.entry[index].ip, WQ.entry[index].full_addr, WQ.entry[index].type));
 
 #ifdef LLC_BYPASS
                 if ((cache_type == IS_LLC) && (way == LLC_WAY)) {
@@ -396,6 +423,7 @@ void CACHE::handle_writeback()
 
                     // check if the lower level WQ has enough room to keep this writeback request
                     if (lower_level) { 
+                        enter_shared();
                         if (lower_level->get_occupancy(2, block[set][way].address) == lower_level->get_size(2, block[set][way].address)) {
 
                             // lower level WQ is full, cannot replace this victim
@@ -423,6 +451,7 @@ void CACHE::handle_writeback()
 
                             lower_level->add_wq(&writeback_packet);
                         }
+                        leave_shared();
                     }
 #ifdef SANITY_CHECK
                     else {
@@ -436,24 +465,24 @@ void CACHE::handle_writeback()
                 if (do_fill) {
                     // update prefetcher
                     if (cache_type == IS_L1D)
-		      l1d_prefetcher_cache_fill(WQ.entry[index].full_addr, set, way, 0, block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata);
+		      CACHE_PROFILE(PROFILE_L1D_PREFETCHER_FILL, l1d_prefetcher_cache_fill(WQ.entry[index].full_addr, set, way, 0, block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata));
                     else if (cache_type == IS_L2C)
-		      WQ.entry[index].pf_metadata = l2c_prefetcher_cache_fill(WQ.entry[index].address<<LOG2_BLOCK_SIZE, set, way, 0,
+		      WQ.entry[index].pf_metadata = l2c_prefetcher_fill(WQ.entry[index].address<<LOG2_BLOCK_SIZE, set, way, 0,
 									      block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata);
                     if (cache_type == IS_LLC)
 		      {
 			cpu = writeback_cpu;
-			WQ.entry[index].pf_metadata =llc_prefetcher_cache_fill(WQ.entry[index].address<<LOG2_BLOCK_SIZE, set, way, 0,
-									       block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata);
+			WQ.entry[index].pf_metadata =CACHE_PROFILE(PROFILE_LLC_PREFETCHER_FILL, llc_prefetcher_cache_fill(WQ.entry[index].address<<LOG2_BLOCK_SIZE, set, way, 0,
+									       block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata));
 			cpu = 0;
 		      }
 
                     // update replacement policy
                     if (cache_type == IS_LLC) {
-                        llc_update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0);
+                        CACHE_PROFILE(PROFILE_LLC_UPDATE_REPLACEMENT, llc_update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0));
                     }
                     else
-                        update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0);
+                        CACHE_PROFILE(PROFILE_UPDATE_REPLACEMENT, update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0));
 
                     // COLLECT STATS
                     sim_miss[writeback_cpu][WQ.entry[index].type]++;
@@ -528,24 +557,24 @@ void CACHE::handle_read()
                 // update prefetcher on load instruction
 		if (RQ.entry[index].type == LOAD) {
                     if (cache_type == IS_L1D) 
-		      l1d_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 1, RQ.entry[index].type);
+		      CACHE_PROFILE(PROFILE_L1D_PREFETCHER_OPERATE, l1d_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 1, RQ.entry[index].type));
                     else if (cache_type == IS_L2C)
-		      l2c_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 1, RQ.entry[index].type, 0);
+		      l2c_prefetcher_access(block[set][way].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 1, RQ.entry[index].type, 0);
                     else if (cache_type == IS_LLC)
 		      {
 			cpu = read_cpu;
-			llc_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 1, RQ.entry[index].type, 0);
+			CACHE_PROFILE(PROFILE_LLC_PREFETCHER_OPERATE, llc_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 1, RQ.entry[index].type, 0));
 			cpu = 0;
 		      }
                 }
 
                 // update replacement policy
                 if (cache_type == IS_LLC) {
-                    llc_update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1);
+                    CACHE_PROFILE(PROFILE_LLC_UPDATE_REPLACEMENT, llc_update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1));
 
                 }
                 else
-                    update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1);
+                    CACHE_PROFILE(PROFILE_UPDATE_REPLACEMENT, update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1));
 
                 // COLLECT STATS
                 sim_hit[read_cpu][RQ.entry[index].type]++;
@@ -609,14 +638,19 @@ void CACHE::handle_read()
 		      add_mshr(&RQ.entry[index]);
 		      
 		      // add it to the next level's read queue
-		      if (lower_level)
+		      if (lower_level) {
+                        enter_shared();
                         lower_level->add_rq(&RQ.entry[index]);
+                        leave_shared();
+                      }
 		      else { // this is the last level
                         if (cache_type == IS_STLB) {
 			  // TODO: need to differentiate page table walk and actual swap
 			  
 			  // emulate page table walk
+			  core_scheduler.enter_shared(read_cpu);
 			  uint64_t pa = va_to_pa(read_cpu, RQ.entry[index].instr_id, RQ.entry[index].full_addr, RQ.entry[index].address);
+			  core_scheduler.leave_shared(read_cpu);
 			  
 			  RQ.entry[index].data = pa >> LOG2_PAGE_SIZE; 
 			  RQ.entry[index].event_cycle = current_core_cycle[read_cpu];
@@ -640,29 +674,29 @@ void CACHE::handle_read()
                             if (RQ.entry[index].tlb_access) {
                                 uint32_t sq_index = RQ.entry[index].sq_index;
                                 MSHR.entry[mshr_index].store_merged = 1;
-                                MSHR.entry[mshr_index].sq_index_depend_on_me.insert (sq_index);
-				MSHR.entry[mshr_index].sq_index_depend_on_me.join (RQ.entry[index].sq_index_depend_on_me, SQ_SIZE);
+                                MSHR.add_dependency(mshr_index).sq_index_depend_on_me.insert (sq_index);
+				MSHR.add_dependency(mshr_index).sq_index_depend_on_me.join (RQ.get_dependency(index).sq_index_depend_on_me);
                             }
 
                             if (RQ.entry[index].load_merged) {
                                 //uint32_t lq_index = RQ.entry[index].lq_index; 
                                 MSHR.entry[mshr_index].load_merged = 1;
                                 //MSHR.entry[mshr_index].lq_index_depend_on_me[lq_index] = 1;
-				MSHR.entry[mshr_index].lq_index_depend_on_me.join (RQ.entry[index].lq_index_depend_on_me, LQ_SIZE);
+				MSHR.add_dependency(mshr_index).lq_index_depend_on_me.join (RQ.get_dependency(index).lq_index_depend_on_me);
                             }
                         }
                         else {
                             if (RQ.entry[index].instruction) {
                                 uint32_t rob_index = RQ.entry[index].rob_index;
                                 MSHR.entry[mshr_index].instr_merged = 1;
-                                MSHR.entry[mshr_index].rob_index_depend_on_me.insert (rob_index);
+                                MSHR.add_dependency(mshr_index).rob_index_depend_on_me.insert (rob_index);
 
                                 DP (if (warmup_complete[MSHR.entry[mshr_index].cpu]) {
                                 cout << "[INSTR_MERGED] " << __func__ << " cpu: " << MSHR.entry[mshr_index].cpu << " instr_id: " << MSHR.entry[mshr_index].instr_id;
                                 cout << " merged rob_index: " << rob_index << " instr_id: " << RQ.entry[index].instr_id << endl; });
 
                                 if (RQ.entry[index].instr_merged) {
-				    MSHR.entry[mshr_index].rob_index_depend_on_me.join (RQ.entry[index].rob_index_depend_on_me, ROB_SIZE);
+				    MSHR.add_dependency(mshr_index).rob_index_depend_on_me.join (RQ.get_dependency(index).rob_index_depend_on_me);
                                     DP (if (warmup_complete[MSHR.entry[mshr_index].cpu]) {
                                     cout << "[INSTR_MERGED] " << __func__ << " cpu: " << MSHR.entry[mshr_index].cpu << " instr_id: " << MSHR.entry[mshr_index].instr_id;
                                     cout << " merged rob_index: " << i << " instr_id: N/A" << endl; });
@@ -672,15 +706,15 @@ void CACHE::handle_read()
                             {
                                 uint32_t lq_index = RQ.entry[index].lq_index;
                                 MSHR.entry[mshr_index].load_merged = 1;
-                                MSHR.entry[mshr_index].lq_index_depend_on_me.insert (lq_index);
+                                MSHR.add_dependency(mshr_index).lq_index_depend_on_me.insert (lq_index);
 
                                 DP (if (warmup_complete[read_cpu]) {
                                 cout << "[DATA_MERGED] " << __func__ << " cpu: " << read_cpu << " instr_id: " << RQ.entry[index].instr_id;
                                 cout << " merged rob_index: " << RQ.entry[index].rob_index << " instr_id: " << RQ.entry[index].instr_id << " lq_index: " << RQ.entry[index].lq_index << endl; });
-				MSHR.entry[mshr_index].lq_index_depend_on_me.join (RQ.entry[index].lq_index_depend_on_me, LQ_SIZE);
+				MSHR.add_dependency(mshr_index).lq_index_depend_on_me.join (RQ.get_dependency(index).lq_index_depend_on_me);
                                 if (RQ.entry[index].store_merged) {
                                     MSHR.entry[mshr_index].store_merged = 1;
-				    MSHR.entry[mshr_index].sq_index_depend_on_me.join (RQ.entry[index].sq_index_depend_on_me, SQ_SIZE);
+				    MSHR.add_dependency(mshr_index).sq_index_depend_on_me.join (RQ.get_dependency(index).sq_index_depend_on_me);
                                 }
                             }
                         }
@@ -693,7 +727,7 @@ void CACHE::handle_read()
                         if (MSHR.entry[mshr_index].type == PREFETCH) {
                             uint8_t  prior_returned = MSHR.entry[mshr_index].returned;
                             uint64_t prior_event_cycle = MSHR.entry[mshr_index].event_cycle;
-                            MSHR.entry[mshr_index] = RQ.entry[index];
+                            MSHR.assign(mshr_index, &RQ.entry[index]);
                             
                             // in case request is already returned, we should keep event_cycle and retunred variables
                             MSHR.entry[mshr_index].returned = prior_returned;
@@ -719,13 +753,13 @@ void CACHE::handle_read()
                     // update prefetcher on load instruction
 		    if (RQ.entry[index].type == LOAD) {
                         if (cache_type == IS_L1D) 
-                            l1d_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type);
+                            CACHE_PROFILE(PROFILE_L1D_PREFETCHER_OPERATE, l1d_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type));
                         if (cache_type == IS_L2C)
-			  l2c_prefetcher_operate(RQ.entry[index].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 0, RQ.entry[index].type, 0);
+			  l2c_prefetcher_access(RQ.entry[index].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 0, RQ.entry[index].type, 0);
                         if (cache_type == IS_LLC)
 			  {
 			    cpu = read_cpu;
-			    llc_prefetcher_operate(RQ.entry[index].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 0, RQ.entry[index].type, 0);
+			    CACHE_PROFILE(PROFILE_LLC_PREFETCHER_OPERATE, llc_prefetcher_operate(RQ.entry[index].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 0, RQ.entry[index].type, 0));
 			    cpu = 0;
 			  }
                     }
@@ -765,11 +799,11 @@ void CACHE::handle_prefetch()
 
                 // update replacement policy
                 if (cache_type == IS_LLC) {
-                    llc_update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1);
+                    CACHE_PROFILE(PROFILE_LLC_UPDATE_REPLACEMENT, llc_update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1));
 
                 }
                 else
-                    update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1);
+                    CACHE_PROFILE(PROFILE_UPDATE_REPLACEMENT, update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1));
 
                 // COLLECT STATS
                 sim_hit[prefetch_cpu][PQ.entry[index].type]++;
@@ -779,13 +813,13 @@ void CACHE::handle_prefetch()
 		if(PQ.entry[index].pf_origin_level < fill_level)
 		  {
 		    if (cache_type == IS_L1D)
-		      l1d_prefetcher_operate(PQ.entry[index].full_addr, PQ.entry[index].ip, 1, PREFETCH);
+		      CACHE_PROFILE(PROFILE_L1D_PREFETCHER_OPERATE, l1d_prefetcher_operate(PQ.entry[index].full_addr, PQ.entry[index].ip, 1, PREFETCH));
                     else if (cache_type == IS_L2C)
-                      PQ.entry[index].pf_metadata = l2c_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 1, PREFETCH, PQ.entry[index].pf_metadata);
+                      PQ.entry[index].pf_metadata = l2c_prefetcher_access(block[set][way].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 1, PREFETCH, PQ.entry[index].pf_metadata);
                     else if (cache_type == IS_LLC)
 		      {
 			cpu = prefetch_cpu;
-			PQ.entry[index].pf_metadata = llc_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 1, PREFETCH, PQ.entry[index].pf_metadata);
+			PQ.entry[index].pf_metadata = CACHE_PROFILE(PROFILE_LLC_PREFETCHER_OPERATE, llc_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 1, PREFETCH, PQ.entry[index].pf_metadata));
 			cpu = 0;
 		      }
 		  }
@@ -840,7 +874,7 @@ void CACHE::handle_prefetch()
 			      if (cache_type == IS_LLC)
 				{
 				  cpu = prefetch_cpu;
-				  PQ.entry[index].pf_metadata = llc_prefetcher_operate(PQ.entry[index].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 0, PREFETCH, PQ.entry[index].pf_metadata);
+				  PQ.entry[index].pf_metadata = CACHE_PROFILE(PROFILE_LLC_PREFETCHER_OPERATE, llc_prefetcher_operate(PQ.entry[index].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 0, PREFETCH, PQ.entry[index].pf_metadata));
 				  cpu = 0;
 				}
 			    }
@@ -853,6 +887,7 @@ void CACHE::handle_prefetch()
 			}
 		      }
 		      else {
+			enter_shared();
 			if (lower_level->get_occupancy(3, PQ.entry[index].address) == lower_level->get_size(3, PQ.entry[index].address))
 			  miss_handled = 0;
 			else {
@@ -861,9 +896,9 @@ void CACHE::handle_prefetch()
 			  if(PQ.entry[index].pf_origin_level < fill_level)
 			    {
 			      if (cache_type == IS_L1D)
-				l1d_prefetcher_operate(PQ.entry[index].full_addr, PQ.entry[index].ip, 0, PREFETCH);
+				CACHE_PROFILE(PROFILE_L1D_PREFETCHER_OPERATE, l1d_prefetcher_operate(PQ.entry[index].full_addr, PQ.entry[index].ip, 0, PREFETCH));
 			      if (cache_type == IS_L2C)
-				PQ.entry[index].pf_metadata = l2c_prefetcher_operate(PQ.entry[index].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 0, PREFETCH, PQ.entry[index].pf_metadata);
+				PQ.entry[index].pf_metadata = l2c_prefetcher_access(PQ.entry[index].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 0, PREFETCH, PQ.entry[index].pf_metadata);
 			    }
 			  
 			  // add it to MSHRs if this prefetch miss will be filled to this cache level
@@ -872,6 +907,7 @@ void CACHE::handle_prefetch()
 
 			  lower_level->add_pq(&PQ.entry[index]); // add it to the DRAM RQ
 			}
+			leave_shared();
 		      }
 		    }
                 }
@@ -927,14 +963,42 @@ void CACHE::handle_prefetch()
 
 void CACHE::operate()
 {
+    PROFILE((cache_type == IS_LLC) ? PROFILE_UNCORE : cpu, PROFILE_CACHE + cache_type);
+
+    if (partition_writeback.size())
+        drain_partition_writeback();
+
     handle_fill();
     handle_writeback();
     handle_read();
 
+    if (metadata_read.size())
+        handle_metadata_read();
+
     if (PQ.occupancy && (RQ.occupancy == 0))
         handle_prefetch();
 }
 
+void CACHE::handle_metadata_read()
+{
+    // the on-chip metadata is always in the ways above current_assoc, a read only takes the tag and data access
+    for (uint32_t i=0; (i<MAX_READ) && metadata_read.size(); i++) {
+        PACKET &packet = metadata_read.front();
+        if (packet.event_cycle > current_core_cycle[packet.cpu])
+            break;
+
+        uint32_t metadata_cpu = packet.cpu;
+        uint64_t meta_data_addr = packet.address & ~ONCHIP_METADATA_SPACE;
+        sim_hit[metadata_cpu][ONCHIP_METADATA]++;
+        sim_access[metadata_cpu][ONCHIP_METADATA]++;
+        HIT[ONCHIP_METADATA]++;
+        ACCESS[ONCHIP_METADATA]++;
+        metadata_read.pop_front();
+
+        upper_level_dcache[metadata_cpu]->complete_metadata_req(meta_data_addr);
+    }
+}
+
 uint32_t CACHE::get_set(uint64_t address)
 {
     return (uint32_t) (address & ((1 << lg2(NUM_SET)) - 1)); 
@@ -942,12 +1006,32 @@ uint32_t CACHE::get_set(uint64_t address)
 
 uint32_t CACHE::get_way(uint64_t address, uint32_t set)
 {
-    for (uint32_t way=0; way<NUM_WAY; way++) {
-        if (block[set][way].valid && (block[set][way].tag == address)) 
-            return way;
+    // compare every tag of the set, then keep the lowest valid match
+    const uint64_t *tags = &tag_array[set*NUM_WAY];
+    uint64_t match = 0;
+    uint32_t way = 0;
+
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi64x(address);
+    for (; way+4<=NUM_WAY; way+=4) {
+        __m256i cmp = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) &tags[way]), key);
+        match |= (uint64_t) _mm256_movemask_pd(_mm256_castsi256_pd(cmp)) << way;
+    }
+#elif defined(__SSE4_1__)
+    __m128i key = _mm_set1_epi64x(address);
+    for (; way+2<=NUM_WAY; way+=2) {
+        __m128i cmp = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i *) &tags[way]), key);
+        match |= (uint64_t) _mm_movemask_pd(_mm_castsi128_pd(cmp)) << way;
     }
+#endif
+    for (; way<NUM_WAY; way++)
+        match |= (uint64_t) (tags[way] == address) << way;
 
-    return NUM_WAY;
+    match &= valid_mask[set];
+    if (match == 0)
+        return NUM_WAY;
+
+    return __builtin_ctzll(match);
 }
 
 void CACHE::fill_cache(uint32_t set, uint32_t way, PACKET *packet)
@@ -973,6 +1057,8 @@ void CACHE::fill_cache(uint32_t set, uint32_t way, PACKET *packet)
 
     if (block[set][way].valid == 0)
         block[set][way].valid = 1;
+    valid_mask[set] |= 1ull << way;
+    tag_array[set*NUM_WAY + way] = packet->address;
     block[set][way].dirty = 0;
     block[set][way].prefetch = (packet->type == PREFETCH) ? 1 : 0;
     block[set][way].used = 0;
@@ -996,10 +1082,128 @@ void CACHE::fill_cache(uint32_t set, uint32_t way, PACKET *packet)
     cout << "[" << NAME << "] " << __func__ << " set: " << set << " way: " << way;
         cout << " cpu: " << cpu;
         cout << " fill_cpu: " << block[set][way].cpu;
-    cout << " lru: " << block[set][way].lru << " tag: " << hex << block[set][way].tag << " full_addr: " << block[set][way].full_addr;
+    cout << " lru: " << lru_array[set*NUM_WAY + way] << " tag: " << hex << block[set][way].tag << " full_addr: " << block[set][way].full_addr;
     cout << " data: " << block[set][way].data << dec << endl; });
 }
 
+uint8_t CACHE::functional_access(uint32_t access_cpu, uint64_t full_addr, uint64_t ip, uint8_t type, uint8_t train, uint64_t pf_metadata)
+{
+    // no timing and no statistics, a miss reads the block from the lower level and a dirty victim is written back to it
+    CACHE *lower = (cache_type == IS_LLC) ? NULL : (CACHE *)lower_level;
+    uint64_t address = full_addr >> LOG2_BLOCK_SIZE;
+    uint32_t set = get_set(address), way = get_way(address, set);
+    uint8_t hit = (way < NUM_WAY),
+            dirty = (type == WRITEBACK) || ((type == RFO) && (cache_type == IS_L1D));
+
+    // the LLC hooks see the core of the access, as in handle_read()
+    uint32_t saved_cpu = cpu;
+    if (cache_type == IS_LLC)
+        cpu = access_cpu;
+
+    // the prefetchers train on loads, their prefetches are filled by prefetch_line() right away
+    if (train && (type == LOAD)) {
+        if (cache_type == IS_L1D)
+            l1d_prefetcher_operate(full_addr, ip, hit, type);
+        else if (cache_type == IS_L2C)
+            l2c_prefetcher_operate(address << LOG2_BLOCK_SIZE, ip, hit, type, 0);
+        else if (cache_type == IS_LLC)
+            llc_prefetcher_operate(address << LOG2_BLOCK_SIZE, ip, hit, type, 0);
+
+        // a prefetch may have filled the block in the meantime
+        way = get_way(address, set);
+    }
+
+    if (way < NUM_WAY) {
+        if (dirty)
+            block[set][way].dirty = 1;
+        if (type != PREFETCH)
+            block[set][way].used = 1;
+
+        if (cache_type == IS_LLC)
+            llc_update_replacement_state(access_cpu, set, way, full_addr, ip, 0, type, 1);
+        else
+            update_replacement_state(access_cpu, set, way, full_addr, ip, 0, type, 1);
+    }
+    else {
+        if (lower && (type != WRITEBACK))
+            lower->functional_access(access_cpu, full_addr, ip, type, train, pf_metadata);
+
+        if (cache_type == IS_LLC) {
+            way = llc_find_victim(access_cpu, 0, set, block[set], ip, full_addr, type);
+            if ((way < NUM_WAY) && (way >= current_assoc))
+                way = lru_victim(access_cpu, 0, set, block[set], ip, full_addr, type);
+        }
+        else
+            way = find_victim(access_cpu, 0, set, block[set], ip, full_addr, type);
+
+#ifdef LLC_BYPASS
+        if ((cache_type == IS_LLC) && (way == LLC_WAY)) {
+            llc_update_replacement_state(access_cpu, set, way, full_addr, ip, 0, type, 0);
+            cpu = saved_cpu;
+            return hit;
+        }
+#endif
+
+        uint64_t evicted_addr = 0;
+        if (block[set][way].valid) {
+            evicted_addr = block[set][way].address << LOG2_BLOCK_SIZE;
+            if (block[set][way].dirty && lower)
+                lower->functional_access(access_cpu, block[set][way].full_addr, 0, WRITEBACK, 0);
+        }
+
+        if (cache_type == IS_LLC)
+            llc_update_replacement_state(access_cpu, set, way, full_addr, ip, block[set][way].full_addr, type, 0);
+        else
+            update_replacement_state(access_cpu, set, way, full_addr, ip, block[set][way].full_addr, type, 0);
+
+        if (train) {
+            if (cache_type == IS_L1D)
+                l1d_prefetcher_cache_fill(full_addr, set, way, (type == PREFETCH) ? 1 : 0, evicted_addr, pf_metadata);
+            else if (cache_type == IS_L2C)
+                l2c_prefetcher_cache_fill(address << LOG2_BLOCK_SIZE, set, way, (type == PREFETCH) ? 1 : 0, evicted_addr, pf_metadata);
+            else if (cache_type == IS_LLC)
+                llc_prefetcher_cache_fill(address << LOG2_BLOCK_SIZE, set, way, (type == PREFETCH) ? 1 : 0, evicted_addr, pf_metadata);
+        }
+
+        PACKET packet;
+        packet.address = address;
+        packet.full_addr = full_addr;
+        packet.ip = ip;
+        packet.cpu = access_cpu;
+        packet.type = type;
+        fill_cache(set, way, &packet);
+        block[set][way].dirty = dirty;
+    }
+
+    cpu = saved_cpu;
+
+    return hit;
+}
+
+void CACHE::functional_translate(uint32_t access_cpu, uint64_t vpage, uint64_t va, uint64_t ppage)
+{
+    // functional_access() of the TLBs, vpage is the unique_vpage of the TLB requests and ppage the translation
+    uint32_t set = get_set(vpage), way = get_way(vpage, set);
+    if (way < NUM_WAY) {
+        update_replacement_state(access_cpu, set, way, va, 0, 0, LOAD, 1);
+        return;
+    }
+
+    if (lower_level)
+        ((CACHE *)lower_level)->functional_translate(access_cpu, vpage, va, ppage);
+
+    way = find_victim(access_cpu, 0, set, block[set], 0, va, LOAD);
+    update_replacement_state(access_cpu, set, way, va, 0, block[set][way].full_addr, LOAD, 0);
+
+    PACKET packet;
+    packet.address = vpage;
+    packet.full_addr = va;
+    packet.cpu = access_cpu;
+    packet.type = LOAD;
+    packet.data = ppage;
+    fill_cache(set, way, &packet);
+}
+
 int CACHE::check_hit(PACKET *packet)
 {
     uint32_t set = get_set(packet->address);
@@ -1013,19 +1217,16 @@ int CACHE::check_hit(PACKET *packet)
     }
 
     // hit
-    for (uint32_t way=0; way<NUM_WAY; way++) {
-        if (block[set][way].valid && (block[set][way].tag == packet->address)) {
+    uint32_t way = get_way(packet->address, set);
+    if (way < NUM_WAY) {
 
-            match_way = way;
+        match_way = way;
 
-            DP ( if (warmup_complete[packet->cpu]) {
-            cout << "[" << NAME << "] " << __func__ << " instr_id: " << packet->instr_id << " type: " << +packet->type << hex << " addr: " << packet->address;
-            cout << " full_addr: " << packet->full_addr << " tag: " << block[set][way].tag << " data: " << block[set][way].data << dec;
-            cout << " set: " << set << " way: " << way << " lru: " << block[set][way].lru;
-            cout << " event: " << packet->event_cycle << " cycle: " << current_core_cycle[cpu] << endl; });
-
-            break;
-        }
+        DP ( if (warmup_complete[packet->cpu]) {
+        cout << "[" << NAME << "] " << __func__ << " instr_id: " << packet->instr_id << " type: " << +packet->type << hex << " addr: " << packet->address;
+        cout << " full_addr: " << packet->full_addr << " tag: " << block[set][way].tag << " data: " << block[set][way].data << dec;
+        cout << " set: " << set << " way: " << way << " lru: " << lru_array[set*NUM_WAY + way];
+        cout << " event: " << packet->event_cycle << " cycle: " << current_core_cycle[cpu] << endl; });
     }
 
     return match_way;
@@ -1043,20 +1244,18 @@ int CACHE::invalidate_entry(uint64_t inval_addr)
     }
 
     // invalidate
-    for (uint32_t way=0; way<NUM_WAY; way++) {
-        if (block[set][way].valid && (block[set][way].tag == inval_addr)) {
-
-            block[set][way].valid = 0;
+    uint32_t way = get_way(inval_addr, set);
+    if (way < NUM_WAY) {
 
-            match_way = way;
+        block[set][way].valid = 0;
+        valid_mask[set] &= ~(1ull << way);
 
-            DP ( if (warmup_complete[cpu]) {
-            cout << "[" << NAME << "] " << __func__ << " inval_addr: " << hex << inval_addr;  
-            cout << " tag: " << block[set][way].tag << " data: " << block[set][way].data << dec;
-            cout << " set: " << set << " way: " << way << " lru: " << block[set][way].lru << " cycle: " << current_core_cycle[cpu] << endl; });
+        match_way = way;
 
-            break;
-        }
+        DP ( if (warmup_complete[cpu]) {
+        cout << "[" << NAME << "] " << __func__ << " inval_addr: " << hex << inval_addr;  
+        cout << " tag: " << block[set][way].tag << " data: " << block[set][way].data << dec;
+        cout << " set: " << set << " way: " << way << " lru: " << lru_array[set*NUM_WAY + way] << " cycle: " << current_core_cycle[cpu] << endl; });
     }
 
     return match_way;
@@ -1095,7 +1294,7 @@ int CACHE::add_rq(PACKET *packet)
             cout << "[" << NAME << "_RQ] " << __func__ << " instr_id: " << packet->instr_id << " found recent writebacks";
         cout << " cpu: " << cpu;
             cout << hex << " read: " << packet->address << " writeback: " << WQ.entry[wq_index].address << dec;
-            cout << " index: " << MAX_READ << " rob_signal: " << packet->rob_signal << endl; });
+            cout << " index: " << MAX_READ << endl; });
         }
 
         HIT[packet->type]++;
@@ -1113,7 +1312,7 @@ int CACHE::add_rq(PACKET *packet)
         
         if (packet->instruction) {
             uint32_t rob_index = packet->rob_index;
-            RQ.entry[index].rob_index_depend_on_me.insert (rob_index);
+            RQ.add_dependency(index).rob_index_depend_on_me.insert (rob_index);
             RQ.entry[index].instr_merged = 1;
 
             DP (if (warmup_complete[packet->cpu]) {
@@ -1126,12 +1325,12 @@ int CACHE::add_rq(PACKET *packet)
             if (packet->type == RFO) {
 
                 uint32_t sq_index = packet->sq_index;
-                RQ.entry[index].sq_index_depend_on_me.insert (sq_index);
+                RQ.add_dependency(index).sq_index_depend_on_me.insert (sq_index);
                 RQ.entry[index].store_merged = 1;
             }
             else {
                 uint32_t lq_index = packet->lq_index; 
-                RQ.entry[index].lq_index_depend_on_me.insert (lq_index);
+                RQ.add_dependency(index).lq_index_depend_on_me.insert (lq_index);
                 RQ.entry[index].load_merged = 1;
 
                 DP (if (warmup_complete[packet->cpu]) {
@@ -1165,7 +1364,7 @@ int CACHE::add_rq(PACKET *packet)
     }
 #endif
 
-    RQ.entry[index] = *packet;
+    RQ.add_queue(packet);
 
     // ADD LATENCY
     if (RQ.entry[index].event_cycle < current_core_cycle[packet->cpu])
@@ -1173,11 +1372,6 @@ int CACHE::add_rq(PACKET *packet)
     else
         RQ.entry[index].event_cycle += LATENCY;
 
-    RQ.occupancy++;
-    RQ.tail++;
-    if (RQ.tail >= RQ.SIZE)
-        RQ.tail = 0;
-
     DP ( if (warmup_complete[RQ.entry[index].cpu]) {
     cout << "[" << NAME << "_RQ] " <<  __func__ << " instr_id: " << RQ.entry[index].instr_id << " address: " << hex << RQ.entry[index].address;
         cout << " cpu: " << cpu;
@@ -1219,7 +1413,7 @@ int CACHE::add_wq(PACKET *packet)
         assert(0);
     }
 
-    WQ.entry[index] = *packet;
+    WQ.add_queue(packet);
 
     // ADD LATENCY
     if (WQ.entry[index].event_cycle < current_core_cycle[packet->cpu])
@@ -1227,11 +1421,6 @@ int CACHE::add_wq(PACKET *packet)
     else
         WQ.entry[index].event_cycle += LATENCY;
 
-    WQ.occupancy++;
-    WQ.tail++;
-    if (WQ.tail >= WQ.SIZE)
-        WQ.tail = 0;
-
     DP (if (warmup_complete[WQ.entry[index].cpu]) {
     cout << "[" << NAME << "_WQ] " <<  __func__ << " instr_id: " << WQ.entry[index].instr_id << " address: " << hex << WQ.entry[index].address;
     cout << " full_addr: " << WQ.entry[index].full_addr << dec;
@@ -1247,6 +1436,15 @@ int CACHE::add_wq(PACKET *packet)
 
 int CACHE::prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, int pf_fill_level, uint64_t prefetch_metadata)
 {
+    // the prefetch is filled right away, the fill hooks see it with its metadata as in the detailed fill
+    if (functional) {
+        if (pf_fill_level <= fill_level)
+            functional_access(cpu, pf_addr, ip, PREFETCH, 1, prefetch_metadata);
+        else if (cache_type != IS_LLC)
+            ((CACHE *)lower_level)->functional_access(cpu, pf_addr, ip, PREFETCH, 1, prefetch_metadata);
+        return 1;
+    }
+
     pf_requested++;
 
     if (PQ.occupancy < PQ.SIZE) {
@@ -1279,6 +1477,53 @@ int CACHE::prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, int
     return 0;
 }
 
+uint64_t CACHE::l2c_prefetcher_access(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in)
+{
+    // -record_stream keeps what the prefetcher of CPU 0 sees for the prefetcher benchmark
+    if (prefetcher_bench.record && (cpu == 0))
+        prefetcher_bench.record_access(ip, addr, cache_hit, type);
+
+    enter_prefetcher();
+    uint64_t metadata_out = CACHE_PROFILE(PROFILE_L2C_PREFETCHER_OPERATE, l2c_prefetcher_operate(addr, ip, cache_hit, type, metadata_in));
+    leave_prefetcher();
+
+    return metadata_out;
+}
+
+uint64_t CACHE::l2c_prefetcher_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in)
+{
+    enter_prefetcher();
+    uint64_t metadata_out = CACHE_PROFILE(PROFILE_L2C_PREFETCHER_FILL, l2c_prefetcher_cache_fill(addr, set, way, prefetch, evicted_addr, metadata_in));
+    leave_prefetcher();
+
+    return metadata_out;
+}
+
+void CACHE::enter_shared()
+{
+    // only the L2C reaches the LLC while the cores run apart
+    if (cache_type == IS_L2C)
+        core_scheduler.enter_shared(cpu);
+}
+
+void CACHE::leave_shared()
+{
+    if (cache_type == IS_L2C)
+        core_scheduler.leave_shared(cpu);
+}
+
+void CACHE::enter_prefetcher()
+{
+    if (prefetcher_per_core == 0)
+        enter_shared();
+}
+
+void CACHE::leave_prefetcher()
+{
+    if (prefetcher_per_core == 0)
+        leave_shared();
+}
+
 int CACHE::get_metadata(uint64_t meta_data_addr)//, uint32_t str_addr, uint8_t type)
 {
     //assert(0);
@@ -1288,6 +1533,9 @@ int CACHE::get_metadata(uint64_t meta_data_addr)//, uint32_t str_addr, uint8_t t
     //   meta_data_addr = ( ( meta_data_addr & 1 ) == 1 ) ? ( ( meta_data_addr >> 1 ) ^ crcPolynomial ) : ( meta_data_addr >> 1 );
 
     //cout << "CACHE: " << cpu << " " << hex << meta_data_addr << dec << endl;
+    if (functional)
+        return 1;
+
     PACKET pf_packet;
     pf_packet.fill_level = FILL_LLC;
     pf_packet.cpu = cpu;
@@ -1300,7 +1548,9 @@ int CACHE::get_metadata(uint64_t meta_data_addr)//, uint32_t str_addr, uint8_t t
     // give a dummy 0 as the IP of a prefetch
     //assert(extra_interface != NULL);
     //extra_interface->add_pq(&pf_packet);
+    enter_shared();
     lower_level->add_pq(&pf_packet);
+    leave_shared();
 
     return 1;
 }
@@ -1308,6 +1558,9 @@ int CACHE::get_metadata(uint64_t meta_data_addr)//, uint32_t str_addr, uint8_t t
 int CACHE::write_metadata(uint64_t meta_data_addr)
 {
     //cout << "WRITE MD: " << cpu << " " << hex << meta_data_addr << dec << endl;
+    if (functional)
+        return 1;
+
     PACKET wb_packet;
     wb_packet.fill_level = FILL_DRAM; 
     wb_packet.cpu = cpu;
@@ -1317,13 +1570,178 @@ int CACHE::write_metadata(uint64_t meta_data_addr)
     wb_packet.type = METADATA;
     wb_packet.event_cycle = current_core_cycle[cpu];
 
+    enter_shared();
     lower_level->add_wq(&wb_packet);
+    leave_shared();
 
     return 1;
 }
 
+// the L2C prefetcher reads and writes its metadata in the LLC ways above current_assoc
+// a read is answered through complete_metadata_req() once the LLC has handled it, it is dropped when the read port is full
+int CACHE::read_onchip_metadata(uint64_t meta_data_addr)
+{
+    if (functional) {
+        complete_metadata_req(meta_data_addr);
+        return 1;
+    }
+
+    PACKET md_packet;
+    md_packet.fill_level = FILL_LLC;
+    md_packet.cpu = cpu;
+    md_packet.address = meta_data_addr | ONCHIP_METADATA_SPACE;
+    md_packet.full_addr = md_packet.address;
+    md_packet.ip = 0;
+    md_packet.type = ONCHIP_METADATA;
+    md_packet.event_cycle = current_core_cycle[cpu];
+
+    enter_shared();
+    int index = ((CACHE *)lower_level)->add_metadata_read(&md_packet);
+    leave_shared();
+
+    return (index != -2);
+}
+
+int CACHE::add_metadata_read(PACKET *packet)
+{
+    // a metadata read gets the line of a metadata write that is still queued
+    if (WQ.check_queue(packet) != -1) {
+        HIT[ONCHIP_METADATA]++;
+        ACCESS[ONCHIP_METADATA]++;
+        WQ.FORWARD++;
+
+        upper_level_dcache[packet->cpu]->complete_metadata_req(packet->address & ~ONCHIP_METADATA_SPACE);
+        return -1;
+    }
+
+    // a read of a line that is already on its way completes every lookup of the line
+    for (uint32_t i=0; i<metadata_read.size(); i++) {
+        if (metadata_read[i].address == packet->address)
+            return i;
+    }
+
+    if (metadata_read.size() == LLC_METADATA_READ_SIZE)
+        return -2;
+
+    metadata_read.push_back(*packet);
+    metadata_read.back().event_cycle = current_core_cycle[packet->cpu] + LATENCY;
+
+    return metadata_read.size() - 1;
+}
+
+int CACHE::write_onchip_metadata(uint64_t meta_data_addr)
+{
+    if (functional)
+        return 1;
+
+    enter_shared();
+    if (lower_level->get_occupancy(2, meta_data_addr) == lower_level->get_size(2, meta_data_addr)) {
+        lower_level->increment_WQ_FULL(meta_data_addr);
+        leave_shared();
+        return 0;
+    }
+
+    PACKET md_packet;
+    md_packet.fill_level = FILL_LLC;
+    md_packet.cpu = cpu;
+    md_packet.address = meta_data_addr | ONCHIP_METADATA_SPACE;
+    md_packet.full_addr = md_packet.address;
+    md_packet.ip = 0;
+    md_packet.type = ONCHIP_METADATA;
+    md_packet.event_cycle = current_core_cycle[cpu];
+
+    lower_level->add_wq(&md_packet);
+    leave_shared();
+
+    return 1;
+}
+
+void CACHE::set_current_assoc(uint32_t assoc)
+{
+    if (assoc == current_assoc)
+        return;
+
+    if ((assoc == 0) || (assoc > NUM_WAY)) {
+        cerr << "[" << NAME << "] " << __func__ << " invalid assoc: " << assoc << " NUM_WAY: " << NUM_WAY << endl;
+        assert(0);
+    }
+
+    vector<uint32_t> order(NUM_WAY);
+    for (uint32_t set=0; set<NUM_SET; set++) {
+        // the metadata takes these ways, their data lines leave the cache
+        for (uint32_t way=assoc; way<current_assoc; way++) {
+            if ((valid_mask[set] & (1ull << way)) == 0)
+                continue;
+
+            BLOCK &victim = block[set][way];
+            // DRAM keeps no functional state, so a functional writeback is only counted
+            if (victim.dirty && lower_level) {
+                if (functional == 0) {
+                    PACKET writeback_packet;
+
+                    writeback_packet.fill_level = fill_level << 1;
+                    writeback_packet.cpu = victim.cpu;
+                    writeback_packet.address = victim.address;
+                    writeback_packet.full_addr = victim.full_addr;
+                    writeback_packet.data = victim.data;
+                    writeback_packet.ip = 0; // writeback does not have ip
+                    writeback_packet.type = WRITEBACK;
+
+                    partition_writeback.push_back(writeback_packet);
+                }
+                partition_writebacks++;
+            }
+
+            victim.valid = 0;
+            victim.dirty = 0;
+            valid_mask[set] &= ~(1ull << way);
+            partition_evictions++;
+        }
+
+        // the data ways keep their LRU order in positions 0 to assoc-1, the others follow
+        uint32_t *lru = &lru_array[set*NUM_WAY];
+        for (uint32_t way=0; way<NUM_WAY; way++)
+            order[way] = way;
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            if ((a < assoc) != (b < assoc))
+                return a < assoc;
+            return (lru[a] != lru[b]) ? (lru[a] < lru[b]) : (a < b);
+        });
+        for (uint32_t i=0; i<NUM_WAY; i++)
+            lru[order[i]] = i;
+    }
+
+    current_assoc = assoc;
+    partition_resizes++;
+}
+
+void CACHE::drain_partition_writeback()
+{
+    while (partition_writeback.size()) {
+        PACKET &writeback_packet = partition_writeback.front();
+        if (lower_level->get_occupancy(2, writeback_packet.address) == lower_level->get_size(2, writeback_packet.address))
+            break;
+
+        writeback_packet.event_cycle = current_core_cycle[writeback_packet.cpu];
+        lower_level->add_wq(&writeback_packet);
+        partition_writeback.pop_front();
+    }
+}
+
+void CACHE::print_partition_stats()
+{
+    if (partition_resizes == 0)
+        return;
+
+    cout << NAME << " METADATA PARTITION RESIZES: " << setw(10) << partition_resizes << "  DATA WAYS: " << setw(3) << current_assoc;
+    cout << "  EVICTIONS: " << setw(10) << partition_evictions << "  WRITEBACKS: " << setw(10) << partition_writebacks << endl;
+}
+
 int CACHE::kpc_prefetch_line(uint64_t base_addr, uint64_t pf_addr, int pf_fill_level, int delta, int depth, int signature, int confidence, uint64_t prefetch_metadata)
 {
+    if (functional)
+        return prefetch_line(0, base_addr, pf_addr, pf_fill_level, prefetch_metadata);
+
     if (PQ.occupancy < PQ.SIZE) {
         if ((base_addr>>LOG2_PAGE_SIZE) == (pf_addr>>LOG2_PAGE_SIZE)) {
             
@@ -1416,7 +1834,7 @@ int CACHE::add_pq(PACKET *packet)
     }
 #endif
 
-    PQ.entry[index] = *packet;
+    PQ.add_queue(packet);
 
     // ADD LATENCY
     if (PQ.entry[index].event_cycle < current_core_cycle[packet->cpu])
@@ -1424,11 +1842,6 @@ int CACHE::add_pq(PACKET *packet)
     else
         PQ.entry[index].event_cycle += LATENCY;
 
-    PQ.occupancy++;
-    PQ.tail++;
-    if (PQ.tail >= PQ.SIZE)
-        PQ.tail = 0;
-
     DP ( if (warmup_complete[PQ.entry[index].cpu]) {
     cout << "[" << NAME << "_PQ] " <<  __func__ << " instr_id: " << PQ.entry[index].instr_id << " address: " << hex << PQ.entry[index].address;
         cout << " cpu: " << cpu;
@@ -1521,6 +1934,28 @@ void CACHE::update_fill_cycle()
     }
 }
 
+uint64_t CACHE::get_next_event_cycle()
+{
+    // earliest cycle at which operate() can change any state
+    // a value at or below the current cycle means this cache has work to do right now
+    uint64_t next_cycle = MSHR.next_fill_cycle;
+
+    if (WQ.occupancy && (WQ.entry[WQ.head].event_cycle < next_cycle))
+        next_cycle = WQ.entry[WQ.head].event_cycle;
+
+    if (RQ.occupancy && (RQ.entry[RQ.head].event_cycle < next_cycle))
+        next_cycle = RQ.entry[RQ.head].event_cycle;
+
+    if (metadata_read.size() && (metadata_read.front().event_cycle < next_cycle))
+        next_cycle = metadata_read.front().event_cycle;
+
+    // prefetches are only handled when the read queue is empty
+    if (PQ.occupancy && (RQ.occupancy == 0) && (PQ.entry[PQ.head].event_cycle < next_cycle))
+        next_cycle = PQ.entry[PQ.head].event_cycle;
+
+    return next_cycle;
+}
+
 int CACHE::check_mshr(PACKET *packet)
 {
     // search mshr
@@ -1562,7 +1997,7 @@ void CACHE::add_mshr(PACKET *packet)
     for (index=0; index<MSHR_SIZE; index++) {
         if (MSHR.entry[index].address == 0) {
             
-            MSHR.entry[index] = *packet;
+            MSHR.assign(index, packet);
             MSHR.entry[index].returned = INFLIGHT;
             MSHR.occupancy++;
 
@@ -1610,3 +2045,70 @@ void CACHE::increment_WQ_FULL(uint64_t address)
 {
     WQ.FULL++;
 }
+
+void CACHE::checkpoint(CHECKPOINT &cp)
+{
+    // the queues and MSHRs are not saved, the requests in flight are issued again after a restore
+    cp.section(NAME);
+    cp.check(NUM_SET, "number of sets");
+    cp.check(NUM_WAY, "number of ways");
+
+    for (uint32_t i=0; i<NUM_SET; i++)
+        cp.io_array(block[i], NUM_WAY);
+    cp.io_array(tag_array, NUM_SET*NUM_WAY);
+    cp.io_array(valid_mask, NUM_SET);
+    cp.io_array(lru_array, NUM_SET*NUM_WAY);
+    cp.io(current_assoc);
+    cp.io(partition_resizes);
+    cp.io(partition_evictions);
+    cp.io(partition_writebacks);
+
+    cp.io(pf_requested);
+    cp.io(pf_issued);
+    cp.io(pf_useful);
+    cp.io(pf_useless);
+    cp.io(pf_fill);
+
+    if (cache_type == IS_L1D)
+        l1d_prefetcher_checkpoint(cp);
+    else if (cache_type == IS_L2C)
+        l2c_prefetcher_checkpoint(cp);
+    else if (cache_type == IS_LLC) {
+        llc_replacement_checkpoint(cp);
+        llc_prefetcher_checkpoint(cp);
+    }
+}
+
+void CACHE::register_stats()
+{
+    const string type_name[NUM_TYPES] = {"LOAD", "RFO", "PREFETCH", "WRITEBACK", "METADATA", "ONCHIP_METADATA"};
+
+    // the private caches only count the requests of their own core
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        if ((cache_type != IS_LLC) && (i != cpu))
+            continue;
+
+        string prefix = "cpu" + to_string(i) + "." + NAME + ".";
+        for (uint32_t j=0; j<NUM_TYPES; j++) {
+            stats_registry.add(prefix + type_name[j] + ".access", &sim_access[i][j]);
+            stats_registry.add(prefix + type_name[j] + ".hit", &sim_hit[i][j]);
+            stats_registry.add(prefix + type_name[j] + ".miss", &sim_miss[i][j]);
+        }
+        for (uint32_t j=0; j<NUM_TYPES; j++) {
+            stats_registry.add(prefix + "roi." + type_name[j] + ".access", &roi_access[i][j]);
+            stats_registry.add(prefix + "roi." + type_name[j] + ".hit", &roi_hit[i][j]);
+            stats_registry.add(prefix + "roi." + type_name[j] + ".miss", &roi_miss[i][j]);
+        }
+    }
+
+    string prefix = ((cache_type == IS_LLC) ? "" : "cpu" + to_string(cpu) + ".") + NAME + ".";
+    stats_registry.add(prefix + "pf_requested", &pf_requested);
+    stats_registry.add(prefix + "pf_issued", &pf_issued);
+    stats_registry.add(prefix + "pf_useful", &pf_useful);
+    stats_registry.add(prefix + "pf_useless", &pf_useless);
+    stats_registry.add(prefix + "pf_fill", &pf_fill);
+    stats_registry.add(prefix + "assoc", &current_assoc);
+    stats_registry.add(prefix + "partition_resizes", &partition_resizes);
+    stats_registry.add(prefix + "partition_evictions", &partition_evictions);
+    stats_registry.add(prefix + "partition_writebacks", &partition_writebacks);
+}
@@ -0,0 +1,57 @@
+#include "champsim.h"
+
+void CHECKPOINT::open()
+{
+    file = gzopen(NAME.c_str(), saving() ? "wb6" : "rb");
+    if (file == NULL) {
+        cerr << "[CHECKPOINT] cannot open " << NAME << endl;
+        assert(0);
+    }
+    gzbuffer(file, 1 << 16);
+
+    check(CHECKPOINT_MAGIC, "file format");
+    check(CHECKPOINT_VERSION, "version");
+}
+
+void CHECKPOINT::raw(void *data, size_t size)
+{
+    // gzread and gzwrite take an unsigned length
+    uint8_t *ptr = (uint8_t *)data;
+    while (size) {
+        unsigned chunk = (size > (1u << 30)) ? (1u << 30) : size;
+        int done = saving() ? gzwrite(file, ptr, chunk) : gzread(file, ptr, chunk);
+        if (done != (int)chunk) {
+            cerr << "[CHECKPOINT] " << (saving() ? "cannot write " : "truncated checkpoint ") << NAME << endl;
+            assert(0);
+        }
+        ptr += chunk;
+        size -= chunk;
+    }
+}
+
+void CHECKPOINT::section(string tag)
+{
+    // tags separate the components so a checkpoint of another configuration is caught early
+    string found = tag;
+    io(found);
+    if (found != tag) {
+        cerr << "[CHECKPOINT] " << NAME << " expected section " << tag << " but found " << found << endl;
+        assert(0);
+    }
+}
+
+void CHECKPOINT::check(uint64_t value, string what)
+{
+    uint64_t found = value;
+    io(found);
+    if (found != value) {
+        cerr << "[CHECKPOINT] " << NAME << " was taken with a different " << what << ": " << found << " (this run: " << value << ")" << endl;
+        assert(0);
+    }
+}
+
+void CHECKPOINT::not_supported(string what)
+{
+    section(what);
+    cout << "[CHECKPOINT] " << what << " state is not checkpointed, it starts cold after a restore" << endl;
+}
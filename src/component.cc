@@ -0,0 +1,169 @@
+#include "component.h"
+
+#ifdef COMPONENT_REGISTRY
+
+REGISTRY<BRANCH_COMPONENT> &branch_predictors()
+{
+    static REGISTRY<BRANCH_COMPONENT> registry("branch predictor");
+    return registry;
+}
+
+REGISTRY<PREFETCHER_COMPONENT> &l1d_prefetchers()
+{
+    static REGISTRY<PREFETCHER_COMPONENT> registry("L1D prefetcher");
+    return registry;
+}
+
+REGISTRY<PREFETCHER_COMPONENT> &l2c_prefetchers()
+{
+    static REGISTRY<PREFETCHER_COMPONENT> registry("L2C prefetcher");
+    return registry;
+}
+
+REGISTRY<PREFETCHER_COMPONENT> &llc_prefetchers()
+{
+    static REGISTRY<PREFETCHER_COMPONENT> registry("LLC prefetcher");
+    return registry;
+}
+
+REGISTRY<REPLACEMENT_COMPONENT> &llc_replacements()
+{
+    static REGISTRY<REPLACEMENT_COMPONENT> registry("LLC replacement policy");
+    return registry;
+}
+
+// the simulator calls the hooks as before, they forward to the component picked for each cache or core
+// one indirect call per hook, the branch target is the same for the whole run and is always predicted
+
+// branch predictor
+void O3_CPU::initialize_branch_predictor()
+{
+    branch_component->initialize(this);
+}
+
+uint8_t O3_CPU::predict_branch(uint64_t ip)
+{
+    return branch_component->predict(this, ip);
+}
+
+void O3_CPU::last_branch_result(uint64_t ip, uint8_t taken)
+{
+    branch_component->last_result(this, ip, taken);
+}
+
+void O3_CPU::checkpoint_branch_predictor(CHECKPOINT &cp)
+{
+    branch_component->checkpoint(this, cp);
+}
+
+// L1D prefetcher
+void CACHE::l1d_prefetcher_initialize()
+{
+    prefetcher_component->initialize(this);
+}
+
+void CACHE::l1d_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type)
+{
+    prefetcher_component->operate(this, addr, ip, cache_hit, type, 0);
+}
+
+void CACHE::l1d_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in)
+{
+    prefetcher_component->cache_fill(this, addr, set, way, prefetch, evicted_addr, metadata_in);
+}
+
+void CACHE::l1d_prefetcher_final_stats()
+{
+    prefetcher_component->final_stats(this);
+}
+
+void CACHE::l1d_prefetcher_checkpoint(CHECKPOINT &cp)
+{
+    prefetcher_component->checkpoint(this, cp);
+}
+
+// L2C prefetcher
+void CACHE::l2c_prefetcher_initialize()
+{
+    prefetcher_component->initialize(this);
+}
+
+uint64_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in)
+{
+    return prefetcher_component->operate(this, addr, ip, cache_hit, type, metadata_in);
+}
+
+uint64_t CACHE::l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in)
+{
+    return prefetcher_component->cache_fill(this, addr, set, way, prefetch, evicted_addr, metadata_in);
+}
+
+void CACHE::l2c_prefetcher_final_stats()
+{
+    prefetcher_component->final_stats(this);
+}
+
+void CACHE::l2c_prefetcher_checkpoint(CHECKPOINT &cp)
+{
+    prefetcher_component->checkpoint(this, cp);
+}
+
+void CACHE::complete_metadata_req(uint64_t phy_addr)
+{
+    if (prefetcher_component && prefetcher_component->complete_metadata_req)
+        prefetcher_component->complete_metadata_req(this, phy_addr);
+}
+
+// LLC prefetcher
+void CACHE::llc_prefetcher_initialize()
+{
+    prefetcher_component->initialize(this);
+}
+
+uint64_t CACHE::llc_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint64_t metadata_in)
+{
+    return prefetcher_component->operate(this, addr, ip, cache_hit, type, metadata_in);
+}
+
+uint64_t CACHE::llc_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint64_t metadata_in)
+{
+    return prefetcher_component->cache_fill(this, addr, set, way, prefetch, evicted_addr, metadata_in);
+}
+
+void CACHE::llc_prefetcher_final_stats()
+{
+    prefetcher_component->final_stats(this);
+}
+
+void CACHE::llc_prefetcher_checkpoint(CHECKPOINT &cp)
+{
+    prefetcher_component->checkpoint(this, cp);
+}
+
+// LLC replacement policy
+void CACHE::llc_initialize_replacement()
+{
+    replacement_component->initialize(this);
+}
+
+uint32_t CACHE::llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
+{
+    return replacement_component->find_victim(this, cpu, instr_id, set, current_set, ip, full_addr, type);
+}
+
+void CACHE::llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit)
+{
+    replacement_component->update_state(this, cpu, set, way, full_addr, ip, victim_addr, type, hit);
+}
+
+void CACHE::llc_replacement_final_stats()
+{
+    replacement_component->final_stats(this);
+}
+
+void CACHE::llc_replacement_checkpoint(CHECKPOINT &cp)
+{
+    replacement_component->checkpoint(this, cp);
+}
+
+#endif
@@ -0,0 +1,170 @@
+#include "ooo_cpu.h"
+#include "uncore.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+CORE_SCHEDULER core_scheduler;
+
+static inline void spin_wait(uint32_t &spins)
+{
+    // give the host core away if the thread we wait for is not running
+    if (++spins < SPIN_LIMIT) {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    } else {
+        spins = 0;
+        this_thread::yield();
+    }
+}
+
+void CORE_SCHEDULER::start()
+{
+    if (deterministic)
+        quantum = 1;
+
+    if (quantum == 0) {
+        cerr << "[CORE_SCHEDULER] quantum must be at least one cycle" << endl;
+        assert(0);
+    }
+
+    for (uint32_t i=1; i<NUM_CPUS; i++)
+        workers.push_back(thread(&CORE_SCHEDULER::worker_loop, this, i));
+}
+
+void CORE_SCHEDULER::finish()
+{
+    stop = 1;
+    generation.fetch_add(1, memory_order_release);
+
+    for (uint32_t i=0; i<workers.size(); i++)
+        workers[i].join();
+    workers.clear();
+}
+
+void CORE_SCHEDULER::worker_loop(uint32_t cpu)
+{
+    uint64_t seen = 0;
+    while (1) {
+        uint32_t spins = 0;
+        while (generation.load(memory_order_acquire) == seen)
+            spin_wait(spins);
+        seen++;
+
+        if (stop)
+            return;
+
+        run_core(cpu);
+        finished.fetch_add(1, memory_order_release);
+    }
+}
+
+void CORE_SCHEDULER::run_core(uint32_t cpu)
+{
+    for (uint64_t i=0; i<quantum_cycles; i++) {
+        operate_core(cpu);
+        end_cycle(cpu);
+    }
+}
+
+void CORE_SCHEDULER::end_cycle(uint32_t cpu)
+{
+    // the per-core checks update global counters and the LLC stats
+    enter_shared(cpu);
+    check_core(cpu);
+
+    if (parallel && deterministic) {
+        has_token[cpu] = 0;
+        token.store(cpu+1, memory_order_release);
+    } else
+        leave_shared(cpu);
+}
+
+void CORE_SCHEDULER::enter_shared(uint32_t cpu)
+{
+    if (!parallel)
+        return;
+
+    if (deterministic) {
+        // the token is held from the first shared access until the end of the cycle
+        if (has_token[cpu])
+            return;
+
+        uint32_t spins = 0;
+        while (token.load(memory_order_acquire) != cpu)
+            spin_wait(spins);
+        has_token[cpu] = 1;
+    } else if (shared_depth[cpu]++ == 0)
+        shared_lock.lock();
+}
+
+void CORE_SCHEDULER::leave_shared(uint32_t cpu)
+{
+    if (parallel && !deterministic && (--shared_depth[cpu] == 0))
+        shared_lock.unlock();
+}
+
+uint8_t CORE_SCHEDULER::defer_warmup()
+{
+    // finish_warmup() resets the stats of every core, which must not happen while other cores are running
+    return parallel;
+}
+
+uint8_t CORE_SCHEDULER::warmup_may_finish()
+{
+    if (all_warmup_complete >= NUM_CPUS)
+        return 0;
+
+    // a core retires at most RETIRE_WIDTH instructions per cycle
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        if ((warmup_complete[i] == 0) && ((ooo_cpu[i].num_retired + RETIRE_WIDTH) <= ooo_cpu[i].warmup_instructions))
+            return 0;
+    }
+
+    return 1;
+}
+
+void CORE_SCHEDULER::run_quantum()
+{
+    // in deterministic mode the cycle that finishes the warmup runs serially, exactly like the serial loop
+    if (deterministic && warmup_may_finish()) {
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            operate_core(i);
+            check_core(i);
+        }
+
+        uncore.LLC.operate();
+        uncore.DRAM.operate();
+        return;
+    }
+
+    quantum_cycles = quantum;
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        begin_cycle[i] = current_core_cycle[i];
+
+    token.store(0, memory_order_relaxed);
+    finished.store(0, memory_order_relaxed);
+    parallel = 1;
+    generation.fetch_add(1, memory_order_release);
+
+    run_core(0);
+
+    uint32_t spins = 0;
+    while (finished.load(memory_order_acquire) != (NUM_CPUS-1))
+        spin_wait(spins);
+    parallel = 0;
+
+    // replay the quantum in the uncore with the clock of each cycle
+    for (uint64_t i=1; i<=quantum_cycles; i++) {
+        if (quantum_cycles > 1) {
+            for (uint32_t j=0; j<NUM_CPUS; j++)
+                current_core_cycle[j] = begin_cycle[j] + i;
+        }
+
+        // top-down like the caches of a core, DRAM sees what the LLC sent in the same cycle
+        uncore.LLC.operate();
+        uncore.DRAM.operate();
+    }
+}
@@ -10,19 +10,16 @@ uint32_t DRAM_MTPS, DRAM_DBUS_RETURN_TIME,
 
 void MEMORY_CONTROLLER::reset_remain_requests(PACKET_QUEUE *queue, uint32_t channel)
 {
+    DRAM_SLOT *queue_slot = slot[queue->is_WQ][channel];
+
     for (uint32_t i=0; i<queue->SIZE; i++) {
         if (queue->entry[i].scheduled) {
 
-            uint64_t op_addr = queue->entry[i].address;
             uint32_t op_cpu = queue->entry[i].cpu,
-                     op_channel = dram_get_channel(op_addr), 
-                     op_rank = dram_get_rank(op_addr), 
-                     op_bank = dram_get_bank(op_addr), 
-                     op_row = dram_get_row(op_addr);
-
-#ifdef DEBUG_PRINT
-            //uint32_t op_column = dram_get_column(op_addr);
-#endif
+                     op_channel = channel, 
+                     op_rank = queue_slot[i].rank, 
+                     op_bank = queue_slot[i].bank, 
+                     op_row = queue_slot[i].row;
 
             // update open row
             if ((bank_request[op_channel][op_rank][op_bank].cycle_available - tCAS) <= current_core_cycle[op_cpu])
@@ -46,6 +43,7 @@ void MEMORY_CONTROLLER::reset_remain_requests(PACKET_QUEUE *queue, uint32_t chan
 
             queue->entry[i].scheduled = 0;
             queue->entry[i].event_cycle = current_core_cycle[op_cpu];
+            bank_queue_insert(queue, channel, i);
 
             DP ( if (warmup_complete[op_cpu]) {
             cout << queue->NAME << " instr_id: " << queue->entry[i].instr_id << " swrites: " << scheduled_writes[channel] << " sreads: " << scheduled_reads[channel] << endl; });
@@ -72,6 +70,8 @@ void MEMORY_CONTROLLER::reset_remain_requests(PACKET_QUEUE *queue, uint32_t chan
 
 void MEMORY_CONTROLLER::operate()
 {
+    PROFILE(PROFILE_UNCORE, PROFILE_DRAM);
+
     for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
         if ((write_mode[i] == 0) && (WQ[i].occupancy >= DRAM_WRITE_HIGH_WM)) {
             write_mode[i] = 1;
@@ -125,94 +125,57 @@ void MEMORY_CONTROLLER::operate()
 
 void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
 {
-    uint64_t read_addr;
-    uint32_t read_channel, read_rank, read_bank, read_row;
+    uint32_t channel = get_queue_channel(queue);
+    DRAM_SLOT *queue_slot = slot[queue->is_WQ][channel];
     uint8_t  row_buffer_hit = 0;
 
     int oldest_index = -1;
     uint64_t oldest_cycle = UINT64_MAX;
 
     // first, search for the oldest open row hit
-    for (uint32_t i=0; i<queue->SIZE; i++) {
+    // each bank list is sorted from the oldest request, so only the first match per bank is a candidate
+    for (uint32_t rank=0; rank<DRAM_RANKS; rank++) {
+        for (uint32_t bank=0; bank<DRAM_BANKS; bank++) {
 
-        // already scheduled
-        if (queue->entry[i].scheduled) 
-            continue;
-
-        // empty entry
-        read_addr = queue->entry[i].address;
-        if (read_addr == 0) 
-            continue;
-
-        read_channel = dram_get_channel(read_addr);
-        read_rank = dram_get_rank(read_addr);
-        read_bank = dram_get_bank(read_addr);
-
-        // bank is busy
-        if (bank_request[read_channel][read_rank][read_bank].working) { // should we check this or not? how do we know if bank is busy or not for all requests in the queue?
-
-            //DP ( if (warmup_complete[0]) {
-            //cout << queue->NAME << " " << __func__ << " instr_id: " << queue->entry[i].instr_id << " bank is busy";
-            //cout << " swrites: " << scheduled_writes[channel] << " sreads: " << scheduled_reads[channel];
-            //cout << " write: " << +bank_request[read_channel][read_rank][read_bank].is_write << " read: " << +bank_request[read_channel][read_rank][read_bank].is_read << hex;
-            //cout << " address: " << queue->entry[i].address << dec << " channel: " << read_channel << " rank: " << read_rank << " bank: " << read_bank << endl; });
-
-            continue;
-        }
-
-        read_row = dram_get_row(read_addr);
-        //read_column = dram_get_column(read_addr);
-
-        // check open row
-        if (bank_request[read_channel][read_rank][read_bank].open_row != read_row) {
-
-            /*
-            DP ( if (warmup_complete[0]) {
-            cout << queue->NAME << " " << __func__ << " instr_id: " << queue->entry[i].instr_id << " row is inactive";
-            cout << " swrites: " << scheduled_writes[channel] << " sreads: " << scheduled_reads[channel];
-            cout << " write: " << +bank_request[read_channel][read_rank][read_bank].is_write << " read: " << +bank_request[read_channel][read_rank][read_bank].is_read << hex;
-            cout << " address: " << queue->entry[i].address << dec << " channel: " << read_channel << " rank: " << read_rank << " bank: " << read_bank << endl; });
-            */
+            // bank is busy
+            if (bank_request[channel][rank][bank].working)
+                continue;
 
-            continue;
+            uint32_t open_row = bank_request[channel][rank][bank].open_row;
+            for (int i=bank_queue_head[queue->is_WQ][channel][rank][bank]; i!=-1; i=queue_slot[i].next) {
+                if (queue_slot[i].row != open_row)
+                    continue;
+
+                // select the oldest entry, ties go to the lower index
+                if ((queue->entry[i].event_cycle < oldest_cycle) || ((queue->entry[i].event_cycle == oldest_cycle) && (i < oldest_index))) {
+                    oldest_cycle = queue->entry[i].event_cycle;
+                    oldest_index = i;
+                    row_buffer_hit = 1;
+                }
+                break;
+            }
         }
-
-        // select the oldest entry
-        if (queue->entry[i].event_cycle < oldest_cycle) {
-            oldest_cycle = queue->entry[i].event_cycle;
-            oldest_index = i;
-            row_buffer_hit = 1;
-        }	  
     }
 
     if (oldest_index == -1) { // no matching open_row (row buffer miss)
 
         oldest_cycle = UINT64_MAX;
-        for (uint32_t i=0; i<queue->SIZE; i++) {
-
-            // already scheduled
-            if (queue->entry[i].scheduled)
-                continue;
-
-            // empty entry
-            read_addr = queue->entry[i].address;
-            if (read_addr == 0) 
-                continue;
-
-            // bank is busy
-            read_channel = dram_get_channel(read_addr);
-            read_rank = dram_get_rank(read_addr);
-            read_bank = dram_get_bank(read_addr);
-            if (bank_request[read_channel][read_rank][read_bank].working) 
-                continue;
-
-            //read_row = dram_get_row(read_addr);
-            //read_column = dram_get_column(read_addr);
-
-            // select the oldest entry
-            if (queue->entry[i].event_cycle < oldest_cycle) {
-                oldest_cycle = queue->entry[i].event_cycle;
-                oldest_index = i;
+        for (uint32_t rank=0; rank<DRAM_RANKS; rank++) {
+            for (uint32_t bank=0; bank<DRAM_BANKS; bank++) {
+
+                // bank is busy
+                if (bank_request[channel][rank][bank].working)
+                    continue;
+
+                int i = bank_queue_head[queue->is_WQ][channel][rank][bank];
+                if (i == -1)
+                    continue;
+
+                // select the oldest entry
+                if ((queue->entry[i].event_cycle < oldest_cycle) || ((queue->entry[i].event_cycle == oldest_cycle) && (i < oldest_index))) {
+                    oldest_cycle = queue->entry[i].event_cycle;
+                    oldest_index = i;
+                }
             }
         }
     }
@@ -226,14 +189,13 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
         //else 
             LATENCY = tRP + tRCD + tCAS;
 
-        uint64_t op_addr = queue->entry[oldest_index].address;
         uint32_t op_cpu = queue->entry[oldest_index].cpu,
-                 op_channel = dram_get_channel(op_addr), 
-                 op_rank = dram_get_rank(op_addr), 
-                 op_bank = dram_get_bank(op_addr), 
-                 op_row = dram_get_row(op_addr);
+                 op_channel = channel, 
+                 op_rank = queue_slot[oldest_index].rank, 
+                 op_bank = queue_slot[oldest_index].bank, 
+                 op_row = queue_slot[oldest_index].row;
 #ifdef DEBUG_PRINT
-        uint32_t op_column = dram_get_column(op_addr);
+        uint32_t op_column = dram_get_column(queue->entry[oldest_index].address);
 #endif
 
         // this bank is now busy
@@ -257,6 +219,7 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
         // update open row
         bank_request[op_channel][op_rank][op_bank].open_row = op_row;
 
+        bank_queue_remove(queue, channel, oldest_index);
         queue->entry[oldest_index].scheduled = 1;
         queue->entry[oldest_index].event_cycle = current_core_cycle[op_cpu] + LATENCY;
 
@@ -466,9 +429,15 @@ int MEMORY_CONTROLLER::add_rq(PACKET *packet)
     for (index=0; index<DRAM_RQ_SIZE; index++) {
         if (RQ[channel].entry[index].address == 0) {
             
-            RQ[channel].entry[index] = *packet;
+            RQ[channel].assign(index, packet);
             RQ[channel].occupancy++;
 
+            // decode the bank once, the scheduler only looks at the per-bank lists
+            slot[0][channel][index].rank = dram_get_rank(packet->address);
+            slot[0][channel][index].bank = dram_get_bank(packet->address);
+            slot[0][channel][index].row = dram_get_row(packet->address);
+            bank_queue_insert(&RQ[channel], channel, index);
+
 #ifdef DEBUG_PRINT
             uint32_t channel = dram_get_channel(packet->address),
                      rank = dram_get_rank(packet->address),
@@ -508,9 +477,15 @@ int MEMORY_CONTROLLER::add_wq(PACKET *packet)
     for (index=0; index<DRAM_WQ_SIZE; index++) {
         if (WQ[channel].entry[index].address == 0) {
             
-            WQ[channel].entry[index] = *packet;
+            WQ[channel].assign(index, packet);
             WQ[channel].occupancy++;
 
+            // decode the bank once, the scheduler only looks at the per-bank lists
+            slot[1][channel][index].rank = dram_get_rank(packet->address);
+            slot[1][channel][index].bank = dram_get_bank(packet->address);
+            slot[1][channel][index].row = dram_get_row(packet->address);
+            bank_queue_insert(&WQ[channel], channel, index);
+
 #ifdef DEBUG_PRINT
             uint32_t channel = dram_get_channel(packet->address),
                      rank = dram_get_rank(packet->address),
@@ -547,20 +522,20 @@ void MEMORY_CONTROLLER::return_data(PACKET *packet)
 void MEMORY_CONTROLLER::update_schedule_cycle(PACKET_QUEUE *queue)
 {
     // update next_schedule_cycle
+    // the oldest unscheduled request is at the head of one of the bank lists
+    uint32_t channel = get_queue_channel(queue);
     uint64_t min_cycle = UINT64_MAX;
     uint32_t min_index = queue->SIZE;
-    for (uint32_t i=0; i<queue->SIZE; i++) {
-        /*
-        DP (if (warmup_complete[queue->entry[min_index].cpu]) {
-        cout << "[" << queue->NAME << "] " <<  __func__ << " instr_id: " << queue->entry[i].instr_id;
-        cout << " index: " << i << " address: " << hex << queue->entry[i].address << dec << " scheduled: " << +queue->entry[i].scheduled;
-        cout << " event: " << queue->entry[i].event_cycle << " min_cycle: " << min_cycle << endl;
-        });
-        */
-
-        if (queue->entry[i].address && (queue->entry[i].scheduled == 0) && (queue->entry[i].event_cycle < min_cycle)) {
-            min_cycle = queue->entry[i].event_cycle;
-            min_index = i;
+    for (uint32_t rank=0; rank<DRAM_RANKS; rank++) {
+        for (uint32_t bank=0; bank<DRAM_BANKS; bank++) {
+            int i = bank_queue_head[queue->is_WQ][channel][rank][bank];
+            if (i == -1)
+                continue;
+
+            if ((queue->entry[i].event_cycle < min_cycle) || ((queue->entry[i].event_cycle == min_cycle) && ((uint32_t)i < min_index))) {
+                min_cycle = queue->entry[i].event_cycle;
+                min_index = i;
+            }
         }
     }
     
@@ -579,12 +554,21 @@ void MEMORY_CONTROLLER::update_schedule_cycle(PACKET_QUEUE *queue)
 void MEMORY_CONTROLLER::update_process_cycle(PACKET_QUEUE *queue)
 {
     // update next_process_cycle
+    // every scheduled request is held by exactly one bank
+    uint32_t channel = get_queue_channel(queue);
     uint64_t min_cycle = UINT64_MAX;
     uint32_t min_index = queue->SIZE;
-    for (uint32_t i=0; i<queue->SIZE; i++) {
-        if (queue->entry[i].scheduled && (queue->entry[i].event_cycle < min_cycle)) {
-            min_cycle = queue->entry[i].event_cycle;
-            min_index = i;
+    for (uint32_t rank=0; rank<DRAM_RANKS; rank++) {
+        for (uint32_t bank=0; bank<DRAM_BANKS; bank++) {
+            BANK_REQUEST *request = &bank_request[channel][rank][bank];
+            if ((request->request_index == -1) || (queue->is_WQ ? (request->is_write == 0) : (request->is_read == 0)))
+                continue;
+
+            uint32_t i = request->request_index;
+            if ((queue->entry[i].event_cycle < min_cycle) || ((queue->entry[i].event_cycle == min_cycle) && (i < min_index))) {
+                min_cycle = queue->entry[i].event_cycle;
+                min_index = i;
+            }
         }
     }
     
@@ -600,6 +584,105 @@ void MEMORY_CONTROLLER::update_process_cycle(PACKET_QUEUE *queue)
     }
 }
 
+uint64_t MEMORY_CONTROLLER::get_bank_earliest_cycle()
+{
+    // earliest cycle at which a busy bank finishes its current request
+    uint64_t min_cycle = UINT64_MAX;
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        for (uint32_t j=0; j<DRAM_RANKS; j++) {
+            for (uint32_t k=0; k<DRAM_BANKS; k++) {
+                if (bank_request[i][j][k].working && (bank_request[i][j][k].cycle_available < min_cycle))
+                    min_cycle = bank_request[i][j][k].cycle_available;
+            }
+        }
+    }
+
+    return min_cycle;
+}
+
+uint64_t MEMORY_CONTROLLER::get_next_event_cycle()
+{
+    // earliest cycle at which operate() can change any state
+    // a value at or below the current cycle means the controller has work to do right now
+    uint64_t next_cycle = UINT64_MAX;
+
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        // read/write mode switch
+        if ((write_mode[i] == 0) && (WQ[i].occupancy >= DRAM_WRITE_HIGH_WM))
+            return 0;
+        if (write_mode[i] && ((WQ[i].occupancy == 0) || (RQ[i].occupancy && (WQ[i].occupancy < DRAM_WRITE_LOW_WM))))
+            return 0;
+
+        PACKET_QUEUE *queue = write_mode[i] ? &WQ[i] : &RQ[i];
+
+        // a new request can only be scheduled on an idle bank
+        if ((queue->next_schedule_index < queue->SIZE) && (queue->next_schedule_cycle < next_cycle)) {
+            for (uint32_t j=0; (j<DRAM_RANKS*DRAM_BANKS) && (next_cycle > queue->next_schedule_cycle); j++) {
+                uint32_t rank = j / DRAM_BANKS, bank = j % DRAM_BANKS;
+                if ((bank_request[i][rank][bank].working == 0) && (bank_queue_head[queue->is_WQ][i][rank][bank] != -1))
+                    next_cycle = queue->next_schedule_cycle;
+            }
+        }
+
+        // a scheduled request is processed once both its issue cycle and its bank are ready
+        if (queue->next_process_index < queue->SIZE) {
+            uint64_t process_cycle = get_bank_earliest_cycle();
+            if (queue->next_process_cycle > process_cycle)
+                process_cycle = queue->next_process_cycle;
+            if (process_cycle < next_cycle)
+                next_cycle = process_cycle;
+        }
+    }
+
+    return next_cycle;
+}
+
+uint32_t MEMORY_CONTROLLER::get_queue_channel(PACKET_QUEUE *queue)
+{
+    if (queue->is_WQ)
+        return queue - WQ;
+
+    return queue - RQ;
+}
+
+void MEMORY_CONTROLLER::bank_queue_insert(PACKET_QUEUE *queue, uint32_t channel, uint32_t index)
+{
+    DRAM_SLOT *queue_slot = slot[queue->is_WQ][channel];
+    int *head = &bank_queue_head[queue->is_WQ][channel][queue_slot[index].rank][queue_slot[index].bank];
+    uint64_t event_cycle = queue->entry[index].event_cycle;
+
+    // keep the list sorted by (event_cycle, index) so the head is the request a full queue scan would pick
+    int *prev = head;
+    while (*prev != -1) {
+        uint64_t cycle = queue->entry[*prev].event_cycle;
+        if ((cycle > event_cycle) || ((cycle == event_cycle) && ((uint32_t)*prev > index)))
+            break;
+        prev = &queue_slot[*prev].next;
+    }
+
+    queue_slot[index].next = *prev;
+    *prev = index;
+}
+
+void MEMORY_CONTROLLER::bank_queue_remove(PACKET_QUEUE *queue, uint32_t channel, uint32_t index)
+{
+    DRAM_SLOT *queue_slot = slot[queue->is_WQ][channel];
+    int *prev = &bank_queue_head[queue->is_WQ][channel][queue_slot[index].rank][queue_slot[index].bank];
+
+    while (*prev != (int)index) {
+#ifdef SANITY_CHECK
+        if (*prev == -1) {
+            cerr << "[" << queue->NAME << "] " << __func__ << " index: " << index << " is not in its bank list" << endl;
+            assert(0);
+        }
+#endif
+        prev = &queue_slot[*prev].next;
+    }
+
+    *prev = queue_slot[index].next;
+    queue_slot[index].next = -1;
+}
+
 int MEMORY_CONTROLLER::check_dram_queue(PACKET_QUEUE *queue, PACKET *packet)
 {
     // search write queue
@@ -705,3 +788,29 @@ void MEMORY_CONTROLLER::increment_WQ_FULL(uint64_t address)
     uint32_t channel = dram_get_channel(address);
     WQ[channel].FULL++;
 }
+
+void MEMORY_CONTROLLER::checkpoint(CHECKPOINT &cp)
+{
+    // only the open rows are saved, the queues and bank timing start idle after a restore
+    cp.section(NAME);
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        for (uint32_t j=0; j<DRAM_RANKS; j++) {
+            for (uint32_t k=0; k<DRAM_BANKS; k++)
+                cp.io(bank_request[i][j][k].open_row);
+        }
+    }
+}
+
+void MEMORY_CONTROLLER::register_stats()
+{
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        string prefix = "DRAM.channel" + to_string(i) + ".";
+        stats_registry.add(prefix + "RQ.row_buffer_hit", &RQ[i].ROW_BUFFER_HIT);
+        stats_registry.add(prefix + "RQ.row_buffer_miss", &RQ[i].ROW_BUFFER_MISS);
+        stats_registry.add(prefix + "WQ.row_buffer_hit", &WQ[i].ROW_BUFFER_HIT);
+        stats_registry.add(prefix + "WQ.row_buffer_miss", &WQ[i].ROW_BUFFER_MISS);
+        stats_registry.add(prefix + "WQ.full", &WQ[i].FULL);
+        stats_registry.add(prefix + "dbus_cycle_congested", &dbus_cycle_congested[i]);
+    }
+    stats_registry.add("DRAM.dbus_congested", &dbus_congested[NUM_TYPES][NUM_TYPES]);
+}
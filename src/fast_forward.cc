@@ -0,0 +1,140 @@
+#include "ooo_cpu.h"
+#include "uncore.h"
+#include <chrono>
+
+FAST_FORWARD fast_forward;
+
+void FAST_FORWARD::set_functional(uint32_t cpu, uint8_t functional)
+{
+    ooo_cpu[cpu].L1I.functional = functional;
+    ooo_cpu[cpu].L1D.functional = functional;
+    ooo_cpu[cpu].L2C.functional = functional;
+    uncore.LLC.functional = functional;
+}
+
+// physical address of a virtual address, unique_vpage as in the TLB requests of the core,
+// which carry the asid only for cloudsuite traces
+static uint64_t translate(uint32_t cpu, CACHE *tlb, uint64_t va, uint64_t asid)
+{
+    uint64_t vpage = knob_cloudsuite ? (((va >> LOG2_PAGE_SIZE) << 9) | asid) : (va >> LOG2_PAGE_SIZE),
+             pa = va_to_pa(cpu, ooo_cpu[cpu].instr_unique_id, va, vpage);
+
+    tlb->functional_translate(cpu, vpage, va, pa >> LOG2_PAGE_SIZE);
+    return pa;
+}
+
+void FAST_FORWARD::instruction(uint32_t cpu, uint64_t ip, uint8_t is_branch, uint8_t branch_taken, uint64_t instr_asid, uint64_t data_asid,
+                               uint64_t *source_memory, uint32_t num_sources, uint64_t *destination_memory, uint32_t num_destinations, uint8_t train)
+{
+    O3_CPU &core = ooo_cpu[cpu];
+
+    // instruction fetch, once per cache block as the fetch of consecutive instructions
+    if ((ip >> LOG2_BLOCK_SIZE) != last_fetch_block[cpu]) {
+        last_fetch_block[cpu] = ip >> LOG2_BLOCK_SIZE;
+        core.L1I.functional_access(cpu, translate(cpu, &core.ITLB, ip, 256 + instr_asid), ip, LOAD, 0);
+    }
+
+    if (is_branch) {
+        core.predict_branch(ip);
+        core.last_branch_result(ip, branch_taken);
+    }
+
+    for (uint32_t i=0; i<num_sources; i++)
+        if (source_memory[i])
+            core.L1D.functional_access(cpu, translate(cpu, &core.DTLB, source_memory[i], data_asid), ip, LOAD, train);
+
+    for (uint32_t i=0; i<num_destinations; i++)
+        if (destination_memory[i])
+            core.L1D.functional_access(cpu, translate(cpu, &core.DTLB, destination_memory[i], data_asid), ip, RFO, train);
+}
+
+uint8_t FAST_FORWARD::end_of_trace(uint32_t cpu)
+{
+    // the trace is rewound by the reader, a trace that ends again before its first instruction never will
+    if (rewound[cpu]) {
+        cerr << "[FAST_FORWARD] no instruction could be read from " << ooo_cpu[cpu].trace_string << " after a rewind" << endl;
+        assert(0);
+    }
+    rewound[cpu] = 1;
+
+    cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << ooo_cpu[cpu].trace_string << endl;
+    return 0;
+}
+
+uint8_t FAST_FORWARD::step(uint32_t cpu, uint8_t train)
+{
+    // returns 0 instead of an instruction at the end of the trace, as the fetch of the core
+    O3_CPU &core = ooo_cpu[cpu];
+    if (knob_cloudsuite) {
+        cloudsuite_instr instr;
+        if (!core.trace_reader->read_instr(&instr))
+            return end_of_trace(cpu);
+
+        instruction(cpu, instr.ip, instr.is_branch, instr.branch_taken, instr.asid[0], instr.asid[1],
+                    instr.source_memory, NUM_INSTR_SOURCES, instr.destination_memory, NUM_INSTR_DESTINATIONS_SPARC, train);
+    } else {
+        input_instr instr;
+        if (!core.trace_reader->read_instr(&instr))
+            return end_of_trace(cpu);
+
+        instruction(cpu, instr.ip, instr.is_branch, instr.branch_taken, cpu, cpu,
+                    instr.source_memory, NUM_INSTR_SOURCES, instr.destination_memory, NUM_INSTR_DESTINATIONS, train);
+    }
+
+    instructions[cpu]++;
+    rewound[cpu] = 0;
+    return 1;
+}
+
+void FAST_FORWARD::run(uint32_t cpu, uint64_t n, uint8_t train)
+{
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+
+    // the page walks of va_to_pa must not stall the core when the detailed simulation resumes
+    uint64_t stall = stall_cycle[cpu];
+    set_functional(cpu, 1);
+
+    uint64_t done = 0;
+    while (done < n)
+        done += step(cpu, train);
+
+    set_functional(cpu, 0);
+    stall_cycle[cpu] = stall;
+
+    seconds += chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+void FAST_FORWARD::warmup(uint64_t n)
+{
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        set_functional(i, 1);
+
+    // the cores take turns one instruction at a time, so they share the LLC as in the detailed warmup
+    uint64_t done[NUM_CPUS] = {0};
+    uint8_t all_done = 0;
+    while (!all_done) {
+        all_done = 1;
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            if (done[i] < n) {
+                done[i] += step(i, 1);
+                all_done = 0;
+            }
+        }
+    }
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        set_functional(i, 0);
+        stall_cycle[i] = 0;
+    }
+
+    double warmup_seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    seconds += warmup_seconds;
+
+    cout << endl;
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        cout << "Functional warmup CPU " << i << " instructions: " << instructions[i];
+        cout << " KIPS: " << ((warmup_seconds > 0) ? (instructions[i] / warmup_seconds / 1000) : 0) << endl;
+    }
+}
@@ -5,13 +5,20 @@
 #include "uncore.h"
 #include <fstream>
 
+#ifdef COMPONENT_REGISTRY
+#include "component.h"
+#endif
+
 uint8_t warmup_complete[NUM_CPUS], 
         simulation_complete[NUM_CPUS], 
         all_warmup_complete = 0, 
         all_simulation_complete = 0,
         MAX_INSTR_DESTINATIONS = NUM_INSTR_DESTINATIONS,
         knob_cloudsuite = 0,
-        knob_low_bandwidth = 0;
+        knob_low_bandwidth = 0,
+        knob_event_driven = 0,
+        knob_functional_warmup = 0,
+        show_heartbeat = 1;
 
 uint64_t warmup_instructions     = 1000000,
          simulation_instructions = 10000000,
@@ -19,12 +26,54 @@ uint64_t warmup_instructions     = 1000000,
 
 time_t start_time;
 
+// host time of the last heartbeat of each core, for the simulation speed
+chrono::steady_clock::time_point last_heartbeat_time[NUM_CPUS];
+
+// checkpoint of the warmed-up state
+string checkpoint_save_file, checkpoint_load_file;
+
+// components picked by the knobs in a registry build
+string branch_predictor_name, l1d_prefetcher_name, l2c_prefetcher_name, llc_prefetcher_name, llc_replacement_name;
+
 // PAGE TABLE
 uint32_t PAGE_TABLE_LATENCY = 0, SWAP_LATENCY = 0;
-queue <uint64_t > page_queue;
-map <uint64_t, uint64_t> page_table, inverse_table, recent_page, unique_cl[NUM_CPUS];
+// page_table maps vpage => page_clock frame, inverse_table maps ppage => vpage
+// unique_cl maps each touched page to a bitmap of its touched cache lines
+PAGE_HASH page_table, inverse_table, unique_cl[NUM_CPUS];
+PAGE_CLOCK page_clock;
 uint64_t previous_ppage, num_adjacent_page, num_cl[NUM_CPUS], allocated_pages, num_page[NUM_CPUS], minor_fault[NUM_CPUS], major_fault[NUM_CPUS];
 
+// rand() draws of the page allocator, replayed when a checkpoint is restored
+uint64_t page_rand_draws = 0;
+
+RANDOM champsim_rand(champsim_seed);
+
+uint64_t get_next_event_cycle()
+{
+    // all cores advance in lockstep, so any core's cycle counter can be used as the reference
+    uint64_t cycle = current_core_cycle[0] + 1, next_cycle = UINT64_MAX, event_cycle;
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        event_cycle = ooo_cpu[i].get_next_event_cycle();
+        if (event_cycle < next_cycle)
+            next_cycle = event_cycle;
+        if (next_cycle <= cycle)
+            return next_cycle;
+    }
+
+    event_cycle = uncore.LLC.get_next_event_cycle();
+    if (event_cycle < next_cycle)
+        next_cycle = event_cycle;
+    if (next_cycle <= cycle)
+        return next_cycle;
+
+    event_cycle = uncore.DRAM.get_next_event_cycle();
+    if (event_cycle < next_cycle)
+        next_cycle = event_cycle;
+
+    return next_cycle;
+}
+
 void record_roi_stats(uint32_t cpu, CACHE *cache)
 {
     for (uint32_t i=0; i<NUM_TYPES; i++) {
@@ -61,6 +110,10 @@ void print_roi_stats(uint32_t cpu, CACHE *cache)
 
     cout << cache->NAME;
     cout << " METADATA ACCESS: " << setw(10) << cache->roi_access[cpu][4] << "  HIT: " << setw(10) << cache->roi_hit[cpu][4] << "  MISS: " << setw(10) << cache->roi_miss[cpu][4] << endl;
+    if (cache->roi_access[cpu][ONCHIP_METADATA]) {
+        cout << cache->NAME;
+        cout << " ONCHIP_METADATA ACCESS: " << setw(10) << cache->roi_access[cpu][ONCHIP_METADATA] << "  HIT: " << setw(10) << cache->roi_hit[cpu][ONCHIP_METADATA] << "  MISS: " << setw(10) << cache->roi_miss[cpu][ONCHIP_METADATA] << endl;
+    }
     cout << cache->NAME;
     cout << " PREFETCH  REQUESTED: " << setw(10) << cache->pf_requested << "  ISSUED: " << setw(10) << cache->pf_issued;
     cout << "  USEFUL: " << setw(10) << cache->pf_useful << "  USELESS: " << setw(10) << cache->pf_useless << endl;
@@ -92,6 +145,10 @@ void print_sim_stats(uint32_t cpu, CACHE *cache)
     cout << " WRITEBACK ACCESS: " << setw(10) << cache->sim_access[cpu][3] << "  HIT: " << setw(10) << cache->sim_hit[cpu][3] << "  MISS: " << setw(10) << cache->sim_miss[cpu][3] << endl;
     cout << cache->NAME;
     cout << " METADATA ACCESS: " << setw(10) << cache->sim_access[cpu][4] << "  HIT: " << setw(10) << cache->sim_hit[cpu][4] << "  MISS: " << setw(10) << cache->sim_miss[cpu][4] << endl;
+    if (cache->sim_access[cpu][ONCHIP_METADATA]) {
+        cout << cache->NAME;
+        cout << " ONCHIP_METADATA ACCESS: " << setw(10) << cache->sim_access[cpu][ONCHIP_METADATA] << "  HIT: " << setw(10) << cache->sim_hit[cpu][ONCHIP_METADATA] << "  MISS: " << setw(10) << cache->sim_miss[cpu][ONCHIP_METADATA] << endl;
+    }
 }
 
 void print_branch_stats()
@@ -150,6 +207,52 @@ void reset_cache_stats(uint32_t cpu, CACHE *cache)
     cache->WQ.FULL = 0;
 }
 
+// the warmed-up state of the whole system, written and read back in the same order
+void checkpoint_state(CHECKPOINT &cp)
+{
+    cp.section("ChampSim");
+    cp.check(NUM_CPUS, "number of CPUs");
+    cp.check(knob_cloudsuite, "trace format");
+    // a restored functional warmup starts the region of interest at the first retired instruction
+    cp.io(knob_functional_warmup);
+
+    cp.io(current_core_cycle);
+    cp.io(stall_cycle);
+
+    // page tables
+    page_table.checkpoint(cp);
+    inverse_table.checkpoint(cp);
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        unique_cl[i].checkpoint(cp);
+    page_clock.checkpoint(cp);
+
+    cp.io(previous_ppage);
+    cp.io(num_adjacent_page);
+    cp.io(num_cl);
+    cp.io(allocated_pages);
+    cp.io(num_page);
+    cp.io(minor_fault);
+    cp.io(major_fault);
+    champsim_rand.checkpoint(cp);
+    cp.io(page_rand_draws);
+
+    // the trace position of a core includes the instructions of a functional warmup
+    cp.io(fast_forward.instructions);
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        ooo_cpu[i].checkpoint(cp);
+
+    uncore.LLC.checkpoint(cp);
+    uncore.DRAM.checkpoint(cp);
+}
+
+void save_checkpoint()
+{
+    CHECKPOINT cp(checkpoint_save_file, CHECKPOINT_SAVE);
+    checkpoint_state(cp);
+
+    cout << "Saved checkpoint " << checkpoint_save_file << endl << endl;
+}
+
 void finish_warmup()
 {
     uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
@@ -158,6 +261,9 @@ void finish_warmup()
     elapsed_minute -= elapsed_hour*60;
     elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
 
+    // the warmup counters are reset below
+    stats_registry.snapshot("warmup");
+
     // reset core latency
     SCHEDULING_LATENCY = 6;
     EXEC_LATENCY = 1;
@@ -201,6 +307,60 @@ void finish_warmup()
         ooo_cpu[i].L2C.LATENCY  = L2C_LATENCY;
     }
     uncore.LLC.LATENCY = LLC_LATENCY;
+
+    if (checkpoint_save_file.size() && checkpoint_load_file.empty())
+        save_checkpoint();
+}
+
+void load_checkpoint()
+{
+    CHECKPOINT cp(checkpoint_load_file, CHECKPOINT_RESTORE);
+    uint8_t functional_warmup = knob_functional_warmup;
+    checkpoint_state(cp);
+    if (functional_warmup != knob_functional_warmup)
+        cout << "Checkpoint " << checkpoint_load_file << " was saved after a " << (knob_functional_warmup ? "functional" : "detailed") << " warmup, -functional_warmup is " << (knob_functional_warmup ? "set" : "ignored") << endl;
+
+    // the initialization has already drawn its own numbers, continue where the page allocator stopped
+    for (uint64_t i=0; i<page_rand_draws; i++)
+        rand();
+
+    cout << "Loaded checkpoint " << checkpoint_load_file << endl;
+    // finish_warmup() reports the elapsed time, there was no warmup to time
+    start_time = time(NULL);
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        warmup_complete[i] = 1;
+    all_warmup_complete = NUM_CPUS+1;
+    finish_warmup();
+}
+
+void select_components()
+{
+#ifdef COMPONENT_REGISTRY
+    // same defaults as ./build_champsim.sh
+    if (branch_predictor_name.empty())
+        branch_predictor_name = "bimodal";
+    if (l1d_prefetcher_name.empty())
+        l1d_prefetcher_name = "no";
+    if (l2c_prefetcher_name.empty())
+        l2c_prefetcher_name = "no";
+    if (llc_prefetcher_name.empty())
+        llc_prefetcher_name = "no";
+    if (llc_replacement_name.empty())
+        llc_replacement_name = "lru";
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        ooo_cpu[i].branch_component = branch_predictors().find(branch_predictor_name);
+        ooo_cpu[i].L1D.prefetcher_component = l1d_prefetchers().find(l1d_prefetcher_name);
+        ooo_cpu[i].L2C.prefetcher_component = l2c_prefetchers().find(l2c_prefetcher_name);
+    }
+    uncore.LLC.prefetcher_component = llc_prefetchers().find(llc_prefetcher_name);
+    uncore.LLC.replacement_component = llc_replacements().find(llc_replacement_name);
+#else
+    if (branch_predictor_name.size() || l1d_prefetcher_name.size() || l2c_prefetcher_name.size() || llc_prefetcher_name.size() || llc_replacement_name.size()) {
+        cerr << "[COMPONENT] this binary is built with fixed components, use a binary from ./build_champsim.sh registry to pick them at startup" << endl;
+        assert(0);
+    }
+#endif
 }
 
 void print_deadlock(uint32_t i)
@@ -274,7 +434,6 @@ uint64_t rotr64 (uint64_t n, unsigned int c)
     return (n>>c) | (n<<( (-c)&mask ));
 }
 
-RANDOM champsim_rand(champsim_seed);
 uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_vpage)
 {
 #ifdef SANITY_CHECK
@@ -292,67 +451,48 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
     // smart random number generator
     uint64_t random_ppage;
 
-    map <uint64_t, uint64_t>::iterator pr = page_table.begin();
-    map <uint64_t, uint64_t>::iterator ppage_check = inverse_table.begin();
+    uint64_t *frame, *ppage_check;
 
     // check unique cache line footprint
-    map <uint64_t, uint64_t>::iterator cl_check = unique_cl[cpu].find(unique_va >> LOG2_BLOCK_SIZE);
-    if (cl_check == unique_cl[cpu].end()) { // we've never seen this cache line before
-        unique_cl[cpu].insert(make_pair(unique_va >> LOG2_BLOCK_SIZE, 0));
+    uint64_t *cl_check = unique_cl[cpu].find(unique_va >> LOG2_PAGE_SIZE),
+             cl_bit = 1ull << ((unique_va >> LOG2_BLOCK_SIZE) & ((1 << (LOG2_PAGE_SIZE - LOG2_BLOCK_SIZE)) - 1));
+    if (cl_check == NULL)
+        cl_check = unique_cl[cpu].insert(unique_va >> LOG2_PAGE_SIZE, 0);
+    if ((*cl_check & cl_bit) == 0) { // we've never seen this cache line before
+        *cl_check |= cl_bit;
         num_cl[cpu]++;
     }
-    else
-        cl_check->second++;
 
-    pr = page_table.find(vpage);
-    if (pr == page_table.end()) { // no VA => PA translation found 
+    frame = page_table.find(vpage);
+    if (frame == NULL) { // no VA => PA translation found 
 
         if (allocated_pages >= DRAM_PAGES) { // not enough memory
 
-            // TODO: elaborate page replacement algorithm
-            // here, ChampSim randomly selects a page that is not recently used and we only track 32K recently accessed pages
-            uint8_t  found_NRU = 0;
-            uint64_t NRU_vpage = 0; // implement it
-            map <uint64_t, uint64_t>::iterator pr2 = recent_page.begin();
-            for (pr = page_table.begin(); pr != page_table.end(); pr++) {
+            // the clock hand picks a page that has not been referenced since its last sweep
+            uint64_t victim = page_clock.find_victim(),
+                     NRU_vpage = page_clock.vpage[victim],
+                     mapped_ppage = page_clock.ppage[victim];
 
-                NRU_vpage = pr->first;
-                if (recent_page.find(NRU_vpage) == recent_page.end()) {
-                    found_NRU = 1;
-                    break;
-                }
-            }
-#ifdef SANITY_CHECK
-            if (found_NRU == 0)
-                assert(0);
-
-            if (pr == page_table.end())
-                assert(0);
-#endif
             DP ( if (warmup_complete[cpu]) {
-            cout << "[SWAP] update page table NRU_vpage: " << hex << pr->first << " new_vpage: " << vpage << " ppage: " << pr->second << dec << endl; });
+            cout << "[SWAP] update page table NRU_vpage: " << hex << NRU_vpage << " new_vpage: " << vpage << " ppage: " << mapped_ppage << dec << endl; });
 
             // update page table with new VA => PA mapping
-            // since we cannot change the key value already inserted in a map structure, we need to erase the old node and add a new node
-            uint64_t mapped_ppage = pr->second;
-            page_table.erase(pr);
-            page_table.insert(make_pair(vpage, mapped_ppage));
+            page_table.erase(NRU_vpage);
+            page_table.insert(vpage, victim);
+            page_clock.vpage[victim] = vpage;
+            page_clock.referenced[victim] = 1;
 
             // update inverse table with new PA => VA mapping
             ppage_check = inverse_table.find(mapped_ppage);
 #ifdef SANITY_CHECK
-            if (ppage_check == inverse_table.end())
+            if (ppage_check == NULL)
                 assert(0);
 #endif
-            ppage_check->second = vpage;
+            *ppage_check = vpage;
 
             DP ( if (warmup_complete[cpu]) {
             cout << "[SWAP] update inverse table NRU_vpage: " << hex << NRU_vpage << " new_vpage: ";
-            cout << ppage_check->second << " ppage: " << ppage_check->first << dec << endl; });
-
-            // update page_queue
-            page_queue.pop();
-            page_queue.push(vpage);
+            cout << *ppage_check << " ppage: " << mapped_ppage << dec << endl; });
 
             // invalidate corresponding vpage and ppage from the cache hierarchy
             ooo_cpu[cpu].ITLB.invalidate_entry(NRU_vpage);
@@ -385,9 +525,9 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 
             while (1) { // try to find an empty physical page number
                 ppage_check = inverse_table.find(random_ppage); // check if this page can be allocated 
-                if (ppage_check != inverse_table.end()) { // random_ppage is not available
+                if (ppage_check != NULL) { // random_ppage is not available
                     DP ( if (warmup_complete[cpu]) {
-                    cout << "vpage: " << hex << ppage_check->first << " is already mapped to ppage: " << random_ppage << dec << endl; }); 
+                    cout << "vpage: " << hex << *ppage_check << " is already mapped to ppage: " << random_ppage << dec << endl; }); 
                     
                     if (num_adjacent_page > 0)
                         fragmented = 1;
@@ -405,9 +545,8 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 
             // insert translation to page tables
             //printf("Insert  num_adjacent_page: %u  vpage: %lx  ppage: %lx\n", num_adjacent_page, vpage, random_ppage);
-            page_table.insert(make_pair(vpage, random_ppage));
-            inverse_table.insert(make_pair(random_ppage, vpage));
-            page_queue.push(vpage);
+            page_table.insert(vpage, page_clock.add_frame(vpage, random_ppage));
+            inverse_table.insert(random_ppage, vpage);
             previous_ppage = random_ppage;
             num_adjacent_page--;
             num_page[cpu]++;
@@ -416,6 +555,7 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
             // try to allocate pages contiguously
             if (fragmented) {
                 num_adjacent_page = 1 << (rand() % 10);
+                page_rand_draws++;
                 DP ( if (warmup_complete[cpu]) {
                 cout << "Recalculate num_adjacent_page: " << num_adjacent_page << endl; });
             }
@@ -430,12 +570,13 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
         //printf("Found  vpage: %lx  random_ppage: %lx\n", vpage, pr->second);
     }
 
-    pr = page_table.find(vpage);
+    frame = page_table.find(vpage);
 #ifdef SANITY_CHECK
-    if (pr == page_table.end())
+    if (frame == NULL)
         assert(0);
 #endif
-    uint64_t ppage = pr->second;
+    page_clock.referenced[*frame] = 1;
+    uint64_t ppage = page_clock.ppage[*frame];
 
     uint64_t pa = ppage << LOG2_PAGE_SIZE;
     pa |= voffset;
@@ -454,6 +595,140 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
     return pa;
 }
 
+// one cycle of the private pipeline and caches of a core
+void operate_core(uint32_t i)
+{
+    // proceed one cycle
+    current_core_cycle[i]++;
+
+    //cout << "Trying to process instr_id: " << ooo_cpu[i].instr_unique_id << " fetch_stall: " << +ooo_cpu[i].fetch_stall;
+    //cout << " stall_cycle: " << stall_cycle[i] << " current: " << current_core_cycle[i] << endl;
+
+    // core might be stalled due to page fault or branch misprediction
+    if (stall_cycle[i] <= current_core_cycle[i]) {
+
+        // fetch unit
+        if (ooo_cpu[i].ROB.occupancy < ooo_cpu[i].ROB.SIZE) {
+            // handle branch
+            if (ooo_cpu[i].fetch_stall == 0) 
+                PROFILE_CALL(i, PROFILE_HANDLE_BRANCH, ooo_cpu[i].handle_branch());
+        }
+
+        // fetch
+        PROFILE_CALL(i, PROFILE_FETCH, ooo_cpu[i].fetch_instruction());
+
+
+        // schedule (including decode latency)
+        uint32_t schedule_index = ooo_cpu[i].ROB.next_schedule;
+        if ((ooo_cpu[i].ROB.entry[schedule_index].scheduled == 0) && (ooo_cpu[i].ROB.entry[schedule_index].event_cycle <= current_core_cycle[i]))
+            PROFILE_CALL(i, PROFILE_SCHEDULE, ooo_cpu[i].schedule_instruction());
+
+        // execute
+        PROFILE_CALL(i, PROFILE_EXECUTE, ooo_cpu[i].execute_instruction());
+
+        // memory operation
+        PROFILE_CALL(i, PROFILE_SCHEDULE_MEMORY, ooo_cpu[i].schedule_memory_instruction());
+        ooo_cpu[i].execute_memory_instruction();
+
+        // complete 
+        PROFILE_CALL(i, PROFILE_UPDATE_ROB, ooo_cpu[i].update_rob());
+
+        // retire
+        if ((ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].executed == COMPLETED) && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle <= current_core_cycle[i]))
+            PROFILE_CALL(i, PROFILE_RETIRE, ooo_cpu[i].retire_rob());
+    }
+}
+
+// heartbeat, deadlock, warmup and completion checks of a core after its cycle
+void check_core(uint32_t i)
+{
+    // heartbeat information
+    if (show_heartbeat && (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction)) {
+        uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
+                 elapsed_minute = elapsed_second / 60,
+                 elapsed_hour = elapsed_minute / 60;
+        elapsed_minute -= elapsed_hour*60;
+        elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
+
+        float cumulative_ipc;
+        if (warmup_complete[i])
+            cumulative_ipc = (1.0*(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr)) / (current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle);
+        else
+            cumulative_ipc = (1.0*ooo_cpu[i].num_retired) / current_core_cycle[i];
+        float heartbeat_ipc = (1.0*ooo_cpu[i].num_retired - ooo_cpu[i].last_sim_instr) / (current_core_cycle[i] - ooo_cpu[i].last_sim_cycle);
+
+        // simulated instructions per host second since the last heartbeat
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        double heartbeat_seconds = chrono::duration<double>(now - last_heartbeat_time[i]).count();
+        float heartbeat_kips = (heartbeat_seconds > 0) ? ((ooo_cpu[i].num_retired - ooo_cpu[i].last_sim_instr) / heartbeat_seconds / 1000) : 0;
+        last_heartbeat_time[i] = now;
+
+        cout << "Heartbeat CPU " << i << " instructions: " << ooo_cpu[i].num_retired << " cycles: " << current_core_cycle[i];
+        cout << " heartbeat IPC: " << heartbeat_ipc << " cumulative IPC: " << cumulative_ipc; 
+        cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
+        // on a line of its own, scripts parse the heartbeat line
+        cout << "Simulation speed CPU " << i << " KIPS: " << heartbeat_kips << endl;
+        ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
+
+        ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
+        ooo_cpu[i].last_sim_cycle = current_core_cycle[i];
+    }
+
+    // check for deadlock
+    if (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].ip && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle + DEADLOCK_CYCLE) <= current_core_cycle[i])
+        print_deadlock(i);
+
+    // check for warmup
+    // warmup complete
+    if ((warmup_complete[i] == 0) && (ooo_cpu[i].num_retired > warmup_instructions)) {
+        warmup_complete[i] = 1;
+        all_warmup_complete++;
+    }
+    if ((all_warmup_complete == NUM_CPUS) && !core_scheduler.defer_warmup()) { // this part is called only once when all cores are warmed up
+        all_warmup_complete++;
+        finish_warmup();
+    }
+
+    /*
+    if (all_warmup_complete == 0) { 
+        all_warmup_complete = 1;
+        finish_warmup();
+    }
+    if (ooo_cpu[1].num_retired > 0)
+        warmup_complete[1] = 1;
+    */
+    
+    // simulation complete
+    if ((all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions)))
+        complete_simulation(i);
+}
+
+// the region of interest of a core ends, also called by the sampler after its last interval
+void complete_simulation(uint32_t i)
+{
+    simulation_complete[i] = 1;
+
+    uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
+             elapsed_minute = elapsed_second / 60,
+             elapsed_hour = elapsed_minute / 60;
+    elapsed_minute -= elapsed_hour*60;
+    elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
+
+    ooo_cpu[i].finish_sim_instr = ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr;
+    ooo_cpu[i].finish_sim_cycle = current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle;
+
+    cout << "Finished CPU " << i << " instructions: " << ooo_cpu[i].finish_sim_instr << " cycles: " << ooo_cpu[i].finish_sim_cycle;
+    cout << " cumulative IPC: " << ((float) ooo_cpu[i].finish_sim_instr / ooo_cpu[i].finish_sim_cycle);
+    cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
+
+    record_roi_stats(i, &ooo_cpu[i].L1D);
+    record_roi_stats(i, &ooo_cpu[i].L1I);
+    record_roi_stats(i, &ooo_cpu[i].L2C);
+    record_roi_stats(i, &uncore.LLC);
+
+    all_simulation_complete++;
+}
+
 int main(int argc, char** argv)
 {
 	// interrupt signal hanlder
@@ -466,8 +741,6 @@ int main(int argc, char** argv)
     cout << endl << "*** ChampSim Multicore Out-of-Order Simulator ***" << endl << endl;
 
     // initialize knobs
-    uint8_t show_heartbeat = 1;
-
     uint32_t seed_number = 0;
 
     // check to see if knobs changed using getopt_long()
@@ -480,6 +753,26 @@ int main(int argc, char** argv)
             {"hide_heartbeat", no_argument, 0, 'h'},
             {"cloudsuite", no_argument, 0, 'c'},
             {"low_bandwidth",  no_argument, 0, 'b'},
+            {"event_driven",  no_argument, 0, 'e'},
+            {"threads",  no_argument, 0, 'p'},
+            {"deterministic",  no_argument, 0, 'd'},
+            {"quantum", required_argument, 0, 'q'},
+            {"save_checkpoint", required_argument, 0, 'v'},
+            {"load_checkpoint", required_argument, 0, 'l'},
+            {"branch_predictor", required_argument, 0, 'B'},
+            {"l1d_prefetcher", required_argument, 0, '1'},
+            {"l2c_prefetcher", required_argument, 0, '2'},
+            {"llc_prefetcher", required_argument, 0, '3'},
+            {"llc_replacement", required_argument, 0, 'R'},
+            {"sweep", required_argument, 0, 'S'},
+            {"sweep_output", required_argument, 0, 'O'},
+            {"stats_file", required_argument, 0, 'J'},
+            {"stats_interval", required_argument, 0, 'N'},
+            {"record_stream", required_argument, 0, 'W'},
+            {"bench_stream", required_argument, 0, 'P'},
+            {"simpoints", required_argument, 0, 'I'},
+            {"train_prefetchers", no_argument, 0, 'T'},
+            {"functional_warmup", no_argument, 0, 'F'},
             {"traces",  no_argument, 0, 't'},
             {0, 0, 0, 0}      
         };
@@ -511,6 +804,66 @@ int main(int argc, char** argv)
             case 'b':
                 knob_low_bandwidth = 1;
                 break;
+            case 'e':
+                knob_event_driven = 1;
+                break;
+            case 'p':
+                core_scheduler.enabled = 1;
+                break;
+            case 'd':
+                core_scheduler.deterministic = 1;
+                break;
+            case 'q':
+                core_scheduler.quantum = atol(optarg);
+                break;
+            case 'v':
+                checkpoint_save_file = optarg;
+                break;
+            case 'l':
+                checkpoint_load_file = optarg;
+                break;
+            case 'B':
+                branch_predictor_name = optarg;
+                break;
+            case '1':
+                l1d_prefetcher_name = optarg;
+                break;
+            case '2':
+                l2c_prefetcher_name = optarg;
+                break;
+            case '3':
+                llc_prefetcher_name = optarg;
+                break;
+            case 'R':
+                llc_replacement_name = optarg;
+                break;
+            case 'S':
+                sweep.parse(optarg);
+                break;
+            case 'O':
+                sweep.output = optarg;
+                break;
+            case 'J':
+                stats_registry.file = optarg;
+                break;
+            case 'N':
+                stats_registry.interval = atol(optarg);
+                break;
+            case 'W':
+                prefetcher_bench.record_file = optarg;
+                break;
+            case 'P':
+                prefetcher_bench.stream_file = optarg;
+                break;
+            case 'I':
+                sampler.file = optarg;
+                break;
+            case 'T':
+                fast_forward.train_prefetchers = 1;
+                break;
+            case 'F':
+                knob_functional_warmup = 1;
+                break;
             case 't':
                 traces_encountered = 1;
                 break;
@@ -522,11 +875,70 @@ int main(int argc, char** argv)
             break;
     }
 
+    // one child process per L2C prefetcher of the sweep, the parent only decodes the traces
+    if (sweep.enabled()) {
+        sweep.start(knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr));
+        if (!sweep.decoder()) {
+            l2c_prefetcher_name = sweep.configs[sweep.config];
+            if (checkpoint_save_file.size())
+                checkpoint_save_file += "." + l2c_prefetcher_name;
+            if (checkpoint_load_file.size())
+                checkpoint_load_file += "." + l2c_prefetcher_name;
+            if (stats_registry.file.size())
+                stats_registry.file += "." + l2c_prefetcher_name;
+        }
+    }
+
+    // point the cores and caches at the components picked by the knobs
+    select_components();
+
     // consequences of knobs
     cout << "Warmup Instructions: " << warmup_instructions << endl;
     cout << "Simulation Instructions: " << simulation_instructions << endl;
     //cout << "Scramble Loads: " << (knob_scramble_loads ? "ture" : "false") << endl;
     cout << "Number of CPUs: " << NUM_CPUS << endl;
+    cout << "Event-driven Simulation: " << (knob_event_driven ? "on" : "off") << endl;
+    cout << "Threaded Simulation: ";
+    if (core_scheduler.enabled == 0)
+        cout << "off" << endl;
+    else if (core_scheduler.deterministic)
+        cout << "on (deterministic)" << endl;
+    else
+        cout << "on (quantum: " << core_scheduler.quantum << " cycles)" << endl;
+    if (checkpoint_load_file.size())
+        cout << "Warmup: restored from " << checkpoint_load_file << endl;
+    else if (knob_functional_warmup)
+        cout << "Warmup: functional (TLBs, caches, branch predictor and prefetchers only)" << endl;
+    if (sampler.enabled()) {
+        if (knob_functional_warmup) {
+            cerr << "[SAMPLER] the warmup before each interval is detailed, -functional_warmup cannot be used with -simpoints" << endl;
+            assert(0);
+        }
+        if ((NUM_CPUS > 1) || core_scheduler.enabled || checkpoint_load_file.size() || checkpoint_save_file.size()) {
+            cerr << "[SAMPLER] sampled simulation needs a single core without -threads and checkpoints" << endl;
+            assert(0);
+        }
+        cout << "Sampling: " << sampler.file << ", functional fast-forward " << (fast_forward.train_prefetchers ? "with" : "without") << " prefetcher training" << endl;
+    }
+    if (stats_registry.enabled()) {
+        cout << "Statistics: " << stats_registry.file;
+        if (stats_registry.interval)
+            cout << " every " << stats_registry.interval << " instructions";
+        cout << endl;
+    }
+#ifdef COMPONENT_REGISTRY
+    cout << "Branch Predictor: " << branch_predictor_name << endl;
+    cout << "L1D Prefetcher: " << l1d_prefetcher_name << endl;
+    if (sweep.decoder()) {
+        cout << "L2C Prefetcher: sweep of";
+        for (uint32_t i=0; i<sweep.configs.size(); i++)
+            cout << " " << sweep.configs[i];
+        cout << endl;
+    } else
+        cout << "L2C Prefetcher: " << l2c_prefetcher_name << endl;
+    cout << "LLC Prefetcher: " << llc_prefetcher_name << endl;
+    cout << "LLC Replacement: " << llc_replacement_name << endl;
+#endif
     cout << "LLC sets: " << LLC_SET << endl;
     cout << "LLC ways: " << LLC_WAY << endl;
 
@@ -575,10 +987,11 @@ int main(int argc, char** argv)
 			}
 				
 
+            uint8_t trace_format;
             if (full_name[last_dot - full_name + 1] == 'g') // gzip format
-                sprintf(ooo_cpu[count_traces].gunzip_command, "gunzip -c %s", argv[i]);
+                trace_format = TRACE_GZ;
             else if (full_name[last_dot - full_name + 1] == 'x') // xz
-                sprintf(ooo_cpu[count_traces].gunzip_command, "xz -dc %s", argv[i]);
+                trace_format = TRACE_XZ;
             else {
                 cout << "ChampSim does not support traces other than gz or xz compression!" << endl; 
                 assert(0);
@@ -603,11 +1016,12 @@ int main(int argc, char** argv)
                 j++;
             }
 
-            ooo_cpu[count_traces].trace_file = popen(ooo_cpu[count_traces].gunzip_command, "r");
-            if (ooo_cpu[count_traces].trace_file == NULL) {
-                printf("\n*** Trace file not found: %s ***\n\n", argv[i]);
-                assert(0);
-            }
+            // decompress in-process on a separate thread
+            size_t instr_size = knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
+            if (sweep.enabled())
+                ooo_cpu[count_traces].trace_reader = sweep.open_trace(ooo_cpu[count_traces].trace_string, instr_size, trace_format, count_traces);
+            else
+                ooo_cpu[count_traces].trace_reader = new TRACE_READER(ooo_cpu[count_traces].trace_string, instr_size, trace_format);
 
             count_traces++;
             if (count_traces > NUM_CPUS) {
@@ -620,12 +1034,16 @@ int main(int argc, char** argv)
         }
     }
 
-    if (count_traces != NUM_CPUS) {
+    if ((count_traces != NUM_CPUS) && !prefetcher_bench.enabled()) {
         printf("\n*** Not enough traces for the configured number of cores ***\n\n");
         assert(0);
     }
     // end trace file setup
 
+    // the parent of a sweep decodes the traces until every simulation has finished
+    if (sweep.decoder())
+        sweep.run();
+
     // TODO: can we initialize these variables from the class constructor?
     srand(seed_number);
     champsim_seed = seed_number;
@@ -719,127 +1137,102 @@ int main(int argc, char** argv)
     uncore.LLC.llc_initialize_replacement();
     uncore.LLC.llc_prefetcher_initialize();
 
-    // simulation entry point
-    start_time = time(NULL);
-    uint8_t run_simulation = 1;
-    while (run_simulation) {
-
-        uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
-                 elapsed_minute = elapsed_second / 60,
-                 elapsed_hour = elapsed_minute / 60;
-        elapsed_minute -= elapsed_hour*60;
-        elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
-
-        for (int i=0; i<NUM_CPUS; i++) {
-            // proceed one cycle
-            current_core_cycle[i]++;
-
-            //cout << "Trying to process instr_id: " << ooo_cpu[i].instr_unique_id << " fetch_stall: " << +ooo_cpu[i].fetch_stall;
-            //cout << " stall_cycle: " << stall_cycle[i] << " current: " << current_core_cycle[i] << endl;
-
-            // core might be stalled due to page fault or branch misprediction
-            if (stall_cycle[i] <= current_core_cycle[i]) {
-
-                // fetch unit
-                if (ooo_cpu[i].ROB.occupancy < ooo_cpu[i].ROB.SIZE) {
-                    // handle branch
-                    if (ooo_cpu[i].fetch_stall == 0) 
-                        ooo_cpu[i].handle_branch();
-                }
-
-                // fetch
-                ooo_cpu[i].fetch_instruction();
-
+    // the prefetchers have registered their counters in their initialize hooks
+    for (int i=0; i<NUM_CPUS; i++)
+        ooo_cpu[i].register_stats();
+    uncore.LLC.register_stats();
+    uncore.DRAM.register_stats();
+    stats_registry.open();
+
+    // replay a recorded stream through the L2C prefetcher instead of simulating the traces
+    if (prefetcher_bench.enabled()) {
+        prefetcher_bench.run(&ooo_cpu[0].L2C);
+        return 0;
+    }
+    prefetcher_bench.open_record();
+
+    // start the simulation from a warmed-up state instead of running the warmup
+    if (checkpoint_load_file.size())
+        load_checkpoint();
+
+    // warm up the TLBs, caches, branch predictors and prefetchers without the out-of-order model,
+    // the detailed simulation starts with the region of interest, also when it is restored from a checkpoint of it
+    if (knob_functional_warmup) {
+        if (checkpoint_load_file.empty())
+            fast_forward.warmup(warmup_instructions);
+        warmup_instructions = 0;
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            ooo_cpu[i].warmup_instructions = 0;
+            ooo_cpu[i].begin_sim_instr = 0;
+        }
+    }
 
-                // schedule (including decode latency)
-                uint32_t schedule_index = ooo_cpu[i].ROB.next_schedule;
-                if ((ooo_cpu[i].ROB.entry[schedule_index].scheduled == 0) && (ooo_cpu[i].ROB.entry[schedule_index].event_cycle <= current_core_cycle[i]))
-                    ooo_cpu[i].schedule_instruction();
+    // fast-forward to the first interval of a sampled simulation
+    if (sampler.enabled()) {
+        sampler.start(warmup_instructions);
+        warmup_instructions = 0;
+    }
 
-                // execute
-                ooo_cpu[i].execute_instruction();
+#ifdef HOST_PROFILE
+    host_profile.begin();
+#endif
 
-                // memory operation
-                ooo_cpu[i].schedule_memory_instruction();
-                ooo_cpu[i].execute_memory_instruction();
+    // one host thread per core
+    if (core_scheduler.enabled)
+        core_scheduler.start();
 
-                // complete 
-                ooo_cpu[i].update_rob();
+    // simulation entry point
+    start_time = time(NULL);
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        last_heartbeat_time[i] = chrono::steady_clock::now();
+    uint8_t run_simulation = 1;
+    while (run_simulation) {
 
-                // retire
-                if ((ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].executed == COMPLETED) && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle <= current_core_cycle[i]))
-                    ooo_cpu[i].retire_rob();
+        // skip the cycles in which no core, cache, or DRAM can make any progress
+        if (knob_event_driven) {
+            uint64_t next_cycle = get_next_event_cycle();
+            if ((next_cycle != UINT64_MAX) && (next_cycle > (current_core_cycle[0] + 1))) {
+                uint64_t skipped_cycles = next_cycle - (current_core_cycle[0] + 1);
+                for (int i=0; i<NUM_CPUS; i++)
+                    current_core_cycle[i] += skipped_cycles;
             }
+        }
 
-            // heartbeat information
-            if (show_heartbeat && (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction)) {
-                float cumulative_ipc;
-                if (warmup_complete[i])
-                    cumulative_ipc = (1.0*(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr)) / (current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle);
-                else
-                    cumulative_ipc = (1.0*ooo_cpu[i].num_retired) / current_core_cycle[i];
-                float heartbeat_ipc = (1.0*ooo_cpu[i].num_retired - ooo_cpu[i].last_sim_instr) / (current_core_cycle[i] - ooo_cpu[i].last_sim_cycle);
-
-                cout << "Heartbeat CPU " << i << " instructions: " << ooo_cpu[i].num_retired << " cycles: " << current_core_cycle[i];
-                cout << " heartbeat IPC: " << heartbeat_ipc << " cumulative IPC: " << cumulative_ipc; 
-                cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
-                ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
-
-                ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
-                ooo_cpu[i].last_sim_cycle = current_core_cycle[i];
+        if (core_scheduler.enabled)
+            core_scheduler.run_quantum();
+        else {
+            for (int i=0; i<NUM_CPUS; i++) {
+                operate_core(i);
+                check_core(i);
             }
 
-            // check for deadlock
-            if (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].ip && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle + DEADLOCK_CYCLE) <= current_core_cycle[i])
-                print_deadlock(i);
-
-            // check for warmup
-            // warmup complete
-            if ((warmup_complete[i] == 0) && (ooo_cpu[i].num_retired > warmup_instructions)) {
-                warmup_complete[i] = 1;
-                all_warmup_complete++;
-            }
-            if (all_warmup_complete == NUM_CPUS) { // this part is called only once when all cores are warmed up
-                all_warmup_complete++;
-                finish_warmup();
-            }
+            // top-down like the caches of a core, DRAM sees what the LLC sent in the same cycle
+            uncore.LLC.operate();
+            uncore.DRAM.operate();
 
-            /*
-            if (all_warmup_complete == 0) { 
-                all_warmup_complete = 1;
-                finish_warmup();
-            }
-            if (ooo_cpu[1].num_retired > 0)
-                warmup_complete[1] = 1;
-            */
-            
-            // simulation complete
-            if ((all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions))) {
-                simulation_complete[i] = 1;
-                ooo_cpu[i].finish_sim_instr = ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr;
-                ooo_cpu[i].finish_sim_cycle = current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle;
-
-                cout << "Finished CPU " << i << " instructions: " << ooo_cpu[i].finish_sim_instr << " cycles: " << ooo_cpu[i].finish_sim_cycle;
-                cout << " cumulative IPC: " << ((float) ooo_cpu[i].finish_sim_instr / ooo_cpu[i].finish_sim_cycle);
-                cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
-
-                record_roi_stats(i, &ooo_cpu[i].L1D);
-                record_roi_stats(i, &ooo_cpu[i].L1I);
-                record_roi_stats(i, &ooo_cpu[i].L2C);
-                record_roi_stats(i, &uncore.LLC);
-
-                all_simulation_complete++;
-            }
+            if (sampler.enabled())
+                sampler.check();
+        }
 
-            if (all_simulation_complete == NUM_CPUS)
-                run_simulation = 0;
+        // cores that run ahead of the uncore finish the warmup at the end of a quantum
+        if (all_warmup_complete == NUM_CPUS) {
+            all_warmup_complete++;
+            finish_warmup();
         }
 
-        // TODO: should it be backward?
-        uncore.LLC.operate();
-        uncore.DRAM.operate();
+        if (stats_registry.interval)
+            stats_registry.check_interval();
+
+        if (all_simulation_complete == NUM_CPUS)
+            run_simulation = 0;
     }
 
+    if (core_scheduler.enabled)
+        core_scheduler.finish();
+
+    if (sweep.enabled())
+        sweep.finish();
+
 #ifndef CRC2_COMPILE
     print_branch_stats();
 #endif
@@ -889,8 +1282,20 @@ int main(int argc, char** argv)
 
 #ifndef CRC2_COMPILE
     uncore.LLC.llc_replacement_final_stats();
+    uncore.LLC.print_partition_stats();
     print_dram_stats();
 #endif
 
+    if (sampler.enabled())
+        sampler.print();
+
+#ifdef HOST_PROFILE
+    host_profile.print();
+#endif
+
+    stats_registry.snapshot("final");
+    stats_registry.close();
+    prefetcher_bench.close_record();
+
     return 0;
 }
@@ -24,20 +24,14 @@ void O3_CPU::handle_branch()
     // first, read PIN trace
     while (continue_reading) {
 
-        size_t instr_size = knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
-
         if (knob_cloudsuite) {
-            if (!fread(&current_cloudsuite_instr, instr_size, 1, trace_file)) {
+            if (!trace_reader->read_instr(&current_cloudsuite_instr)) {
                 // reached end of file for this trace
+                core_scheduler.enter_shared(cpu);
                 cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
+                core_scheduler.leave_shared(cpu);
 
-                // close the trace file and re-open it
-                pclose(trace_file);
-                trace_file = popen(gunzip_command, "r");
-                if (trace_file == NULL) {
-                    cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << trace_string << " ***" << endl;
-                    assert(0);
-                }
+                // the trace reader has already rewound, the next read starts over
             } else { // successfully read the trace
 
                 // copy the instruction into the performance model's instruction format
@@ -156,17 +150,13 @@ void O3_CPU::handle_branch()
                 instr_unique_id++;
             }
         } else {
-            if (!fread(&current_instr, instr_size, 1, trace_file)) {
+            if (!trace_reader->read_instr(&current_instr)) {
                 // reached end of file for this trace
+                core_scheduler.enter_shared(cpu);
                 cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
+                core_scheduler.leave_shared(cpu);
 
-                // close the trace file and re-open it
-                pclose(trace_file);
-                trace_file = popen(gunzip_command, "r");
-                if (trace_file == NULL) {
-                    cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << trace_string << " ***" << endl;
-                    assert(0);
-                }
+                // the trace reader has already rewound, the next read starts over
             } else { // successfully read the trace
 
                 // copy the instruction into the performance model's instruction format
@@ -303,6 +293,7 @@ uint32_t O3_CPU::add_to_rob(ooo_model_instr *arch_instr)
 
     ROB.entry[index] = *arch_instr;
     ROB.entry[index].event_cycle = current_core_cycle[cpu];
+    ROB_lookup[arch_instr->instr_id % ROB_SIZE] = index;
 
     ROB.occupancy++;
     ROB.tail++;
@@ -331,6 +322,16 @@ uint32_t O3_CPU::check_rob(uint64_t instr_id)
     if ((ROB.head == ROB.tail) && ROB.occupancy == 0)
         return ROB.SIZE;
 
+    // direct lookup, validated against the stored instr_id
+    uint32_t rob_index = ROB_lookup[instr_id % ROB_SIZE];
+    if ((rob_index < ROB.SIZE) && ROB.entry[rob_index].ip && (ROB.entry[rob_index].instr_id == instr_id)) {
+        DP ( if (warmup_complete[cpu]) {
+        cout << "[ROB] " << __func__ << " same instr_id: " << ROB.entry[rob_index].instr_id;
+        cout << " rob_index: " << rob_index << endl; });
+        return rob_index;
+    }
+
+    // fall back to searching the ROB
     if (ROB.head < ROB.tail) {
         for (uint32_t i=ROB.head; i<ROB.tail; i++) {
             if (ROB.entry[i].instr_id == instr_id) {
@@ -403,7 +404,6 @@ void O3_CPU::fetch_instruction()
         trace_packet.full_addr = ROB.entry[read_index].ip;
         trace_packet.instr_id = ROB.entry[read_index].instr_id;
         trace_packet.rob_index = read_index;
-        trace_packet.producer = 0; // TODO: check if this guy gets used or not
         trace_packet.ip = ROB.entry[read_index].ip;
         trace_packet.type = LOAD; 
         trace_packet.asid[0] = ROB.entry[read_index].asid[0];
@@ -461,7 +461,6 @@ void O3_CPU::fetch_instruction()
         fetch_packet.full_addr = ROB.entry[fetch_index].instruction_pa;
         fetch_packet.instr_id = ROB.entry[fetch_index].instr_id;
         fetch_packet.rob_index = fetch_index;
-        fetch_packet.producer = 0;
         fetch_packet.ip = ROB.entry[fetch_index].ip;
         fetch_packet.type = LOAD; 
         fetch_packet.asid[0] = ROB.entry[fetch_index].asid[0];
@@ -723,6 +722,7 @@ void O3_CPU::do_execution(uint32_t rob_index)
             ROB.entry[rob_index].event_cycle += EXEC_LATENCY;
 
         inflight_reg_executions++;
+        add_completion_candidate(rob_index);
 
         DP (if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " non-memory instr_id: " << ROB.entry[rob_index].instr_id; 
@@ -779,7 +779,7 @@ void O3_CPU::schedule_memory_instruction()
 
 void O3_CPU::execute_memory_instruction()
 {
-    operate_lsq();
+    PROFILE_CALL(cpu, PROFILE_OPERATE_LSQ, operate_lsq());
     operate_cache();
 }
 
@@ -788,8 +788,10 @@ void O3_CPU::do_memory_scheduling(uint32_t rob_index)
     uint32_t not_available = check_and_add_lsq(rob_index);
     if (not_available == 0) {
         ROB.entry[rob_index].scheduled = COMPLETED;
-        if (ROB.entry[rob_index].executed == 0) // it could be already set to COMPLETED due to store-to-load forwarding
+        if (ROB.entry[rob_index].executed == 0) { // it could be already set to COMPLETED due to store-to-load forwarding
             ROB.entry[rob_index].executed  = INFLIGHT;
+            add_completion_candidate(rob_index);
+        }
 
         DP (if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[rob_index].instr_id << " rob_index: " << rob_index;
@@ -974,8 +976,10 @@ void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
                 cerr << "instr_id: " << ROB.entry[fwr_rob_index].instr_id << endl;
                 assert(0);
             }
-            if (ROB.entry[fwr_rob_index].num_mem_ops == 0)
+            if (ROB.entry[fwr_rob_index].num_mem_ops == 0) {
                 inflight_mem_executions++;
+                add_completion_candidate(fwr_rob_index);
+            }
 
             DP(if(warmup_complete[cpu]) {
             cout << "[LQ] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << hex;
@@ -1274,8 +1278,10 @@ void O3_CPU::execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_
         cerr << "instr_id: " << ROB.entry[rob_index].instr_id << endl;
         assert(0);
     }
-    if (ROB.entry[rob_index].num_mem_ops == 0)
+    if (ROB.entry[rob_index].num_mem_ops == 0) {
         inflight_mem_executions++;
+        add_completion_candidate(rob_index);
+    }
 
     DP (if (warmup_complete[cpu]) {
     cout << "[SQ1] " << __func__ << " instr_id: " << SQ.entry[sq_index].instr_id << hex;
@@ -1317,8 +1323,10 @@ void O3_CPU::execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_
                             assert(0);
                         }
 #endif
-                        if (ROB.entry[fwr_rob_index].num_mem_ops == 0)
+                        if (ROB.entry[fwr_rob_index].num_mem_ops == 0) {
                             inflight_mem_executions++;
+                            add_completion_candidate(fwr_rob_index);
+                        }
 
                         DP(if(warmup_complete[cpu]) {
                         cout << "[LQ3] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << hex;
@@ -1408,6 +1416,38 @@ void O3_CPU::complete_execution(uint32_t rob_index)
     }
 }
 
+void O3_CPU::add_completion_candidate(uint32_t rob_index)
+{
+    // the entry is woken up once its execution is in flight and all of its memory operations are done
+    if (ROB.entry[rob_index].executed != INFLIGHT)
+        return;
+    if (ROB.entry[rob_index].is_memory && ROB.entry[rob_index].num_mem_ops)
+        return;
+
+    ROB_completion[rob_index >> 6] |= 1ull << (rob_index & 63);
+}
+
+void O3_CPU::complete_executions(uint32_t begin, uint32_t end)
+{
+    // visit the woken up entries in ROB order, so dependents are released in the same order as a full ROB sweep
+    for (uint32_t word = begin >> 6; (word << 6) < end; word++) {
+        uint64_t bits = ROB_completion[word];
+        if ((word << 6) < begin)
+            bits &= ~0ull << (begin & 63);
+        if (((word + 1) << 6) > end)
+            bits &= (1ull << (end & 63)) - 1;
+
+        while (bits) {
+            uint32_t rob_index = (word << 6) + __builtin_ctzll(bits);
+            bits &= bits - 1;
+
+            complete_execution(rob_index);
+            if (ROB.entry[rob_index].executed == COMPLETED)
+                ROB_completion[word] &= ~(1ull << (rob_index & 63));
+        }
+    }
+}
+
 void O3_CPU::reg_RAW_release(uint32_t rob_index)
 {
     // if (!ROB.entry[rob_index].registers_instrs_depend_on_me.empty()) 
@@ -1457,6 +1497,8 @@ void O3_CPU::operate_cache()
     STLB.operate();
     L1I.operate();
     L1D.operate();
+
+    // the L2C enters the shared section itself around its LLC accesses
     L2C.operate();
 }
 
@@ -1476,17 +1518,185 @@ void O3_CPU::update_rob()
 
     // update ROB entries with completed executions
     if ((inflight_reg_executions > 0) || (inflight_mem_executions > 0)) {
-        if (ROB.head < ROB.tail) {
-            for (uint32_t i=ROB.head; i<ROB.tail; i++) 
-                complete_execution(i);
+        if (ROB.head < ROB.tail)
+            complete_executions(ROB.head, ROB.tail);
+        else {
+            complete_executions(ROB.head, ROB.SIZE);
+            complete_executions(0, ROB.tail);
         }
+    }
+}
+
+uint8_t O3_CPU::can_add_lsq(uint32_t rob_index)
+{
+    // same conditions as check_and_add_lsq() without modifying the LSQ
+    uint8_t all_added = 1;
+
+    for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+        if (ROB.entry[rob_index].source_memory[i] && (ROB.entry[rob_index].source_added[i] == 0)) {
+            all_added = 0;
+            if (LQ.occupancy < LQ.SIZE)
+                return 1;
+        }
+    }
+
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[rob_index].destination_memory[i] && (ROB.entry[rob_index].destination_added[i] == 0)) {
+            all_added = 0;
+            if ((SQ.occupancy < SQ.SIZE) && (STA[STA_head] == ROB.entry[rob_index].instr_id))
+                return 1;
+        }
+    }
+
+    return all_added;
+}
+
+uint64_t O3_CPU::get_memory_scheduling_cycle(uint32_t begin, uint32_t end, uint32_t &searched)
+{
+    // walk the same range as schedule_memory_instruction()
+    uint64_t cycle = current_core_cycle[cpu] + 1;
+    for (uint32_t i=begin; i<end; i++) {
+
+        if (ROB.entry[i].is_memory == 0)
+            continue;
+
+        if ((ROB.entry[i].fetched != COMPLETED) || (searched >= SCHEDULER_SIZE))
+            break;
+
+        if (ROB.entry[i].event_cycle > cycle)
+            return ROB.entry[i].event_cycle;
+
+        if (ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT)) {
+            if (can_add_lsq(i))
+                return 0;
+            searched++;
+        }
+    }
+
+    return UINT64_MAX;
+}
+
+uint64_t O3_CPU::get_next_event_cycle()
+{
+    // earliest cycle at which this core or its private caches can change any state
+    // returns as soon as something is found to be ready in the next cycle
+    uint64_t cycle = current_core_cycle[cpu] + 1, next_cycle = UINT64_MAX, event_cycle;
+
+    // deadlock check
+    if (ROB.entry[ROB.head].ip)
+        next_cycle = ROB.entry[ROB.head].event_cycle + DEADLOCK_CYCLE;
+
+    // nothing in the core runs until the page fault is handled
+    if (stall_cycle[cpu] > cycle)
+        return (stall_cycle[cpu] < next_cycle) ? stall_cycle[cpu] : next_cycle;
+
+    // read the trace
+    if ((ROB.occupancy < ROB.SIZE) && (fetch_stall == 0))
+        return 0;
+
+    // instruction translation
+    uint32_t read_index = (ROB.last_read == (ROB.SIZE-1)) ? 0 : (ROB.last_read + 1);
+#ifdef SANITY_CHECK
+    if (ROB.entry[read_index].ip && (ROB.entry[read_index].translated == 0))
+#else
+    if (ROB.entry[read_index].ip)
+#endif
+        return 0;
+
+    // retire
+    if ((ROB.entry[ROB.head].executed == COMPLETED) && (ROB.entry[ROB.head].event_cycle < next_cycle))
+        next_cycle = ROB.entry[ROB.head].event_cycle;
+
+    // completed translations and fetches
+    PACKET_QUEUE *processed[4] = {&ITLB.PROCESSED, &L1I.PROCESSED, &DTLB.PROCESSED, &L1D.PROCESSED};
+    for (uint32_t i=0; i<4; i++) {
+        if (processed[i]->occupancy && (processed[i]->entry[processed[i]->head].event_cycle < next_cycle))
+            next_cycle = processed[i]->entry[processed[i]->head].event_cycle;
+    }
+
+    // execute
+    if ((RTE0[RTE0_head] < ROB_SIZE) && (ROB.entry[RTE0[RTE0_head]].event_cycle < next_cycle))
+        next_cycle = ROB.entry[RTE0[RTE0_head]].event_cycle;
+    if ((RTE1[RTE1_head] < ROB_SIZE) && (ROB.entry[RTE1[RTE1_head]].event_cycle < next_cycle))
+        next_cycle = ROB.entry[RTE1[RTE1_head]].event_cycle;
+
+    // load/store queue
+    if ((RTS0[RTS0_head] < SQ_SIZE) && (SQ.entry[RTS0[RTS0_head]].event_cycle < next_cycle))
+        next_cycle = SQ.entry[RTS0[RTS0_head]].event_cycle;
+    if ((RTS1[RTS1_head] < SQ_SIZE) && (SQ.entry[RTS1[RTS1_head]].event_cycle < next_cycle))
+        next_cycle = SQ.entry[RTS1[RTS1_head]].event_cycle;
+    if ((RTL0[RTL0_head] < LQ_SIZE) && (LQ.entry[RTL0[RTL0_head]].event_cycle < next_cycle))
+        next_cycle = LQ.entry[RTL0[RTL0_head]].event_cycle;
+    if ((RTL1[RTL1_head] < LQ_SIZE) && (LQ.entry[RTL1[RTL1_head]].event_cycle < next_cycle))
+        next_cycle = LQ.entry[RTL1[RTL1_head]].event_cycle;
+
+    // instruction fetch
+    uint32_t fetch_index = (ROB.last_fetch == (ROB.SIZE-1)) ? 0 : (ROB.last_fetch + 1);
+    if ((ROB.entry[fetch_index].translated == COMPLETED) && (ROB.entry[fetch_index].fetched == 0) && (ROB.entry[fetch_index].event_cycle < next_cycle))
+        next_cycle = ROB.entry[fetch_index].event_cycle;
+
+    // schedule
+    uint32_t schedule_index = ROB.next_schedule, limit = ROB.next_fetch[1];
+    if ((ROB.entry[schedule_index].scheduled == 0) && (ROB.entry[schedule_index].fetched == COMPLETED)) {
+        uint8_t in_range = (ROB.head < limit) ? ((schedule_index >= ROB.head) && (schedule_index < limit)) : ((schedule_index >= ROB.head) || (schedule_index < limit));
+        uint32_t distance = (schedule_index >= ROB.head) ? (schedule_index - ROB.head) : (ROB.SIZE - ROB.head + schedule_index);
+        if (in_range && (distance < SCHEDULER_SIZE) && (ROB.entry[schedule_index].event_cycle < next_cycle))
+            next_cycle = ROB.entry[schedule_index].event_cycle;
+    }
+
+    if (next_cycle <= cycle)
+        return next_cycle;
+
+    // private caches
+    CACHE *cache[6] = {&ITLB, &DTLB, &STLB, &L1I, &L1D, &L2C};
+    for (uint32_t i=0; i<6; i++) {
+        event_cycle = cache[i]->get_next_event_cycle();
+        if (event_cycle < next_cycle) {
+            next_cycle = event_cycle;
+            if (next_cycle <= cycle)
+                return next_cycle;
+        }
+    }
+
+    // memory scheduling
+    if (ROB.occupancy) {
+        uint32_t searched = 0;
+        limit = ROB.next_schedule;
+        if (ROB.head < limit)
+            event_cycle = get_memory_scheduling_cycle(ROB.head, limit, searched);
         else {
-            for (uint32_t i=ROB.head; i<ROB.SIZE; i++)
-                complete_execution(i);
-            for (uint32_t i=0; i<ROB.tail; i++)
-                complete_execution(i);
+            event_cycle = get_memory_scheduling_cycle(ROB.head, ROB.SIZE, searched);
+            if (event_cycle) {
+                uint64_t wrapped_cycle = get_memory_scheduling_cycle(0, limit, searched);
+                if (wrapped_cycle < event_cycle)
+                    event_cycle = wrapped_cycle;
+            }
+        }
+        if (event_cycle < next_cycle) {
+            next_cycle = event_cycle;
+            if (next_cycle <= cycle)
+                return next_cycle;
+        }
+    }
+
+    // completed executions
+    if ((inflight_reg_executions > 0) || (inflight_mem_executions > 0)) {
+        for (uint32_t word=0; word<(ROB_SIZE+63)/64; word++) {
+            uint64_t bits = ROB_completion[word];
+            while (bits) {
+                uint32_t i = (word << 6) + __builtin_ctzll(bits);
+                bits &= bits - 1;
+
+                if (ROB.entry[i].event_cycle < next_cycle) {
+                    next_cycle = ROB.entry[i].event_cycle;
+                    if (next_cycle <= cycle)
+                        return next_cycle;
+                }
+            }
         }
     }
+
+    return next_cycle;
 }
 
 void O3_CPU::complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
@@ -1518,7 +1728,7 @@ void O3_CPU::complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
 
     // check if other instructions were merged
     if (queue->entry[index].instr_merged) {
-	ITERATE_SET(i,queue->entry[index].rob_index_depend_on_me, ROB_SIZE) {
+	ITERATE_SET(i,queue->get_dependency(index).rob_index_depend_on_me, ROB_SIZE) {
             // update ROB entry
             if (is_it_tlb) {
                 ROB.entry[i].translated = COMPLETED;
@@ -1547,6 +1757,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
              rob_index = queue->entry[index].rob_index,
              sq_index = queue->entry[index].sq_index,
              lq_index = queue->entry[index].lq_index;
+    DEPENDENCY &depend_on_packet = queue->get_dependency(index);
 
 #ifdef SANITY_CHECK
     if (queue->entry[index].type != RFO) {
@@ -1574,7 +1785,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
             cout << " full_addr: " << SQ.entry[sq_index].physical_address << dec << " store_merged: " << +queue->entry[index].store_merged;
             cout << " load_merged: " << +queue->entry[index].load_merged << endl; }); 
 
-            handle_merged_translation(&queue->entry[index]);
+            handle_merged_translation(&queue->entry[index], depend_on_packet);
         }
         else { 
             LQ.entry[lq_index].physical_address = (queue->entry[index].data_pa << LOG2_PAGE_SIZE) | (LQ.entry[lq_index].virtual_address & ((1 << LOG2_PAGE_SIZE) - 1)); // translated address
@@ -1596,7 +1807,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
             cout << " full_addr: " << LQ.entry[lq_index].physical_address << dec << " store_merged: " << +queue->entry[index].store_merged;
             cout << " load_merged: " << +queue->entry[index].load_merged << endl; }); 
 
-            handle_merged_translation(&queue->entry[index]);
+            handle_merged_translation(&queue->entry[index], depend_on_packet);
         }
 
         ROB.entry[rob_index].event_cycle = queue->entry[index].event_cycle;
@@ -1604,7 +1815,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
     else { // L1D
 
         if (queue->entry[index].type == RFO)
-            handle_merged_load(&queue->entry[index]);
+            handle_merged_load(&queue->entry[index], depend_on_packet);
         else { 
 #ifdef SANITY_CHECK
             if (queue->entry[index].store_merged)
@@ -1621,8 +1832,10 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
                 assert(0);
             }
 #endif
-            if (ROB.entry[rob_index].num_mem_ops == 0)
+            if (ROB.entry[rob_index].num_mem_ops == 0) {
                 inflight_mem_executions++;
+                add_completion_candidate(rob_index);
+            }
 
             DP (if (warmup_complete[cpu]) {
             cout << "[ROB] " << __func__ << " load instr_id: " << LQ.entry[lq_index].instr_id;
@@ -1631,7 +1844,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
             cout << " load_merged: " << +queue->entry[index].load_merged << " inflight_mem: " << inflight_mem_executions << endl; }); 
 
             release_load_queue(lq_index);
-            handle_merged_load(&queue->entry[index]);
+            handle_merged_load(&queue->entry[index], depend_on_packet);
         }
     }
 
@@ -1644,6 +1857,7 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
     uint32_t rob_index = current_packet->rob_index,
              sq_index  = current_packet->sq_index,
              lq_index  = current_packet->lq_index;
+    DEPENDENCY &depend_on_packet = ((cache_type == 0) ? DTLB : L1D).depend_pool.entry[current_packet->depend_on_me];
 
     // update ROB entry
     if (cache_type == 0) { // DTLB
@@ -1667,7 +1881,7 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
             cout << " full_addr: " << SQ.entry[sq_index].physical_address << dec << " store_merged: " << +current_packet->store_merged;
             cout << " load_merged: " << +current_packet->load_merged << endl; }); 
 
-            handle_merged_translation(current_packet);
+            handle_merged_translation(current_packet, depend_on_packet);
         }
         else { 
             LQ.entry[lq_index].physical_address = (current_packet->data_pa << LOG2_PAGE_SIZE) | (LQ.entry[lq_index].virtual_address & ((1 << LOG2_PAGE_SIZE) - 1)); // translated address
@@ -1688,7 +1902,7 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
             cout << " full_addr: " << LQ.entry[lq_index].physical_address << dec << " store_merged: " << +current_packet->store_merged;
             cout << " load_merged: " << +current_packet->load_merged << endl; }); 
 
-            handle_merged_translation(current_packet);
+            handle_merged_translation(current_packet, depend_on_packet);
         }
 
         ROB.entry[rob_index].event_cycle = current_packet->event_cycle;
@@ -1696,7 +1910,7 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
     else { // L1D
 
         if (current_packet->type == RFO)
-            handle_merged_load(current_packet);
+            handle_merged_load(current_packet, depend_on_packet);
         else { // do traditional things
 #ifdef SANITY_CHECK
             if (rob_index != check_rob(current_packet->instr_id))
@@ -1714,8 +1928,10 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
                 assert(0);
             }
 #endif
-            if (ROB.entry[rob_index].num_mem_ops == 0)
+            if (ROB.entry[rob_index].num_mem_ops == 0) {
                 inflight_mem_executions++;
+                add_completion_candidate(rob_index);
+            }
 
             DP (if (warmup_complete[cpu]) {
             cout << "[ROB] " << __func__ << " load instr_id: " << LQ.entry[lq_index].instr_id;
@@ -1725,17 +1941,17 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
 
             release_load_queue(lq_index);
 
-            handle_merged_load(current_packet);
+            handle_merged_load(current_packet, depend_on_packet);
 
             ROB.entry[rob_index].event_cycle = current_packet->event_cycle;
         }
     }
 }
 
-void O3_CPU::handle_merged_translation(PACKET *provider)
+void O3_CPU::handle_merged_translation(PACKET *provider, DEPENDENCY &depend_on_provider)
 {
     if (provider->store_merged) {
-	ITERATE_SET(merged, provider->sq_index_depend_on_me, SQ.SIZE) {
+	ITERATE_SET(merged, depend_on_provider.sq_index_depend_on_me, SQ.SIZE) {
             SQ.entry[merged].translated = COMPLETED;
             SQ.entry[merged].physical_address = (provider->data_pa << LOG2_PAGE_SIZE) | (SQ.entry[merged].virtual_address & ((1 << LOG2_PAGE_SIZE) - 1)); // translated address
             SQ.entry[merged].event_cycle = current_core_cycle[cpu];
@@ -1752,7 +1968,7 @@ void O3_CPU::handle_merged_translation(PACKET *provider)
         }
     }
     if (provider->load_merged) {
-	ITERATE_SET(merged, provider->lq_index_depend_on_me, LQ.SIZE) {
+	ITERATE_SET(merged, depend_on_provider.lq_index_depend_on_me, LQ.SIZE) {
             LQ.entry[merged].translated = COMPLETED;
             LQ.entry[merged].physical_address = (provider->data_pa << LOG2_PAGE_SIZE) | (LQ.entry[merged].virtual_address & ((1 << LOG2_PAGE_SIZE) - 1)); // translated address
             LQ.entry[merged].event_cycle = current_core_cycle[cpu];
@@ -1774,9 +1990,9 @@ void O3_CPU::handle_merged_translation(PACKET *provider)
     }
 }
 
-void O3_CPU::handle_merged_load(PACKET *provider)
+void O3_CPU::handle_merged_load(PACKET *provider, DEPENDENCY &depend_on_provider)
 {
-    ITERATE_SET(merged, provider->lq_index_depend_on_me, LQ.SIZE) {
+    ITERATE_SET(merged, depend_on_provider.lq_index_depend_on_me, LQ.SIZE) {
         uint32_t merged_rob_index = LQ.entry[merged].rob_index;
 
         LQ.entry[merged].fetched = COMPLETED;
@@ -1791,8 +2007,10 @@ void O3_CPU::handle_merged_load(PACKET *provider)
         }
 #endif
 
-        if (ROB.entry[merged_rob_index].num_mem_ops == 0)
+        if (ROB.entry[merged_rob_index].num_mem_ops == 0) {
             inflight_mem_executions++;
+            add_completion_candidate(merged_rob_index);
+        }
 
         DP (if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " load instr_id: " << LQ.entry[merged].instr_id;
@@ -1910,3 +2128,48 @@ void O3_CPU::retire_rob()
         num_retired++;
     }
 }
+
+void O3_CPU::checkpoint(CHECKPOINT &cp)
+{
+    // each core must be restored with the trace it was warmed up with
+    char *trace_name = strrchr(trace_string, '/');
+    cp.section(string("CPU ") + (trace_name ? trace_name+1 : trace_string));
+
+    cp.io(num_retired);
+    cp.io(next_print_instruction);
+    cp.io(last_sim_instr);
+    cp.io(last_sim_cycle);
+
+    checkpoint_branch_predictor(cp);
+
+    ITLB.checkpoint(cp);
+    DTLB.checkpoint(cp);
+    STLB.checkpoint(cp);
+    L1I.checkpoint(cp);
+    L1D.checkpoint(cp);
+    L2C.checkpoint(cp);
+
+    // the pipeline restarts empty at the oldest instruction that had not retired
+    if (cp.restoring()) {
+        instr_unique_id = num_retired;
+        trace_reader->skip(fast_forward.instructions[cpu] + num_retired);
+    }
+}
+
+void O3_CPU::register_stats()
+{
+    string prefix = "cpu" + to_string(cpu) + ".";
+    stats_registry.add(prefix + "instructions", &num_retired);
+    stats_registry.add(prefix + "cycles", &current_core_cycle[cpu]);
+    stats_registry.add(prefix + "branches", &num_branch);
+    stats_registry.add(prefix + "branch_mispredictions", &branch_mispredictions);
+    stats_registry.add(prefix + "major_faults", &major_fault[cpu]);
+    stats_registry.add(prefix + "minor_faults", &minor_fault[cpu]);
+
+    ITLB.register_stats();
+    DTLB.register_stats();
+    STLB.register_stats();
+    L1I.register_stats();
+    L1D.register_stats();
+    L2C.register_stats();
+}
@@ -0,0 +1,154 @@
+#include "champsim.h"
+
+uint64_t PAGE_HASH::get_bucket(uint64_t k)
+{
+    // fibonacci hashing
+    return ((k * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+uint64_t *PAGE_HASH::find(uint64_t k)
+{
+    for (uint64_t bucket = get_bucket(k); used[bucket]; bucket = (bucket + 1) & mask) {
+        if (key[bucket] == k)
+            return &value[bucket];
+    }
+
+    return NULL;
+}
+
+uint64_t *PAGE_HASH::insert(uint64_t k, uint64_t v)
+{
+    if (2*(occupancy+1) > SIZE)
+        resize();
+
+    uint64_t bucket = get_bucket(k);
+    while (used[bucket]) {
+        if (key[bucket] == k) { // overwrite the existing mapping
+            value[bucket] = v;
+            return &value[bucket];
+        }
+        bucket = (bucket + 1) & mask;
+    }
+
+    used[bucket] = 1;
+    key[bucket] = k;
+    value[bucket] = v;
+    occupancy++;
+
+    return &value[bucket];
+}
+
+void PAGE_HASH::erase(uint64_t k)
+{
+    uint64_t bucket = get_bucket(k);
+    while (used[bucket] && (key[bucket] != k))
+        bucket = (bucket + 1) & mask;
+
+    if (used[bucket] == 0)
+        return;
+
+    // backward-shift the rest of the probe chain so that lookups never need tombstones
+    uint64_t next = (bucket + 1) & mask;
+    while (used[next]) {
+        uint64_t home = get_bucket(key[next]);
+        uint8_t movable = (next > bucket) ? ((home <= bucket) || (home > next)) : ((home <= bucket) && (home > next));
+        if (movable) {
+            key[bucket] = key[next];
+            value[bucket] = value[next];
+            bucket = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    used[bucket] = 0;
+    occupancy--;
+}
+
+void PAGE_HASH::resize()
+{
+    uint64_t old_size = SIZE,
+             *old_key = key,
+             *old_value = value;
+    uint8_t  *old_used = used;
+
+    SIZE <<= 1;
+    mask = SIZE - 1;
+    occupancy = 0;
+
+    key = new uint64_t[SIZE];
+    value = new uint64_t[SIZE];
+    used = new uint8_t[SIZE];
+    for (uint64_t i=0; i<SIZE; i++)
+        used[i] = 0;
+
+    for (uint64_t i=0; i<old_size; i++) {
+        if (old_used[i])
+            insert(old_key[i], old_value[i]);
+    }
+
+    delete[] old_key;
+    delete[] old_value;
+    delete[] old_used;
+}
+
+void PAGE_HASH::checkpoint(CHECKPOINT &cp)
+{
+    // the buckets are copied as they are, so probing behaves the same after a restore
+    uint64_t size = cp.io_size(SIZE);
+    if (cp.restoring() && (size != SIZE)) {
+        delete[] key;
+        delete[] value;
+        delete[] used;
+
+        SIZE = size;
+        key = new uint64_t[SIZE];
+        value = new uint64_t[SIZE];
+        used = new uint8_t[SIZE];
+    }
+
+    cp.io(mask);
+    cp.io(occupancy);
+    cp.io_array(key, SIZE);
+    cp.io_array(value, SIZE);
+    cp.io_array(used, SIZE);
+}
+
+uint64_t PAGE_CLOCK::add_frame(uint64_t v, uint64_t p)
+{
+    vpage.push_back(v);
+    ppage.push_back(p);
+    referenced.push_back(1);
+
+    return vpage.size() - 1;
+}
+
+uint64_t PAGE_CLOCK::find_victim()
+{
+#ifdef SANITY_CHECK
+    if (vpage.size() == 0)
+        assert(0);
+#endif
+
+    // give every recently referenced page a second chance, at most one full sweep
+    while (referenced[hand]) {
+        referenced[hand] = 0;
+        hand++;
+        if (hand == vpage.size())
+            hand = 0;
+    }
+
+    uint64_t victim = hand;
+    hand++;
+    if (hand == vpage.size())
+        hand = 0;
+
+    return victim;
+}
+
+void PAGE_CLOCK::checkpoint(CHECKPOINT &cp)
+{
+    cp.io(vpage);
+    cp.io(ppage);
+    cp.io(referenced);
+    cp.io(hand);
+}
@@ -0,0 +1,120 @@
+#include "ooo_cpu.h"
+#include "uncore.h"
+#include <chrono>
+#include <vector>
+#include <sys/resource.h>
+
+PREFETCHER_BENCH prefetcher_bench;
+
+void PREFETCHER_BENCH::open_record()
+{
+    if (record_file.size() == 0)
+        return;
+
+    record = fopen(record_file.c_str(), "wb");
+    if (record == NULL) {
+        cerr << "[PREFETCHER_BENCH] cannot write " << record_file << endl;
+        assert(0);
+    }
+}
+
+void PREFETCHER_BENCH::close_record()
+{
+    if (record == NULL)
+        return;
+
+    fclose(record);
+    record = NULL;
+    cout << endl << "Recorded " << recorded << " L2C prefetcher accesses of CPU 0 in " << record_file << endl;
+}
+
+// peak resident set of the process in KB
+static uint64_t peak_rss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void PREFETCHER_BENCH::run(CACHE *cache)
+{
+    // the whole stream is read before the replay, so the file does not show up in the time
+    FILE *stream = fopen(stream_file.c_str(), "rb");
+    if (stream == NULL) {
+        cerr << "[PREFETCHER_BENCH] cannot read " << stream_file << endl;
+        assert(0);
+    }
+
+    vector<STREAM_ACCESS> accesses;
+    STREAM_ACCESS access;
+    while (fread(&access, sizeof(access), 1, stream) == 1)
+        accesses.push_back(access);
+    fclose(stream);
+
+    if (accesses.size() == 0) {
+        cerr << "[PREFETCHER_BENCH] " << stream_file << " has no accesses" << endl;
+        assert(0);
+    }
+
+    CACHE *llc = (CACHE *)cache->lower_level;
+    uint32_t cpu = cache->cpu;
+    uint64_t loads = 0, hits = 0, prefetches = 0, prefetch_fills = 0, metadata_reads = 0, metadata_writes = 0;
+    uint64_t rss_before = peak_rss();
+
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    for (uint64_t i=0; i<accesses.size(); i++) {
+        STREAM_ACCESS &a = accesses[i];
+        current_core_cycle[cpu]++;
+
+        if (a.type == LOAD)
+            loads++;
+        if (a.hit)
+            hits++;
+
+        uint64_t metadata = cache->l2c_prefetcher_operate(a.address, a.ip, a.hit, a.type, 0);
+
+        // a miss is filled right away
+        if (a.hit == 0)
+            cache->l2c_prefetcher_cache_fill(a.address, cache->get_set(a.address >> LOG2_BLOCK_SIZE), 0, 0, 0, metadata);
+
+        // metadata requests of the prefetcher to the LLC, the reads of the on-chip metadata in the LLC are answered right away
+        while (llc->PQ.occupancy) {
+            metadata_reads++;
+            llc->PQ.remove_queue(&llc->PQ.entry[llc->PQ.head]);
+        }
+        while (llc->metadata_read.size()) {
+            uint64_t meta_data_addr = llc->metadata_read.front().address & ~ONCHIP_METADATA_SPACE;
+            metadata_reads++;
+            llc->metadata_read.pop_front();
+            cache->complete_metadata_req(meta_data_addr);
+        }
+        while (llc->WQ.occupancy) {
+            metadata_writes++;
+            llc->WQ.remove_queue(&llc->WQ.entry[llc->WQ.head]);
+        }
+
+        // so is every prefetch into this level, the others are only counted
+        while (cache->PQ.occupancy) {
+            PACKET *packet = &cache->PQ.entry[cache->PQ.head];
+            if (packet->fill_level <= cache->fill_level) {
+                cache->l2c_prefetcher_cache_fill(packet->full_addr, cache->get_set(packet->address), 0, 1, 0, packet->pf_metadata);
+                prefetch_fills++;
+            }
+            prefetches++;
+            cache->PQ.remove_queue(packet);
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    uint64_t rss_after = peak_rss();
+
+    cout << endl << "Prefetcher Benchmark: " << stream_file << endl;
+    cout << "Accesses: " << accesses.size() << " loads: " << loads << " hits: " << hits << endl;
+    cout << "Host time: " << seconds << " sec ns per access: " << (1e9 * seconds / accesses.size()) << endl;
+    cout << "Prefetches: " << prefetches << " filled into " << cache->NAME << ": " << prefetch_fills;
+    cout << " metadata reads: " << metadata_reads << " writes: " << metadata_writes << endl;
+    cout << "Peak RSS: " << rss_after << " KB (" << rss_before << " KB before the replay)" << endl;
+
+    cout << endl;
+    cache->l2c_prefetcher_final_stats();
+}
@@ -0,0 +1,83 @@
+#include "champsim.h"
+
+HOST_PROFILE_TABLE host_profile;
+
+static const char *profile_region_name[PROFILE_REGIONS] = {
+    "handle_branch",
+    "fetch_instruction",
+    "schedule_instruction",
+    "execute_instruction",
+    "schedule_memory_instruction",
+    "operate_lsq",
+    "update_rob",
+    "retire_rob",
+    "ITLB operate",
+    "DTLB operate",
+    "STLB operate",
+    "L1I operate",
+    "L1D operate",
+    "L2C operate",
+    "LLC operate",
+    "DRAM operate",
+    "l1d_prefetcher_operate",
+    "l1d_prefetcher_cache_fill",
+    "l2c_prefetcher_operate",
+    "l2c_prefetcher_cache_fill",
+    "llc_prefetcher_operate",
+    "llc_prefetcher_cache_fill",
+    "find_victim",
+    "update_replacement_state",
+    "llc_find_victim",
+    "llc_update_replacement_state"
+};
+
+void HOST_PROFILE_TABLE::begin()
+{
+    for (uint32_t i=0; i<=NUM_CPUS; i++)
+        for (uint32_t j=0; j<PROFILE_REGIONS; j++)
+            counter[i][j] = PROFILE_COUNTER();
+
+    // the fastest of many back-to-back reads
+    overhead = UINT64_MAX;
+    for (uint32_t i=0; i<1000; i++) {
+        uint64_t start = ticks(), end = ticks();
+        if ((end - start) < overhead)
+            overhead = end - start;
+    }
+
+    begin_ticks = ticks();
+    begin_time = chrono::steady_clock::now();
+}
+
+void HOST_PROFILE_TABLE::print()
+{
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin_time).count();
+    double ticks_per_second = (seconds > 0) ? (ticks() - begin_ticks) / seconds : 1;
+
+    cout << endl << "Host Profile (1 of " << PROFILE_SAMPLE << " calls timed, " << setprecision(4) << (ticks_per_second / 1e9) << " GHz time stamp counter)" << endl;
+    cout << "Host time: " << seconds << " sec, " << overhead << " ticks of every timed call are not counted" << endl;
+    cout << "CACHE::operate includes the prefetcher and replacement callbacks of its level" << endl;
+
+    for (uint32_t i=0; i<=NUM_CPUS; i++) {
+        for (uint32_t j=0; j<PROFILE_REGIONS; j++) {
+            PROFILE_COUNTER &c = counter[i][j];
+            if (c.samples == 0)
+                continue;
+
+            // the untimed calls are assumed to take as long as the timed ones
+            double timed = (c.ticks > c.samples * overhead) ? (c.ticks - c.samples * overhead) : 0;
+            double estimate = timed * c.calls / c.samples / ticks_per_second;
+
+            if (i == PROFILE_UNCORE)
+                cout << "Uncore ";
+            else
+                cout << "CPU " << i << " ";
+            cout << setw(30) << left << profile_region_name[j] << right;
+            cout << " calls: " << setw(12) << c.calls;
+            cout << " time: " << setw(10) << estimate << " sec";
+            cout << " (" << setw(5) << (100 * estimate / seconds) << "%)";
+            cout << " per call: " << (1e9 * estimate / c.calls) << " ns" << endl;
+        }
+    }
+    cout << setprecision(6);
+}
@@ -0,0 +1,170 @@
+#include "ooo_cpu.h"
+#include "uncore.h"
+#include <fstream>
+#include <algorithm>
+
+SAMPLER sampler;
+
+static bool interval_before(const SAMPLE_INTERVAL &a, const SAMPLE_INTERVAL &b)
+{
+    return a.start < b.start;
+}
+
+// demand misses of a cache (loads and RFOs), the prefetches and writebacks are not counted
+static uint64_t demand_miss(CACHE *cache)
+{
+    return cache->sim_miss[0][LOAD] + cache->sim_miss[0][RFO];
+}
+
+void SAMPLER::load()
+{
+    ifstream in(file.c_str());
+    if (!in.is_open()) {
+        cerr << "[SAMPLER] cannot read " << file << endl;
+        assert(0);
+    }
+
+    string line;
+    while (getline(in, line)) {
+        size_t comment = line.find('#');
+        if (comment != string::npos)
+            line.erase(comment);
+
+        istringstream fields(line);
+        uint64_t start, length;
+        double weight;
+        if (!(fields >> start))
+            continue;
+        if (!(fields >> length >> weight) || (length == 0) || (weight < 0)) {
+            cerr << "[SAMPLER] " << file << ": expected \"start length weight\" in: " << line << endl;
+            assert(0);
+        }
+        intervals.push_back(SAMPLE_INTERVAL(start, length, weight));
+    }
+
+    if (intervals.size() == 0) {
+        cerr << "[SAMPLER] " << file << " has no intervals" << endl;
+        assert(0);
+    }
+
+    sort(intervals.begin(), intervals.end(), interval_before);
+    for (uint32_t i=1; i<intervals.size(); i++) {
+        if (intervals[i].start < (intervals[i-1].start + intervals[i-1].length)) {
+            cerr << "[SAMPLER] " << file << ": the interval at " << intervals[i].start << " overlaps the one at " << intervals[i-1].start << endl;
+            assert(0);
+        }
+    }
+}
+
+uint64_t SAMPLER::position()
+{
+    // the instructions in the ROB were read before the last fast-forward and retire in trace order
+    return fast_forward.instructions[0] + ooo_cpu[0].num_retired;
+}
+
+void SAMPLER::forward_to(uint64_t target)
+{
+    // the trace is read up to the fetched instructions, not the retired ones
+    uint64_t fetched = fast_forward.instructions[0] + ooo_cpu[0].instr_unique_id;
+    if (target > fetched)
+        fast_forward.run(0, target - fetched, fast_forward.train_prefetchers);
+}
+
+void SAMPLER::start(uint64_t warmup)
+{
+    load();
+
+    // the detailed warmup runs before every interval, the regular warmup ends with the first instruction
+    // (the caller clears warmup_instructions) and the simulation ends after the last interval
+    detail_warmup = warmup;
+    ooo_cpu[0].warmup_instructions = 0;
+    ooo_cpu[0].begin_sim_instr = 0;
+    ooo_cpu[0].simulation_instructions = UINT64_MAX >> 1;
+
+    current = 0;
+    phase = SAMPLER_WARMUP;
+    if (intervals[0].start > detail_warmup)
+        forward_to(intervals[0].start - detail_warmup);
+}
+
+void SAMPLER::begin_interval()
+{
+    begin_instructions = ooo_cpu[0].num_retired;
+    begin_cycles = current_core_cycle[0];
+    begin_branch_mispredictions = ooo_cpu[0].branch_mispredictions;
+    begin_l1d_miss = demand_miss(&ooo_cpu[0].L1D);
+    begin_l2c_miss = demand_miss(&ooo_cpu[0].L2C);
+    begin_llc_miss = demand_miss(&uncore.LLC);
+
+    phase = SAMPLER_MEASURE;
+}
+
+void SAMPLER::end_interval()
+{
+    SAMPLE_INTERVAL &interval = intervals[current];
+    interval.instructions = ooo_cpu[0].num_retired - begin_instructions;
+    interval.cycles = current_core_cycle[0] - begin_cycles;
+    interval.branch_mispredictions = ooo_cpu[0].branch_mispredictions - begin_branch_mispredictions;
+    interval.l1d_miss = demand_miss(&ooo_cpu[0].L1D) - begin_l1d_miss;
+    interval.l2c_miss = demand_miss(&ooo_cpu[0].L2C) - begin_l2c_miss;
+    interval.llc_miss = demand_miss(&uncore.LLC) - begin_llc_miss;
+
+    cout << "Sample " << current << " start: " << interval.start << " instructions: " << interval.instructions;
+    cout << " cycles: " << interval.cycles << " IPC: " << ((float) interval.instructions / interval.cycles) << endl;
+
+    current++;
+    if (current == intervals.size()) {
+        phase = SAMPLER_DONE;
+        complete_simulation(0);
+        return;
+    }
+
+    phase = SAMPLER_WARMUP;
+    if (intervals[current].start > detail_warmup)
+        forward_to(intervals[current].start - detail_warmup);
+}
+
+void SAMPLER::check()
+{
+    // the measurement starts after finish_warmup() has reset the counters
+    if ((phase == SAMPLER_DONE) || (all_warmup_complete <= NUM_CPUS))
+        return;
+
+    if ((phase == SAMPLER_WARMUP) && (position() >= intervals[current].start))
+        begin_interval();
+    else if ((phase == SAMPLER_MEASURE) && ((ooo_cpu[0].num_retired - begin_instructions) >= intervals[current].length))
+        end_interval();
+}
+
+void SAMPLER::print()
+{
+    double total_weight = 0, cpi = 0, branch_mpki = 0, l1d_mpki = 0, l2c_mpki = 0, llc_mpki = 0;
+    uint64_t detailed = 0;
+    for (uint32_t i=0; i<intervals.size(); i++) {
+        total_weight += intervals[i].weight;
+        detailed += intervals[i].instructions;
+    }
+
+    cout << endl << "Sampled Simulation: " << file << " (" << intervals.size() << " intervals, " << detail_warmup << " warmup instructions each)" << endl;
+    for (uint32_t i=0; i<intervals.size(); i++) {
+        SAMPLE_INTERVAL &s = intervals[i];
+        double w = (total_weight > 0) ? (s.weight / total_weight) : (1.0 / intervals.size()),
+               kilo = s.instructions / 1000.0;
+
+        cpi += w * s.cycles / s.instructions;
+        branch_mpki += w * s.branch_mispredictions / kilo;
+        l1d_mpki += w * s.l1d_miss / kilo;
+        l2c_mpki += w * s.l2c_miss / kilo;
+        llc_mpki += w * s.llc_miss / kilo;
+
+        cout << "Sample " << i << " start: " << s.start << " weight: " << w << " IPC: " << ((double) s.instructions / s.cycles);
+        cout << " branch MPKI: " << (s.branch_mispredictions / kilo) << " L1D MPKI: " << (s.l1d_miss / kilo);
+        cout << " L2C MPKI: " << (s.l2c_miss / kilo) << " LLC MPKI: " << (s.llc_miss / kilo) << endl;
+    }
+
+    cout << "Weighted IPC: " << (1 / cpi) << " branch MPKI: " << branch_mpki << " L1D MPKI: " << l1d_mpki;
+    cout << " L2C MPKI: " << l2c_mpki << " LLC MPKI: " << llc_mpki << endl;
+    cout << "Detailed instructions: " << detailed << " (" << ooo_cpu[0].num_retired << " with the warmups)";
+    cout << " fast-forwarded: " << fast_forward.instructions[0];
+    cout << " fast-forward KIPS: " << ((fast_forward.seconds > 0) ? (fast_forward.instructions[0] / fast_forward.seconds / 1000) : 0) << endl;
+}
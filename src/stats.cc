@@ -0,0 +1,141 @@
+#include "ooo_cpu.h"
+
+STATS_REGISTRY stats_registry;
+
+uint64_t STAT_COUNTER::read() const
+{
+    if (kind == STAT_U64)
+        return *(const uint64_t *)value;
+    return *(const uint32_t *)value;
+}
+
+void STATS_REGISTRY::add(string name, const uint64_t *value)
+{
+    if (enabled())
+        counters.push_back(STAT_COUNTER(name, STAT_U64, value));
+}
+
+void STATS_REGISTRY::add(string name, const uint32_t *value)
+{
+    if (enabled())
+        counters.push_back(STAT_COUNTER(name, STAT_U32, value));
+}
+
+void STATS_REGISTRY::add(string name, const int *value)
+{
+    if (enabled())
+        counters.push_back(STAT_COUNTER(name, STAT_INT, value));
+}
+
+void STATS_REGISTRY::add_map(string prefix, const map<string, uint64_t> *values)
+{
+    if (enabled())
+        maps.push_back(make_pair(prefix, values));
+}
+
+void STATS_REGISTRY::open()
+{
+    if (!enabled()) {
+        interval = 0;
+        return;
+    }
+
+    size_t dot = file.rfind('.');
+    format = ((dot != string::npos) && (file.substr(dot) == ".csv")) ? STATS_CSV : STATS_JSON;
+
+    out.open(file.c_str());
+    if (!out.good()) {
+        cerr << "[STATS] cannot write " << file << endl;
+        assert(0);
+    }
+
+    if (format == STATS_JSON)
+        out << "{\"cpus\": " << NUM_CPUS << ", \"snapshots\": [";
+    else
+        out << "snapshot,phase,instructions,cycle,name,value" << endl;
+
+    next_snapshot = interval ? interval : UINT64_MAX;
+}
+
+void STATS_REGISTRY::check_interval()
+{
+    uint64_t instructions = 0;
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        instructions += ooo_cpu[i].num_retired;
+
+    if (instructions >= next_snapshot) {
+        snapshot("interval");
+        next_snapshot = (instructions / interval + 1) * interval;
+    }
+}
+
+void STATS_REGISTRY::snapshot(string phase)
+{
+    if (!enabled())
+        return;
+
+    uint64_t instructions = 0;
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        instructions += ooo_cpu[i].num_retired;
+
+    if (format == STATS_CSV) {
+        // one line per counter, the columns before the name are the same for the whole snapshot
+        stringstream prefix;
+        prefix << num_snapshots << "," << phase << "," << instructions << "," << current_core_cycle[0] << ",";
+        string line = prefix.str();
+
+        for (uint32_t i=0; i<counters.size(); i++) {
+            out << line << counters[i].name << ",";
+            if (counters[i].kind == STAT_INT)
+                out << counters[i].read_signed() << endl;
+            else
+                out << counters[i].read() << endl;
+        }
+        for (uint32_t i=0; i<maps.size(); i++) {
+            for (map<string, uint64_t>::const_iterator it = maps[i].second->begin(); it != maps[i].second->end(); it++)
+                out << line << maps[i].first << "." << it->first << "," << it->second << endl;
+        }
+    }
+    else {
+        out << (num_snapshots ? "," : "") << endl << "{\"snapshot\": " << num_snapshots << ", \"phase\": \"" << phase << "\"";
+
+        out << ", \"instructions\": [";
+        for (uint32_t i=0; i<NUM_CPUS; i++)
+            out << (i ? ", " : "") << ooo_cpu[i].num_retired;
+        out << "], \"cycles\": [";
+        for (uint32_t i=0; i<NUM_CPUS; i++)
+            out << (i ? ", " : "") << current_core_cycle[i];
+        out << "]," << endl << " \"counters\": {";
+
+        uint8_t first = 1;
+        for (uint32_t i=0; i<counters.size(); i++) {
+            out << (first ? "" : ", ") << "\"" << counters[i].name << "\": ";
+            if (counters[i].kind == STAT_INT)
+                out << counters[i].read_signed();
+            else
+                out << counters[i].read();
+            first = 0;
+        }
+        for (uint32_t i=0; i<maps.size(); i++) {
+            for (map<string, uint64_t>::const_iterator it = maps[i].second->begin(); it != maps[i].second->end(); it++) {
+                out << (first ? "" : ", ") << "\"" << maps[i].first << "." << it->first << "\": " << it->second;
+                first = 0;
+            }
+        }
+        out << "}}";
+    }
+
+    // a run that is cut short still leaves the snapshots taken so far
+    out.flush();
+    num_snapshots++;
+}
+
+void STATS_REGISTRY::close()
+{
+    if (!enabled())
+        return;
+
+    if (format == STATS_JSON)
+        out << endl << "]}" << endl;
+    out.close();
+}
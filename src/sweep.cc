@@ -0,0 +1,146 @@
+#include "champsim.h"
+#include <fstream>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+SWEEP sweep;
+
+void SWEEP::parse(string list)
+{
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == string::npos)
+            end = list.size();
+
+        string name = list.substr(begin, end - begin);
+        for (uint32_t i=0; i<configs.size(); i++) {
+            if (configs[i] == name) {
+                cerr << "[SWEEP] " << name << " is listed twice" << endl;
+                assert(0);
+            }
+        }
+        if (name.size())
+            configs.push_back(name);
+
+        begin = end + 1;
+    }
+
+    if (configs.size() > TRACE_MAX_READERS) {
+        cerr << "[SWEEP] " << configs.size() << " configurations, at most " << TRACE_MAX_READERS << " are supported" << endl;
+        assert(0);
+    }
+}
+
+void SWEEP::start(size_t instr_size)
+{
+#ifndef COMPONENT_REGISTRY
+    cerr << "[SWEEP] this binary is built with fixed components, use a binary from ./build_champsim.sh registry to sweep them" << endl;
+    assert(0);
+#endif
+
+    // the rings must exist before fork() to be shared
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        ring[i] = TRACE_RING::allocate(SWEEP_RING_SIZE, configs.size(), instr_size * TRACE_BATCH_INSTRS, 1);
+
+    // buffered output would be printed again by every child
+    cout.flush();
+    fflush(stdout);
+
+    for (uint32_t i=0; i<configs.size(); i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "[SWEEP] cannot fork the simulation of " << configs[i] << endl;
+            assert(0);
+        }
+
+        if (pid == 0) {
+#ifdef __linux__
+            // nothing decodes the trace once the parent is gone
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+            config = i;
+            children.clear();
+
+            string file = output + "." + configs[i] + ".out";
+            if (freopen(file.c_str(), "w", stdout) == NULL) {
+                cerr << "[SWEEP] cannot write " << file << endl;
+                assert(0);
+            }
+            return;
+        }
+
+        children.push_back(pid);
+    }
+}
+
+TRACE_READER *SWEEP::open_trace(string name, size_t instr_size, uint8_t format, uint32_t cpu)
+{
+    // the decoder process fills the ring, each child reads it with its own head
+    reader[cpu] = new TRACE_READER(name, instr_size, format, ring[cpu], decoder() ? TRACE_DECODER_ONLY : config);
+    return reader[cpu];
+}
+
+void SWEEP::run()
+{
+    cout << endl << "Sweep: " << configs.size() << " simulations, output in " << output << ".<L2C prefetcher>.out" << endl;
+
+    uint32_t remaining = children.size(), failed = 0;
+    while (remaining) {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+            break;
+
+        uint32_t i = 0;
+        while ((i < children.size()) && (children[i] != pid))
+            i++;
+        if (i == children.size())
+            continue;
+        remaining--;
+
+        // a simulation that crashed must not stall the decoder
+        for (uint32_t j=0; j<NUM_CPUS; j++)
+            ring[j]->head[i].store(TRACE_DETACHED, memory_order_release);
+
+        if (WIFEXITED(status) && (WEXITSTATUS(status) == 0))
+            cout << "Sweep: " << configs[i] << " finished" << endl;
+        else {
+            failed++;
+            cout << "Sweep: " << configs[i] << " FAILED";
+            if (WIFSIGNALED(status))
+                cout << " (signal " << WTERMSIG(status) << ")";
+            else
+                cout << " (exit " << WEXITSTATUS(status) << ")";
+            cout << endl;
+        }
+    }
+
+    // summary of the region of interest of each simulation
+    cout << endl << "Sweep Statistics" << endl;
+    for (uint32_t i=0; i<configs.size(); i++) {
+        ifstream file(output + "." + configs[i] + ".out");
+        string line;
+        uint8_t roi = 0;
+        while (getline(file, line)) {
+            if (line == "Region of Interest Statistics")
+                roi = 1;
+            if (roi && (line.compare(0, 4, "CPU ") == 0) && (line.find("cumulative IPC") != string::npos))
+                cout << configs[i] << " " << line << endl;
+        }
+    }
+
+    cout.flush();
+    exit(failed ? 1 : 0);
+}
+
+void SWEEP::finish()
+{
+    // the output of a finished simulation no longer holds back the others
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        reader[i]->detach();
+}
@@ -0,0 +1,227 @@
+#include "champsim.h"
+#include "trace_reader.h"
+#include <sys/mman.h>
+
+TRACE_RING *TRACE_RING::allocate(uint32_t size, uint32_t readers, size_t batch_bytes, uint8_t shared)
+{
+    if (readers > TRACE_MAX_READERS) {
+        cerr << "[TRACE_RING] " << readers << " readers, at most " << TRACE_MAX_READERS << " are supported" << endl;
+        assert(0);
+    }
+
+    // an anonymous mapping created before fork() is shared with the child processes
+    size_t ring_bytes = sizeof(TRACE_RING) + size*sizeof(TRACE_BATCH),
+           bytes = ring_bytes + size*batch_bytes;
+    void *mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        cerr << "[TRACE_RING] cannot map " << bytes << " bytes" << endl;
+        assert(0);
+    }
+
+    TRACE_RING *ring = new (mapping) TRACE_RING(size, readers);
+    ring->mapped_bytes = bytes;
+    ring->batch = (TRACE_BATCH *)((char *)mapping + sizeof(TRACE_RING));
+    for (uint32_t i=0; i<size; i++) {
+        new (&ring->batch[i]) TRACE_BATCH();
+        ring->batch[i].data = (char *)mapping + ring_bytes + i*batch_bytes;
+    }
+
+    return ring;
+}
+
+void TRACE_RING::release(TRACE_RING *ring)
+{
+    munmap(ring, ring->mapped_bytes);
+}
+
+uint64_t TRACE_RING::slowest_head()
+{
+    // readers that stopped reading no longer hold batches
+    uint64_t slowest = TRACE_DETACHED;
+    for (uint32_t i=0; i<READERS; i++) {
+        uint64_t h = head[i].load(memory_order_acquire);
+        if (h < slowest)
+            slowest = h;
+    }
+
+    return slowest;
+}
+
+void TRACE_READER::open_trace()
+{
+    if (format == TRACE_GZ) {
+        gz_file = gzopen(NAME.c_str(), "rb");
+        if (gz_file == NULL) {
+            cerr << endl << "*** Trace file not found: " << NAME << " ***" << endl;
+            assert(0);
+        }
+        gzbuffer(gz_file, TRACE_INPUT_SIZE);
+    } else {
+        xz_file = fopen(NAME.c_str(), "rb");
+        if (xz_file == NULL) {
+            cerr << endl << "*** Trace file not found: " << NAME << " ***" << endl;
+            assert(0);
+        }
+        xz_input = new uint8_t[TRACE_INPUT_SIZE];
+
+        lzma_stream init = LZMA_STREAM_INIT;
+        xz_stream = init;
+        if (lzma_stream_decoder(&xz_stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+            cerr << endl << "*** CANNOT INITIALIZE XZ DECODER: " << NAME << " ***" << endl;
+            assert(0);
+        }
+        xz_done = 0;
+    }
+}
+
+void TRACE_READER::close_trace()
+{
+    if (gz_file) {
+        gzclose(gz_file);
+        gz_file = NULL;
+    }
+
+    if (xz_file) {
+        lzma_end(&xz_stream);
+        fclose(xz_file);
+        xz_file = NULL;
+        delete[] xz_input;
+        xz_input = NULL;
+    }
+}
+
+void TRACE_READER::rewind_trace()
+{
+    // start over from the first instruction, the compressed file stays open
+    if (format == TRACE_GZ) {
+        if (gzrewind(gz_file) != 0) {
+            cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << NAME << " ***" << endl;
+            assert(0);
+        }
+    } else {
+        lzma_end(&xz_stream);
+        rewind(xz_file);
+
+        lzma_stream init = LZMA_STREAM_INIT;
+        xz_stream = init;
+        if (lzma_stream_decoder(&xz_stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+            cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << NAME << " ***" << endl;
+            assert(0);
+        }
+        xz_done = 0;
+    }
+}
+
+size_t TRACE_READER::decode(char *buf, size_t bytes)
+{
+    // returns fewer than the requested bytes only at the end of the trace
+    if (format == TRACE_GZ) {
+        int ret = gzread(gz_file, buf, bytes);
+        if (ret < 0) {
+            int errnum;
+            cerr << endl << "*** CANNOT DECODE TRACE FILE: " << NAME << " " << gzerror(gz_file, &errnum) << " ***" << endl;
+            assert(0);
+        }
+        return ret;
+    }
+
+    xz_stream.next_out = (uint8_t *)buf;
+    xz_stream.avail_out = bytes;
+    while (xz_stream.avail_out && !xz_done) {
+        if (xz_stream.avail_in == 0 && !feof(xz_file)) {
+            xz_stream.next_in = xz_input;
+            xz_stream.avail_in = fread(xz_input, 1, TRACE_INPUT_SIZE, xz_file);
+        }
+
+        lzma_ret ret = lzma_code(&xz_stream, feof(xz_file) ? LZMA_FINISH : LZMA_RUN);
+        if (ret == LZMA_STREAM_END)
+            xz_done = 1;
+        else if (ret != LZMA_OK) {
+            cerr << endl << "*** CANNOT DECODE TRACE FILE: " << NAME << " lzma error " << ret << " ***" << endl;
+            assert(0);
+        }
+    }
+
+    return bytes - xz_stream.avail_out;
+}
+
+void TRACE_READER::decode_loop()
+{
+    size_t batch_bytes = INSTR_SIZE * TRACE_BATCH_INSTRS;
+
+    while (!stop.load(memory_order_relaxed)) {
+        uint64_t t = ring->tail.load(memory_order_relaxed),
+                 h = ring->slowest_head();
+
+        // wait for the slowest core to release a batch
+        if ((h == TRACE_DETACHED) || (t - h == ring->SIZE)) {
+            this_thread::sleep_for(chrono::microseconds(50));
+            continue;
+        }
+
+        TRACE_BATCH *batch = &ring->batch[t & (ring->SIZE-1)];
+        size_t bytes = decode(batch->data, batch_bytes);
+
+        // a partial instruction at the end of the trace is dropped
+        batch->count = bytes / INSTR_SIZE;
+        batch->end_of_trace = (bytes < batch_bytes);
+        if (batch->end_of_trace)
+            rewind_trace();
+
+        ring->tail.store(t+1, memory_order_release);
+    }
+}
+
+int TRACE_READER::read_instr(void *instr)
+{
+    // returns 0 once at the end of the trace, the next call continues from the first instruction
+    atomic<uint64_t> &head = ring->head[reader];
+    while ((current == NULL) || (read_pos == current->count)) {
+        if (current) {
+            if (current->end_of_trace && !end_reported) {
+                end_reported = 1;
+                return 0;
+            }
+
+            head.store(head.load(memory_order_relaxed) + 1, memory_order_release);
+            current = NULL;
+        }
+
+        uint64_t h = head.load(memory_order_relaxed);
+        while (ring->tail.load(memory_order_acquire) == h)
+            this_thread::yield();
+
+        current = &ring->batch[h & (ring->SIZE-1)];
+        read_pos = 0;
+        end_reported = 0;
+    }
+
+    memcpy(instr, current->data + read_pos*INSTR_SIZE, INSTR_SIZE);
+    read_pos++;
+
+    return 1;
+}
+
+void TRACE_READER::detach()
+{
+    // lets the decoder run ahead of a simulation that finished
+    ring->head[reader].store(TRACE_DETACHED, memory_order_release);
+}
+
+void TRACE_READER::skip(uint64_t instrs)
+{
+    // used by a checkpoint restore, whole batches are skipped without copying the instructions
+    char *instr = new char[INSTR_SIZE];
+    while (instrs) {
+        if (current && (read_pos < current->count)) {
+            uint64_t available = current->count - read_pos;
+            if (available > instrs)
+                available = instrs;
+
+            read_pos += available;
+            instrs -= available;
+        } else
+            instrs -= read_instr(instr);
+    }
+    delete[] instr;
+}
@@ -0,0 +1,449 @@
+/*
+ * Synthetic trace generator
+ *
+ * writes a trace in the input_instr format of the simulator from parameterized
+ * kernels with a known access pattern, so the prefetchers can be compared on
+ * patterns whose coverage is known in advance, and small traces are at hand
+ * for measuring the speed of the simulator
+ *
+ * make trace_generator
+ * bin/trace_generator -kernel chase -size 65536 -instructions 10000000 -o chase.champsimtrace.gz
+ * bin/trace_generator -kernel chase,stride,hash -interleave 4 -o mix.champsimtrace.xz
+ *
+ * kernels (-kernel a,b,c interleaves several, each with its own PCs and data):
+ *   chase    pointer chasing over a shuffled linked list of -size nodes of one block,
+ *            every load depends on the previous one
+ *   stride   -streams arrays of -size elements walked with a stride of -stride bytes, one PC per array
+ *   spatial  a repeating irregular sequence of -size regions of -region bytes, every visit touches the
+ *            same dense footprint (-footprint percent of the blocks) of the region
+ *   hash     probes of a table of -size buckets, each probe reads -probes consecutive blocks,
+ *            the buckets follow a repeating sequence of -keys random keys (0: no repetition)
+ *
+ * every access is followed by -work instructions without memory operands and the loop branch
+ * the ground truth of each kernel (blocks, accesses, repetition) is printed when the trace is written
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <assert.h>
+#include <zlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <unordered_set>
+
+#include "instruction.h"
+
+using namespace std;
+
+#define LOG2_BLOCK_SIZE 6
+#define BLOCK_SIZE 64
+#define KERNEL_PC 0x400000
+#define KERNEL_PC_SPACING 0x10000
+#define KERNEL_DATA_SPACING (1ull << 36)
+
+#define REG_INDEX 1 // loop index of the independent kernels
+#define REG_POINTER 2 // next node of the pointer chase
+#define REG_VALUE 3 // the value a load returns
+#define REG_WORK 4 // the registers of the work instructions start here
+
+class GENERATOR_CONFIG {
+  public:
+    uint64_t instructions, size, stride, streams, region, footprint, probes, keys, work, interleave, seed;
+    string kernels, output;
+
+    // constructor
+    GENERATOR_CONFIG() {
+        instructions = 10000000;
+        size = 65536;
+        stride = 64;
+        streams = 1;
+        region = 2048;
+        footprint = 50;
+        probes = 2;
+        keys = 4096;
+        work = 2;
+        interleave = 1;
+        seed = 1;
+        output = "synthetic.champsimtrace.gz";
+    };
+};
+
+// a kernel returns one memory access per call of next(), the generator adds the work and the loop branch
+class KERNEL {
+  public:
+    string NAME;
+    uint64_t pc, base, accesses;
+    uint8_t dependent; // the address of the access depends on the previous access of the kernel
+
+    unordered_set<uint64_t> blocks;
+    mt19937_64 engine;
+
+    // constructor
+    KERNEL(string v1, uint32_t v2, uint64_t v3) : NAME(v1), engine(v3 + v2) {
+        pc = KERNEL_PC + v2*KERNEL_PC_SPACING;
+        base = (v2 + 1) * KERNEL_DATA_SPACING;
+        accesses = 0;
+        dependent = 0;
+    };
+    virtual ~KERNEL() {};
+
+    // the address of the next access and the PC of its load
+    virtual uint64_t next(uint64_t &ip) = 0;
+
+    // what a prefetcher can know about the pattern
+    virtual void describe() = 0;
+
+    uint64_t random(uint64_t n) { return uniform_int_distribution<uint64_t>(0, n-1)(engine); };
+};
+
+// a shuffled linked list, the traversal repeats the same order of nodes
+class CHASE_KERNEL : public KERNEL {
+  public:
+    vector<uint64_t> order;
+    uint64_t position;
+
+    CHASE_KERNEL(uint32_t id, GENERATOR_CONFIG &config) : KERNEL("chase", id, config.seed) {
+        order.resize(config.size);
+        for (uint64_t i=0; i<config.size; i++)
+            order[i] = i;
+        shuffle(order.begin(), order.end(), engine);
+        position = 0;
+        dependent = 1;
+    };
+
+    uint64_t next(uint64_t &ip) {
+        ip = pc;
+        uint64_t address = base + (order[position] << LOG2_BLOCK_SIZE);
+        position = (position + 1) % order.size();
+        return address;
+    };
+
+    void describe() {
+        cout << "  " << NAME << ", temporal: a pass over the list is " << order.size() << " dependent loads in the same order, every pass after the first is predictable" << endl;
+    };
+};
+
+// independent arrays with a constant stride, one load PC per array
+class STRIDE_KERNEL : public KERNEL {
+  public:
+    uint64_t size, stride, streams, stream, position;
+
+    STRIDE_KERNEL(uint32_t id, GENERATOR_CONFIG &config) : KERNEL("stride", id, config.seed) {
+        size = config.size;
+        stride = config.stride;
+        streams = config.streams;
+        stream = 0;
+        position = 0;
+    };
+
+    uint64_t next(uint64_t &ip) {
+        ip = pc + stream*4;
+
+        // the arrays are apart far enough to never share a page
+        uint64_t address = base + stream*((size*stride + (1 << 20)) & ~((1ull << 20) - 1)) + position*stride;
+
+        stream++;
+        if (stream == streams) {
+            stream = 0;
+            position = (position + 1) % size;
+        }
+        return address;
+    };
+
+    void describe() {
+        cout << "  " << NAME << ", spatial: " << streams << " arrays of " << size << " elements with a stride of " << stride << " bytes, every access after the first of an array is predictable" << endl;
+    };
+};
+
+// regions visited in a repeating irregular order, each visit touches the same footprint in increasing order
+class SPATIAL_KERNEL : public KERNEL {
+  public:
+    vector<uint64_t> regions;
+    vector<vector<uint64_t> > footprints;
+    uint64_t region_size, position, offset;
+
+    SPATIAL_KERNEL(uint32_t id, GENERATOR_CONFIG &config) : KERNEL("spatial", id, config.seed) {
+        region_size = config.region;
+        uint64_t region_blocks = region_size / BLOCK_SIZE;
+        assert(region_blocks > 0);
+
+        // the regions are scattered over a space 16 times as large as they are
+        regions.resize(config.size);
+        footprints.resize(config.size);
+        for (uint64_t i=0; i<config.size; i++) {
+            regions[i] = random(config.size * 16);
+
+            for (uint64_t j=0; j<region_blocks; j++)
+                if (random(100) < config.footprint)
+                    footprints[i].push_back(j);
+            if (footprints[i].empty())
+                footprints[i].push_back(random(region_blocks));
+        }
+        position = 0;
+        offset = 0;
+    };
+
+    uint64_t next(uint64_t &ip) {
+        // the first access of a visit triggers the region, the others follow its footprint
+        ip = pc + (offset ? 4 : 0);
+        uint64_t address = base + regions[position]*region_size + (footprints[position][offset] << LOG2_BLOCK_SIZE);
+
+        offset++;
+        if (offset == footprints[position].size()) {
+            offset = 0;
+            position = (position + 1) % regions.size();
+        }
+        return address;
+    };
+
+    void describe() {
+        uint64_t total = 0;
+        for (uint64_t i=0; i<footprints.size(); i++)
+            total += footprints[i].size();
+        cout << "  " << NAME << ", spatial and temporal: " << regions.size() << " regions of " << region_size << " bytes with " << (1.0*total/footprints.size()) << " blocks each,";
+        cout << " the footprint follows the trigger, the sequence of regions repeats every " << total << " accesses" << endl;
+    };
+};
+
+// probes of a hash table, a short run of consecutive blocks from a pseudo-random bucket
+class HASH_KERNEL : public KERNEL {
+  public:
+    uint64_t buckets, probes, probe, bucket, position;
+    vector<uint64_t> keys;
+
+    HASH_KERNEL(uint32_t id, GENERATOR_CONFIG &config) : KERNEL("hash", id, config.seed) {
+        buckets = config.size;
+        probes = config.probes;
+        keys.resize(config.keys);
+        for (uint64_t i=0; i<keys.size(); i++)
+            keys[i] = random(buckets);
+        probe = 0;
+        position = 0;
+        bucket = next_bucket();
+    };
+
+    uint64_t next_bucket() {
+        if (keys.empty())
+            return random(buckets);
+        uint64_t b = keys[position];
+        position = (position + 1) % keys.size();
+        return b;
+    };
+
+    uint64_t next(uint64_t &ip) {
+        ip = pc + (probe ? 4 : 0);
+        uint64_t address = base + (((bucket + probe) % buckets) << LOG2_BLOCK_SIZE);
+
+        probe++;
+        if (probe == probes) {
+            probe = 0;
+            bucket = next_bucket();
+        }
+        return address;
+    };
+
+    void describe() {
+        if (keys.empty())
+            cout << "  " << NAME << ", random: " << buckets << " buckets probed at random, only the " << (probes - 1) << " blocks after the bucket are predictable" << endl;
+        else
+            cout << "  " << NAME << ", temporal: a sequence of " << keys.size() << " keys over " << buckets << " buckets repeats every " << (keys.size() * probes) << " accesses" << endl;
+    };
+};
+
+// writes instructions to a gz (zlib), xz (through the xz command) or uncompressed trace
+class TRACE_WRITER {
+  public:
+    string NAME;
+    gzFile gz_file;
+    FILE *file;
+    uint8_t piped;
+    uint64_t written;
+
+    TRACE_WRITER(string v1) : NAME(v1) {
+        gz_file = NULL;
+        file = NULL;
+        piped = 0;
+        written = 0;
+
+        size_t dot = NAME.rfind('.');
+        string extension = (dot == string::npos) ? "" : NAME.substr(dot);
+        if (extension == ".gz")
+            gz_file = gzopen(NAME.c_str(), "wb");
+        else if (extension == ".xz") {
+            file = popen(("xz -c > " + NAME).c_str(), "w");
+            piped = 1;
+        }
+        else
+            file = fopen(NAME.c_str(), "wb");
+
+        if ((gz_file == NULL) && (file == NULL)) {
+            cerr << "[TRACE_GENERATOR] cannot write " << NAME << endl;
+            assert(0);
+        }
+    };
+
+    void write(input_instr &instr) {
+        if (gz_file)
+            gzwrite(gz_file, &instr, sizeof(instr));
+        else
+            fwrite(&instr, sizeof(instr), 1, file);
+        written++;
+    };
+
+    void close() {
+        if (gz_file)
+            gzclose(gz_file);
+        else if (piped)
+            pclose(file);
+        else
+            fclose(file);
+    };
+};
+
+KERNEL *make_kernel(string name, uint32_t id, GENERATOR_CONFIG &config)
+{
+    if (name == "chase")
+        return new CHASE_KERNEL(id, config);
+    if (name == "stride")
+        return new STRIDE_KERNEL(id, config);
+    if (name == "spatial")
+        return new SPATIAL_KERNEL(id, config);
+    if (name == "hash")
+        return new HASH_KERNEL(id, config);
+
+    cerr << "[TRACE_GENERATOR] unknown kernel " << name << ", the kernels are chase, stride, spatial and hash" << endl;
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    GENERATOR_CONFIG config;
+
+    int c;
+    while (1) {
+        static struct option long_options[] =
+        {
+            {"kernel", required_argument, 0, 'k'},
+            {"instructions", required_argument, 0, 'i'},
+            {"size", required_argument, 0, 'n'},
+            {"stride", required_argument, 0, 's'},
+            {"streams", required_argument, 0, 'm'},
+            {"region", required_argument, 0, 'r'},
+            {"footprint", required_argument, 0, 'f'},
+            {"probes", required_argument, 0, 'p'},
+            {"keys", required_argument, 0, 'y'},
+            {"work", required_argument, 0, 'w'},
+            {"interleave", required_argument, 0, 'l'},
+            {"seed", required_argument, 0, 'd'},
+            {"o", required_argument, 0, 'o'},
+            {0, 0, 0, 0}
+        };
+
+        int option_index = 0;
+        c = getopt_long_only(argc, argv, "", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch(c) {
+            case 'k': config.kernels = optarg; break;
+            case 'i': config.instructions = atol(optarg); break;
+            case 'n': config.size = atol(optarg); break;
+            case 's': config.stride = atol(optarg); break;
+            case 'm': config.streams = atol(optarg); break;
+            case 'r': config.region = atol(optarg); break;
+            case 'f': config.footprint = atol(optarg); break;
+            case 'p': config.probes = atol(optarg); break;
+            case 'y': config.keys = atol(optarg); break;
+            case 'w': config.work = atol(optarg); break;
+            case 'l': config.interleave = atol(optarg); break;
+            case 'd': config.seed = atol(optarg); break;
+            case 'o': config.output = optarg; break;
+            default:
+                exit(1);
+        }
+    }
+
+    if (config.kernels.empty() || (config.size == 0) || (config.streams == 0) || (config.probes == 0) || (config.interleave == 0)) {
+        cerr << "usage: " << argv[0] << " -kernel chase|stride|spatial|hash[,...] [-instructions n] [-size n] [-stride bytes] [-streams n]" << endl;
+        cerr << "       [-region bytes] [-footprint percent] [-probes n] [-keys n] [-work n] [-interleave n] [-seed n] [-o trace]" << endl;
+        exit(1);
+    }
+
+    vector<KERNEL *> kernels;
+    size_t begin = 0;
+    while (begin <= config.kernels.size()) {
+        size_t end = config.kernels.find(',', begin);
+        if (end == string::npos)
+            end = config.kernels.size();
+        if (end > begin)
+            kernels.push_back(make_kernel(config.kernels.substr(begin, end - begin), kernels.size(), config));
+        begin = end + 1;
+    }
+
+    TRACE_WRITER writer(config.output);
+
+    // each turn of a kernel is -interleave iterations of: load, work, loop branch
+    uint32_t turn = 0;
+    uint64_t turn_accesses = 0;
+    vector<input_instr> iteration;
+    while (writer.written < config.instructions) {
+        KERNEL *kernel = kernels[turn];
+        iteration.clear();
+
+        uint64_t ip;
+        input_instr load;
+        load.source_memory[0] = kernel->next(ip);
+        load.ip = ip;
+        load.source_registers[0] = kernel->dependent ? REG_POINTER : REG_INDEX;
+        load.destination_registers[0] = kernel->dependent ? REG_POINTER : REG_VALUE;
+        iteration.push_back(load);
+
+        kernel->accesses++;
+        kernel->blocks.insert(load.source_memory[0] >> LOG2_BLOCK_SIZE);
+
+        for (uint64_t i=0; i<config.work; i++) {
+            input_instr work;
+            work.ip = kernel->pc + 0x100 + i*4;
+            work.source_registers[0] = (i == 0) ? REG_VALUE : (REG_WORK + (i-1)%8);
+            work.destination_registers[0] = REG_WORK + i%8;
+            iteration.push_back(work);
+        }
+
+        input_instr branch;
+        branch.ip = kernel->pc + 0x100 + config.work*4;
+        branch.is_branch = 1;
+        branch.branch_taken = 1;
+        branch.source_registers[0] = REG_INDEX;
+        branch.destination_registers[0] = REG_INDEX;
+        iteration.push_back(branch);
+
+        // the last iteration is cut at -instructions
+        for (uint64_t i=0; (i < iteration.size()) && (writer.written < config.instructions); i++)
+            writer.write(iteration[i]);
+
+        turn_accesses++;
+        if (turn_accesses == config.interleave) {
+            turn_accesses = 0;
+            turn = (turn + 1) % kernels.size();
+        }
+    }
+    writer.close();
+
+    cout << "Trace: " << config.output << " instructions: " << writer.written << endl;
+    for (uint32_t i=0; i<kernels.size(); i++) {
+        KERNEL *kernel = kernels[i];
+        cout << "Kernel " << i << " " << kernel->NAME << " pc: 0x" << hex << kernel->pc << dec << " accesses: " << kernel->accesses;
+        cout << " blocks: " << kernel->blocks.size() << " repeated accesses: " << (kernel->accesses - kernel->blocks.size()) << endl;
+        kernel->describe();
+        delete kernel;
+    }
+
+    return 0;
+}